@@ -2,6 +2,7 @@
 
 #pragma include ../Includes/Camera.glsl //! #include "../Includes/Camera.glsl"
 #pragma include ../Includes/Lights.glsl //! #include "../Includes/Lights.glsl"
+#pragma include ../Includes/Instancing.glsl //! #include "../Includes/Instancing.glsl"
 
 layout (location = 0) in vec3 vPosition;
 layout (location = 1) in vec2 vUV;
@@ -22,10 +23,13 @@ out VSData
 
 void main() 
 {
-    vec4 fragPosWS = modelToWorld * vec4(vPosition, 1.0);
+    mat4 model = _instanceModelToWorld(modelToWorld);
+    mat4 normalModel = _instanceNormalToWorld(normalToWorld);
+
+    vec4 fragPosWS = model * vec4(vPosition, 1.0);
 
     vs_out.uv = vUV;
-    vs_out.normalWS = normalize(normalToWorld * vec4(vNormal, 0)).xyz;
+    vs_out.normalWS = normalize(normalModel * vec4(vNormal, 0)).xyz;
     vs_out.fragPosWS = fragPosWS.xyz;
 
     for(int i = 0; i < _numLights; ++i)
@@ -15,8 +15,7 @@ uniform sampler2D normalMap; // [normal]
 
 vec3 sampleNormal()
 {
-    vec3 normal = texture(normalMap, IN.uv).xyz;
-    normal = normalize(normal * 2.0 - 1.0);   
+    vec3 normal = _unpackNormal(texture(normalMap, IN.uv).xy);
     return normalize(IN.TBN * normal);
     //return normalize(IN.normal);
 }
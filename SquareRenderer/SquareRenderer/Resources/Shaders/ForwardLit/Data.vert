@@ -2,6 +2,7 @@
 
 #pragma include ../Includes/Common.glsl //! #include "../Includes/Common.glsl"
 #pragma include ../Includes/Camera.glsl //! #include "../Includes/Camera.glsl"
+#pragma include ../Includes/Instancing.glsl //! #include "../Includes/Instancing.glsl"
 
 layout (location = 0) in vec3 vPosition;
 layout (location = 1) in vec2 vUV;
@@ -19,10 +20,12 @@ uniform mat4 normalToWorld = mat4(1);
 
 void main() 
 {
-    vec4 fragPosWS = modelToWorld * vec4(vPosition, 1.0);
+    mat4 model = _instanceModelToWorld(modelToWorld);
+
+    vec4 fragPosWS = model * vec4(vPosition, 1.0);
 
     OUT.uv = vUV;
-    OUT.TBN = _constructTBN(modelToWorld, vNormal, vTangent);
+    OUT.TBN = _constructTBN(model, vNormal, vTangent);
 
     gl_Position = _VP * fragPosWS;
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #pragma include ../Includes/Sampling.glsl //! #include "../Includes/Sampling.glsl"
 #pragma include ../Includes/Shadow.glsl //! #include "../Includes/Shadow.glsl"
 #pragma include ../Includes/PBR.glsl //! #include "../Includes/PBR.glsl"
+#pragma include ../Includes/Environment.glsl //! #include "../Includes/Environment.glsl"
 
 in VertexShaderData
 {
@@ -35,7 +36,13 @@ uniform float aoFactor = 1; // [0, 1]
 
 uniform sampler2D   brdfLUT;
 uniform samplerCube prefilterMap;
+#if IBL_SH
+#else
 uniform samplerCube irradianceMap;
+#endif
+#if IRRADIANCE_VOLUME
+uniform sampler3D irradianceVolume;
+#endif
 
 struct Material
 {
@@ -47,8 +54,7 @@ struct Material
 
 vec3 sampleNormal()
 {
-    vec3 normal = texture(normalMap, IN.uv).xyz;
-    normal = normalize(normal * 2.0 - 1.0);   
+    vec3 normal = _unpackNormal(texture(normalMap, IN.uv).xy);
     return normalize(IN.TBN * normal);
     //return normalize(IN.normal);
 }
@@ -61,7 +67,17 @@ vec3 IBL(in vec3 N, in vec3 V, in vec3 R, in vec3 F0, in Material mat)
     vec3 kD = 1.0 - kS;
     kD *= 1.0 - mat.metallic;	  
     
+#if IBL_SH
+    vec3 irradiance = _evaluateSH9(_irradianceSH, N);
+#if IRRADIANCE_VOLUME
+    if (_volumeMin.w > 0.0)
+    {
+        irradiance = _sampleIrradianceVolume(irradianceVolume, IN.fragmentPosWS, N);
+    }
+#endif
+#else
     vec3 irradiance = texture(irradianceMap, N).rgb;
+#endif
     vec3 diffuse    = irradiance * mat.albedo;
 
     const float MAX_REFLECTION_LOD = 4.0;
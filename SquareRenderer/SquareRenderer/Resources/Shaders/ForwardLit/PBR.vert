@@ -5,6 +5,7 @@
 #pragma include ../Includes/Lights.glsl //! #include "../Includes/Lights.glsl"
 #pragma include ../Includes/Camera.glsl //! #include "../Includes/Camera.glsl"
 #pragma include ../Includes/PBR.glsl //! #include "../Includes/PBR.glsl"
+#pragma include ../Includes/Instancing.glsl //! #include "../Includes/Instancing.glsl"
 
 layout (location = 0) in vec3 vPosition;
 layout (location = 1) in vec2 vUV;
@@ -38,7 +39,10 @@ uniform mat4 normalToWorld = mat4(1);
 
 void main() 
 {
-    vec4 fragPosWS = modelToWorld * vec4(vPosition, 1.0);
+    mat4 model = _instanceModelToWorld(modelToWorld);
+    mat4 normalModel = _instanceNormalToWorld(normalToWorld);
+
+    vec4 fragPosWS = model * vec4(vPosition, 1.0);
 
     OUT.uv = vUV;
     OUT.fragmentPosWS = fragPosWS.xyz;
@@ -51,8 +55,8 @@ void main()
 
 #else
 
-    OUT.TBN = _constructTBN(modelToWorld, vNormal, vTangent);
-    OUT.normalWS = normalize(normalToWorld * vec4(vNormal, 0)).xyz;
+    OUT.TBN = _constructTBN(model, vNormal, vTangent);
+    OUT.normalWS = normalize(normalModel * vec4(vNormal, 0)).xyz;
 
     for(int i = 0; i < _numLights; ++i)
     {
@@ -21,6 +21,16 @@ mat3 _constructTBN(
     return mat3(T, B, N);
 }
 
+// tangent space normal from the red and green channel, two channel
+// compressed normal maps (BC5) do not store z
+vec3 _unpackNormal(in vec2 encoded)
+{
+    vec2 xy = encoded * 2.0 - 1.0;
+    float z = sqrt(max(1.0 - dot(xy, xy), 0.0));
+
+    return vec3(xy, z);
+}
+
 float _linearizeDepth(float depth, float n, float f)
 {
     float c0 = ( 1 - f / n ) / 2;
@@ -0,0 +1,51 @@
+//? #version 450 core
+
+layout(std140) uniform EnvironmentUBO
+{
+	// L2 diffuse irradiance divided by pi, rgb
+	vec4[9] _irradianceSH;
+
+	// irradiance volume bounds, w of the minimum is 1 if it is sampled
+	vec4 _volumeMin;
+	vec4 _volumeMax;
+	vec4 _volumeResolution; // probes per axis
+};
+
+// evaluates L2 spherical harmonics in the direction n
+vec3 _evaluateSH9(in vec4 sh[9], in vec3 n)
+{
+    vec3 result = sh[0].rgb * 0.282094792;
+
+    result += sh[1].rgb * 0.488602512 * n.y;
+    result += sh[2].rgb * 0.488602512 * n.z;
+    result += sh[3].rgb * 0.488602512 * n.x;
+
+    result += sh[4].rgb * 1.092548431 * n.x * n.y;
+    result += sh[5].rgb * 1.092548431 * n.y * n.z;
+    result += sh[6].rgb * 0.315391565 * (3.0 * n.z * n.z - 1.0);
+    result += sh[7].rgb * 1.092548431 * n.x * n.z;
+    result += sh[8].rgb * 0.546274215 * (n.x * n.x - n.y * n.y);
+
+    return max(result, vec3(0.0));
+}
+
+// trilinearly interpolated probes of the irradiance volume, each 
+// coefficient is a slab of probes stacked along z
+vec3 _sampleIrradianceVolume(in sampler3D volume, in vec3 positionWS, in vec3 n)
+{
+    vec3 resolution = _volumeResolution.xyz;
+    vec3 extent = max(_volumeMax.xyz - _volumeMin.xyz, vec3(1e-4));
+    vec3 local = clamp((positionWS - _volumeMin.xyz) / extent, 0.0, 1.0);
+
+    // between the outermost texel centers, filtering never reaches the next slab
+    vec3 texel = local * (resolution - 1.0) + 0.5;
+
+    vec4 sh[9];
+    for (int i = 0; i < 9; ++i)
+    {
+        vec3 uvw = vec3(texel.xy / resolution.xy, (texel.z + i * resolution.z) / (resolution.z * 9.0));
+        sh[i] = texture(volume, uvw);
+    }
+
+    return _evaluateSH9(sh, n);
+}
@@ -0,0 +1,45 @@
+//? #version 450 core
+
+//-----------------------------------------------
+//            HARDWARE INSTANCING
+//-----------------------------------------------
+
+struct _InstanceData
+{
+    mat4 modelToWorld;
+    mat4 normalToWorld;
+};
+
+// binding has to match InstanceBatch::BINDING_POINT
+layout(std430, binding = 0) readonly buffer InstanceSSBO
+{
+    _InstanceData _instances[];
+};
+
+// set by the renderer for instanced draw calls
+uniform int _instanced = 0;
+
+// set by the renderer for layered draw calls, every 
+// instance is drawn once per layer
+uniform int _layerCount = 1;
+
+int _instanceIndex()
+{
+    return gl_InstanceID / _layerCount;
+}
+
+// layer to write to gl_Layer
+int _instanceLayer()
+{
+    return gl_InstanceID % _layerCount;
+}
+
+mat4 _instanceModelToWorld(in mat4 modelToWorld)
+{
+    return _instanced != 0 ? _instances[_instanceIndex()].modelToWorld : modelToWorld;
+}
+
+mat4 _instanceNormalToWorld(in mat4 normalToWorld)
+{
+    return _instanced != 0 ? _instances[_instanceIndex()].normalToWorld : normalToWorld;
+}
@@ -133,4 +133,4 @@ vec3 _importanceSampleGGX(vec2 Xi, vec3 N, float r)
 
     vec3 sampleVec = tangent * H.x + bitangent * H.y + N * H.z;
     return normalize(sampleVec);
-}
\ No newline at end of file
+}
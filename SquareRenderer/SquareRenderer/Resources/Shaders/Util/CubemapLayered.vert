@@ -0,0 +1,28 @@
+#version 450 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+
+#pragma include ../Includes/Instancing.glsl //! #include "../Includes/Instancing.glsl"
+
+//-----------------------------------------------
+// LAYERED CUBEMAP VERTEX SHADER: ONE INSTANCE PER FACE
+//-----------------------------------------------
+
+layout (location = 0) in vec3 vPosition;
+
+uniform mat4 VP[6];
+
+// same output as Cubemap.geom
+out vec4 FragPos;
+
+void main()
+{
+    const int face = _instanceLayer();
+
+    // only used if the extension is supported, see GraphicsAPI::supportsVertexLayer
+#ifdef GL_ARB_shader_viewport_layer_array
+    gl_Layer = face;
+#endif
+
+    FragPos = vec4(vPosition, 1.0);
+    gl_Position = VP[face] * FragPos;
+}
@@ -6,16 +6,17 @@ in vec4 FragPos;
 out vec4 Irradiance;
 
 uniform samplerCube hdri;
+uniform float sampleDelta;
 
 vec3 Convolution(vec3 normal)
 {
     vec3 irr = vec3(0.0);  
 
-    vec3 up    = vec3(0.0, 1.0, 0.0);
-    vec3 right = cross(up, normal);
+    // same frame as IBLBaker::diffuseIrradiance
+    vec3 up    = abs(normal.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(up, normal));
     up         = cross(normal, right);
 
-    float sampleDelta = 0.025;
     float nrSamples = 0.0; 
     for(float phi = 0.0; phi < 2.0 * PI; phi += sampleDelta)
     {
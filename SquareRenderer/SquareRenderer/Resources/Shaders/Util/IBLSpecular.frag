@@ -1,55 +1,44 @@
 #version 330 core
 
-#pragma include ../Includes/Globals.glsl //! #include "../Includes/Globals.glsl"
-#pragma include ../Includes/Sampling.glsl //! #include "../Includes/Sampling.glsl"
-#pragma include ../Includes/PBR.glsl //! #include "../Includes/PBR.glsl"
+//-----------------------------------------------
+// SPECULAR PREFILTER: FILTERED IMPORTANCE SAMPLING
+//-----------------------------------------------
+
+layout(std140) uniform PrefilterUBO
+{
+    int _sampleCount;
+
+    // light directions around the normal, source mip in w,
+    // see ImportanceSampling::prefilterSamples
+    vec4 _samples[512];
+};
 
 in vec4 FragPos;
 out vec4 Irradiance;
 
-uniform float resolution;
-uniform float roughness;
 uniform samplerCube hdri;
 
 void main()
 {		
-    vec3 N = normalize(FragPos.xyz);    
-    vec3 R = N;
-    vec3 V = R;
+    vec3 N = normalize(FragPos.xyz);
 
-     float res = resolution * 2; // unclear why needed
+    // view and reflection along the normal, the samples only need rotating
+    vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
 
-    const uint SAMPLE_COUNT = 2048u;
     float totalWeight = 0.0;   
     vec3 prefilteredColor = vec3(0.0);     
-    for(uint i = 0u; i < SAMPLE_COUNT; ++i)
+    for(int i = 0; i < _sampleCount; ++i)
     {
-        vec2 Xi = _hammersley(i, SAMPLE_COUNT);
-        vec3 H  = _importanceSampleGGX(Xi, N, roughness);
-        vec3 L  = normalize(2.0 * dot(V, H) * H - V);
-
-        float NdotL = max(dot(N, L), 0.0);
-        if(NdotL > 0.0)
-        {
-            // start reduce sample artifacts
-            float D         = _distributionGGX(N, H, roughness);
-            float NdotH     = max(dot(N, H), 0.0);
-            float HdotV     = max(dot(H, V), 0.0);
-            float pdf       = D * NdotH / (4.0 * HdotV) + 0.0001; 
-
-            float saTexel   = 4.0 * PI / (6.0 * res * res);
-            float saSample  = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.00001);
-
-            float mipLevel = roughness == 0.0 ? 0.0 : 0.5 * log2(saSample / saTexel); 
-            prefilteredColor += textureLod(hdri, L, mipLevel).rgb * NdotL;
-            //end reduce sample artifacts
-
-            //prefilteredColor += texture(environmentMap, L).rgb * NdotL;
-            
-            totalWeight      += NdotL;
-        }
+        vec4 s = _samples[i];
+        vec3 L = tangent * s.x + bitangent * s.y + N * s.z;
+
+        // NdotL weighted
+        prefilteredColor += textureLod(hdri, L, s.w).rgb * s.z;
+        totalWeight += s.z;
     }
     prefilteredColor = prefilteredColor / max(totalWeight, 0.001f);
 
     Irradiance = vec4(prefilteredColor, 1.0);
-}  
\ No newline at end of file
+}
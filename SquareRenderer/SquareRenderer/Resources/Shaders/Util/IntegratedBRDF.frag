@@ -7,6 +7,8 @@
 in vec2 TexCoords;
 out vec2 FragColor;
 
+uniform int sampleCount;
+
 vec2 IntegrateBRDF(float NdotV, float roughness)
 {
     vec3 V;
@@ -19,7 +21,7 @@ vec2 IntegrateBRDF(float NdotV, float roughness)
 
     vec3 N = vec3(0.0, 0.0, 1.0);
 
-    const uint SAMPLE_COUNT = 1024u;
+    uint SAMPLE_COUNT = uint(sampleCount);
     for(uint i = 0u; i < SAMPLE_COUNT; ++i)
     {
         // generates a sample vector that's biased towards the
@@ -1,5 +1,7 @@
 #version 450 core
 
+#pragma include ../Includes/Instancing.glsl //! #include "../Includes/Instancing.glsl"
+
 layout (location = 0) in vec3 vPosition;
 //layout (location = 1) in vec2 vUVs;
 
@@ -11,5 +13,5 @@ layout (location = 1) uniform mat4 worldToLight;
 void main()
 {
     //uvs = vUVs;
-    gl_Position = worldToLight * modelToWorld * vec4(vPosition, 1.0);
+    gl_Position = worldToLight * _instanceModelToWorld(modelToWorld) * vec4(vPosition, 1.0);
 } 
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 450 core
+
+in vec2 uv;
+
+layout (location = 0) out vec4 OutputFeedback;
+
+// index of the drawable, 0 marks the background
+uniform float feedbackId = 0;
+
+void main()
+{
+    // footprint of the pixel in uv space, the texture size 
+    // is applied on readback to get the mip level
+    vec2 dx = dFdx(uv);
+    vec2 dy = dFdy(uv);
+    float footprint = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-20));
+
+    OutputFeedback = vec4(feedbackId, footprint, 0, 1);
+}
@@ -0,0 +1,17 @@
+#version 450 core
+
+#pragma include ../Includes/Camera.glsl //! #include "../Includes/Camera.glsl"
+#pragma include ../Includes/Instancing.glsl //! #include "../Includes/Instancing.glsl"
+
+layout (location = 0) in vec3 vPosition;
+layout (location = 1) in vec2 vUV;
+
+out vec2 uv;
+
+uniform mat4 modelToWorld = mat4(1);
+
+void main() 
+{
+    uv = vUV;
+    gl_Position = _VP * _instanceModelToWorld(modelToWorld) * vec4(vPosition, 1.0);
+}
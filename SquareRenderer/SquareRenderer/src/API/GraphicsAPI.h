@@ -1,8 +1,11 @@
 #pragma once
 
 #include "Common/Macros.h"
+#include "Texture/TextureDefines.h"
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 DECLARE_PTRS(GraphicsAPI);
 DECLARE_PTRS(GPUTimer);
@@ -11,8 +14,16 @@ DECLARE_PTRS(IGeometry);
 DECLARE_PTRS(ShaderSource);
 DECLARE_PTRS(ShaderProgram);
 DECLARE_PTRS(ITexture);
+DECLARE_PTRS(Texture2D);
+DECLARE_PTRS(Cubemap);
 DECLARE_PTRS(RenderTarget);
 DECLARE_PTRS(IUniformBlockData);
+DECLARE_PTRS(InstanceBuffer);
+DECLARE_PTRS(IRenderTarget);
+DECLARE_PTRS(GPUReadback);
+
+class GLPixelUploadRing;
+class GLSamplerCache;
 
 class GPUTimer
 {
@@ -27,6 +38,24 @@ private:
 	unsigned int m_handle;
 };
 
+// asynchronous copy of the first color attachment of a render target
+class GPUReadback
+{
+public:
+	GPUReadback();
+	~GPUReadback();
+	// RGBA float pixels, false while the previous request is in flight
+	bool request(IRenderTargetSPtr source);
+	// true once the pixels of the last request arrived
+	bool fetch(std::vector<float>& outPixels, int& outWidth, int& outHeight);
+private:
+	unsigned int m_buffer = 0;
+	size_t m_size = 0;
+	void* m_fence = nullptr;
+	int m_width = 0;
+	int m_height = 0;
+};
+
 class GraphicsAPI
 {
 public:
@@ -43,6 +72,30 @@ public:
 
 	bool allocate(IUniformBlockDataSPtr uniformBlockData);
 
+	bool allocate(InstanceBufferSPtr instanceBuffer);
+
+	enum class UploadStatus
+	{
+		Complete,
+		Deferred,	// upload ring still in use by the GPU, retry later
+		Failed
+	};
+
+	// changes the finest allocated level of a linked texture,
+	// keeps the resident levels both storages share
+	bool reallocate(Texture2DSPtr texture, int storageLevel);
+
+	// copies a mip level through a ring of pixel unpack buffers,
+	// allocates the texture on first use
+	UploadStatus upload(Texture2DSPtr texture, int level, const void* data, size_t size);
+
+	// copies a level back to host memory in the upload layout,
+	// stalls until the GPU finished writing it
+	bool download(Texture2DSPtr texture, int level, std::vector<uint8_t>& outPixels);
+
+	// six faces in +X, -X, +Y, -Y, +Z, -Z order
+	bool download(CubemapSPtr cubemap, int level, std::vector<uint8_t>& outPixels);
+
 	struct Result
 	{
 		bool success;
@@ -53,6 +106,10 @@ public:
 
 	Result compile(ShaderProgramSPtr program);
 
+	// gl_Layer may be written from the vertex shader, layered targets 
+	// are rendered with instancing instead of a geometry shader
+	bool supportsVertexLayer() const;
+
 	static GraphicsAPISPtr create();
 
 	static bool checkError(const char* file, int line);
@@ -66,6 +123,13 @@ public:
 protected:
 
 	Result compile(ShaderSourceSPtr shader);
+
+	// shared sampler object of all textures with equal settings
+	unsigned int samplerFor(const TextureSampler& sampler, TextureFormat format);
+
+	std::unique_ptr<GLPixelUploadRing> m_uploadRing;
+
+	std::unique_ptr<GLSamplerCache> m_samplerCache;
 };
 
 #define GraphicsAPICheckError() GraphicsAPI::checkError(__FILE__, __LINE__) 
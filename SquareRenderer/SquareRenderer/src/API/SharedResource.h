@@ -10,6 +10,7 @@ DECLARE_PTRS(IGeometryResource);
 DECLARE_PTRS(IShaderResource);
 DECLARE_PTRS(IShaderProgramResource);
 DECLARE_PTRS(IUniformBlockResource);
+DECLARE_PTRS(IStorageBufferResource);
 DECLARE_PTRS(IRenderTargetResource);
 DECLARE_PTRS(IDepthBufferResource);
 
@@ -54,13 +55,33 @@ public:
 	virtual void unbind() = 0;
 };
 
+class IStorageBufferResource : public IBindableResource
+{
+public:
+
+	virtual int bindingPoint() const = 0;
+
+	virtual bool update(const void* data, size_t size) = 0;
+};
+
 class ITextureResource : public SharedResource
 {
 public:
 
-	virtual void update(int width, int height, 
+	// replaces the pixels of an allocated level, data is interpreted 
+	// as offset while a pixel unpack buffer is bound,
+	// cubemaps expect all six faces one after another
+	virtual void updateLevel(int level, int width, int height,
 		const void* data) = 0;
 
+	virtual void generateMipmaps() = 0;
+
+	// levels above are not sampled, used while they are not resident
+	virtual void setBaseLevel(int level) = 0;
+
+	// sampler object shared with other textures, bound next to the texture
+	virtual Handle sampler() const = 0;
+
 };
 
 class IGeometryResource : public IBindableResource
@@ -83,6 +104,13 @@ public:
 
 class IRenderTargetResource : public SharedResource
 {
+public:
+
+	// reattaches the color targets at another mip level
+	virtual void setLevel(int level) = 0;
+
+	// attaches a single layer of layered color targets, all of them if negative
+	virtual void setLayer(int layer) = 0;
 };
 
 class IDepthBufferResource : public SharedResource
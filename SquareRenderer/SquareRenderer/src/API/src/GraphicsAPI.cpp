@@ -10,8 +10,11 @@
 #include "Material/ShaderProgram.h"
 #include "Texture/Texture2D.h"
 #include "Texture/Cubemap.h"
+#include "Texture/Texture3D.h"
+#include "Texture/MipChain.h"
 #include "Renderer/RenderTarget.h"
 #include "Renderer/DepthBuffer.h"
+#include "Renderer/InstanceBuffer.h"
 #include "Renderer/UniformBlockData.h"
 
 #include <glad/glad.h>
@@ -20,12 +23,28 @@
 // TODO check if it must be included adter GLFW?
 #include "Common/Math3D.h"
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+// S3TC is an extension to core GL
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT         0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT        0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT        0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT  0x8C4F
+#endif
+
 struct GLTextureFormat
 {
     GLint internalFormat = 0;
     GLint dataFormat = 0;
     GLint dataType = 0;
     size_t internalBPC = 0;
+    bool compressed = false;
 };
 
 void glfwErrorHandler(int errorCode, const char* description)
@@ -40,23 +59,33 @@ constexpr size_t FLOAT_SIZE = 4;
 static const std::unordered_map<TextureFormat, GLTextureFormat> s_texFormatToGL =
 {
     { TextureFormat::R,             { GL_R8,            GL_RED,     GL_UNSIGNED_BYTE,   CHAR_SIZE } },
-    { TextureFormat::RHalf,         { GL_R16F,          GL_RED,     GL_FLOAT,           HALF_SIZE } },
+    { TextureFormat::RHalf,         { GL_R16F,          GL_RED,     GL_HALF_FLOAT,      HALF_SIZE } },
     { TextureFormat::RFloat,        { GL_R32F,          GL_RED,     GL_FLOAT,           FLOAT_SIZE } },
     { TextureFormat::RG,            { GL_RG8,           GL_RG,      GL_UNSIGNED_BYTE,   CHAR_SIZE * 2 } },
-    { TextureFormat::RGHalf,        { GL_RG16F,         GL_RG,      GL_FLOAT,           HALF_SIZE * 2 } },
+    { TextureFormat::RGHalf,        { GL_RG16F,         GL_RG,      GL_HALF_FLOAT,      HALF_SIZE * 2 } },
     { TextureFormat::RGFloat,       { GL_RG32F,         GL_RG,      GL_FLOAT,           FLOAT_SIZE * 2 } },
     { TextureFormat::RGB,           { GL_RGB8,          GL_RGB,     GL_UNSIGNED_BYTE,   CHAR_SIZE * 3 } },
-    { TextureFormat::RGBHalf,       { GL_RGB16F,        GL_RGB,     GL_FLOAT,           HALF_SIZE * 3 } },
+    { TextureFormat::RGBHalf,       { GL_RGB16F,        GL_RGB,     GL_HALF_FLOAT,      HALF_SIZE * 3 } },
     { TextureFormat::RGBFloat,      { GL_RGB32F,        GL_RGB,     GL_FLOAT,           FLOAT_SIZE * 3 } },
     { TextureFormat::RGBA,          { GL_RGBA8,         GL_RGBA,    GL_UNSIGNED_BYTE,   CHAR_SIZE * 4 } },
-    { TextureFormat::RGBAHalf,      { GL_RGBA16F,       GL_RGBA,    GL_FLOAT,           HALF_SIZE * 4 } },
+    { TextureFormat::RGBAHalf,      { GL_RGBA16F,       GL_RGBA,    GL_HALF_FLOAT,      HALF_SIZE * 4 } },
     { TextureFormat::RGBAFloat,     { GL_RGBA32F,       GL_RGBA,    GL_FLOAT,           FLOAT_SIZE * 4 } },
     { TextureFormat::SRGB,          { GL_SRGB8,         GL_RGB,     GL_UNSIGNED_BYTE,   CHAR_SIZE * 3 } },
     { TextureFormat::SRGBA,         { GL_SRGB8_ALPHA8,  GL_RGBA,    GL_UNSIGNED_BYTE,   CHAR_SIZE * 4 } },
-    { TextureFormat::DepthHalf,     { GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_FLOAT, FLOAT_SIZE } },
-    { TextureFormat::ShadowMapHalf, { GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_FLOAT, FLOAT_SIZE } },
-    { TextureFormat::DepthFloat,    { GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_FLOAT, FLOAT_SIZE } },
-    { TextureFormat::ShadowMapFloat,{ GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_FLOAT, FLOAT_SIZE } }
+    { TextureFormat::RGB9E5,        { GL_RGB9_E5,       GL_RGB,     GL_UNSIGNED_INT_5_9_9_9_REV, CHAR_SIZE * 4 } },
+    { TextureFormat::DepthHalf,     { GL_DEPTH_COMPONENT24,  GL_DEPTH_COMPONENT, GL_FLOAT, FLOAT_SIZE } },
+    { TextureFormat::ShadowMapHalf, { GL_DEPTH_COMPONENT24,  GL_DEPTH_COMPONENT, GL_FLOAT, FLOAT_SIZE } },
+    { TextureFormat::DepthFloat,    { GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, FLOAT_SIZE } },
+    { TextureFormat::ShadowMapFloat,{ GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, FLOAT_SIZE } },
+    { TextureFormat::BC1,           { GL_COMPRESSED_RGB_S3TC_DXT1_EXT,          0, 0, 0, true } },
+    { TextureFormat::BC1SRGB,       { GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,         0, 0, 0, true } },
+    { TextureFormat::BC3,           { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,         0, 0, 0, true } },
+    { TextureFormat::BC3SRGB,       { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,   0, 0, 0, true } },
+    { TextureFormat::BC4,           { GL_COMPRESSED_RED_RGTC1,                  0, 0, 0, true } },
+    { TextureFormat::BC5,           { GL_COMPRESSED_RG_RGTC2,                   0, 0, 0, true } },
+    { TextureFormat::BC7,           { GL_COMPRESSED_RGBA_BPTC_UNORM,            0, 0, 0, true } },
+    { TextureFormat::BC7SRGB,       { GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,      0, 0, 0, true } },
+    { TextureFormat::BC6H,          { GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT,    0, 0, 0, true } }
 };
 
 class GLIndexedVertexArray : public IGeometryResource
@@ -499,21 +528,110 @@ private:
     size_t m_size;
 };
 
-class GLTexture2DResource : public ITextureResource
+class GLShaderStorageBuffer : public IStorageBufferResource
 {
 public:
+    GLShaderStorageBuffer(int bindingPoint, const void* data, size_t size)
+        : m_bindingPoint(bindingPoint)
+        , m_size(size)
+    {
+        GLuint handle;
+        glGenBuffers(1, &handle);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, handle);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_size, data, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        if (GraphicsAPICheckError())
+        {
+            m_handle = static_cast<Handle>(handle);
+        }
+    }
 
-    GLTexture2DResource(const Texture2D& texture, const void* data = nullptr)
+    int bindingPoint() const override
     {
-        const auto& found = s_texFormatToGL.find(texture.format());
-        if (found == s_texFormatToGL.end())
+        return m_bindingPoint;
+    }
+
+    bool update(const void* data, size_t size) override
+    {
+        if (isValid())
         {
-            return;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, handle());
+            if (size > m_size)
+            {
+                // grow storage, orphans the old buffer
+                m_size = size;
+                glBufferData(GL_SHADER_STORAGE_BUFFER, m_size, data, GL_DYNAMIC_DRAW);
+            }
+            else
+            {
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data);
+            }
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+            return GraphicsAPICheckError();
+        }
+
+        return false;
+    }
+
+    void bind() override
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_bindingPoint, handle());
+    }
+
+    void unbind() override
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, m_bindingPoint, 0);
+    }
+
+    ~GLShaderStorageBuffer()
+    {
+        if (isValid())
+        {
+            const GLuint handle = static_cast<GLuint>(m_handle);
+            glDeleteBuffers(1, &handle);
+            m_handle = INVALID_HANDLE;
+        }
+    }
+private:
+
+    int m_bindingPoint;
+    size_t m_size;
+};
+
+// sampler objects shared by all textures with the same sampler settings,
+// the texture objects only hold storage and level range
+class GLSamplerCache
+{
+public:
+
+    ~GLSamplerCache()
+    {
+        for (const Entry& entry : m_entries)
+        {
+            glDeleteSamplers(1, &entry.handle);
+        }
+    }
+
+    GLuint acquire(const TextureSampler& sampler, bool compare)
+    {
+        // only a handful of distinct samplers exist per scene
+        for (const Entry& entry : m_entries)
+        {
+            if (entry.compare == compare &&
+                entry.sampler.filter == sampler.filter &&
+                entry.sampler.wrap == sampler.wrap &&
+                entry.sampler.mipmapping == sampler.mipmapping &&
+                entry.sampler.borderColor == sampler.borderColor)
+            {
+                return entry.handle;
+            }
         }
-        m_format = found->second;
 
-        GLuint textureWrap;
-        switch (texture.sampler().wrap)
+        GLint textureWrap;
+        switch (sampler.wrap)
         {
         case TextureWrap::Mirror:
             textureWrap = GL_MIRRORED_REPEAT;
@@ -530,9 +648,9 @@ public:
             break;
         }
 
-        GLuint textureMinFilter;
-        GLuint textureMaxFilter;
-        switch (texture.sampler().filter)
+        GLint textureMinFilter;
+        GLint textureMaxFilter;
+        switch (sampler.filter)
         {
         case TextureFilter::Nearest:
             textureMinFilter = GL_NEAREST_MIPMAP_NEAREST;
@@ -545,58 +663,98 @@ public:
             break;
         }
 
-        if (!texture.sampler().mipmapping)
+        if (!sampler.mipmapping)
         {
             textureMinFilter = textureMaxFilter;
         }
 
-        unsigned int handle;
-        glGenTextures(1, &handle);
-        glBindTexture(GL_TEXTURE_2D, handle);
+        GLuint handle;
+        glCreateSamplers(1, &handle);
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, textureWrap);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, textureWrap);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, textureMinFilter);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, textureMaxFilter);
+        glSamplerParameteri(handle, GL_TEXTURE_WRAP_S, textureWrap);
+        glSamplerParameteri(handle, GL_TEXTURE_WRAP_T, textureWrap);
+        glSamplerParameteri(handle, GL_TEXTURE_WRAP_R, textureWrap);
+        glSamplerParameteri(handle, GL_TEXTURE_MIN_FILTER, textureMinFilter);
+        glSamplerParameteri(handle, GL_TEXTURE_MAG_FILTER, textureMaxFilter);
 
         // Enable hardware shadow anti aliasing
-        if (texture.format() == TextureFormat::ShadowMapHalf || 
-            texture.format() == TextureFormat::ShadowMapFloat)
+        if (compare)
         {
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+            glSamplerParameteri(handle, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
         }
 
-        if (texture.sampler().wrap == TextureWrap::ClampToBorder)
+        if (sampler.wrap == TextureWrap::ClampToBorder)
         {
-            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, 
-                glm::value_ptr(texture.sampler().borderColor));
+            glSamplerParameterfv(handle, GL_TEXTURE_BORDER_COLOR,
+                glm::value_ptr(sampler.borderColor));
         }
 
-        glTexImage2D(GL_TEXTURE_2D, 
-            0, 
-            m_format.internalFormat,
-            texture.width(), 
-            texture.height(), 
-            0, 
-            m_format.dataFormat, 
-            m_format.dataType,
-            data);
+        m_entries.push_back({ sampler, compare, handle });
 
-        if (texture.sampler().mipmapping)
-        {
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
+        return handle;
+    }
 
-        if (GraphicsAPICheckError())
+    static bool isShadowMap(TextureFormat format)
+    {
+        return format == TextureFormat::ShadowMapHalf ||
+            format == TextureFormat::ShadowMapFloat;
+    }
+
+private:
+
+    struct Entry
+    {
+        TextureSampler sampler;
+        bool compare;
+        GLuint handle;
+    };
+
+    std::vector<Entry> m_entries;
+};
+
+class GLTexture2DResource : public ITextureResource
+{
+public:
+
+    GLTexture2DResource(const Texture2D& texture, GLuint sampler, const void* data = nullptr)
+        : m_sampler(sampler)
+    {
+        const auto& found = s_texFormatToGL.find(texture.format());
+        if (found == s_texFormatToGL.end())
         {
-            m_handle = static_cast<SharedResource::Handle>(handle);
+            return;
         }
-        else
+        m_format = found->second;
+        m_textureFormat = texture.format();
+
+        // levels above the storage level are not allocated
+        const int storageLevel = texture.storageLevel();
+        const int width = std::max(1, texture.width() >> storageLevel);
+        const int height = std::max(1, texture.height() >> storageLevel);
+        const int levelCount = texture.levelCount() - storageLevel;
+
+        // immutable storage, every level is complete from the start
+        GLuint handle;
+        glCreateTextures(GL_TEXTURE_2D, 1, &handle);
+        glTextureStorage2D(handle, levelCount, m_format.internalFormat, width, height);
+
+        if (!GraphicsAPICheckError())
         {
             glDeleteTextures(1, &handle);
+            return;
         }
+        m_handle = static_cast<SharedResource::Handle>(handle);
+
+        if (data)
+        {
+            updateLevel(0, width, height, data);
 
-        glBindTexture(GL_TEXTURE_2D, 0);
+            // compressed levels cannot be generated, they come from the importer
+            if (levelCount > 1)
+            {
+                generateMipmaps();
+            }
+        }
     }
 
     ~GLTexture2DResource()
@@ -609,26 +767,60 @@ public:
         }
     }
 
-    void update(int width, int height, const void* data) override
+    void updateLevel(int level, int width, int height, const void* data) override
+    {
+        const GLuint handle = static_cast<GLuint>(m_handle);
+        if (m_format.compressed)
+        {
+            glCompressedTextureSubImage2D(handle, level, 0, 0, width, height, m_format.internalFormat,
+                static_cast<GLsizei>(MipChain::levelSize(m_textureFormat, width, height)), data);
+        }
+        else
+        {
+            // decoded images are tightly packed
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTextureSubImage2D(handle, level, 0, 0, width, height,
+                m_format.dataFormat, m_format.dataType, data);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+    }
+
+    void generateMipmaps() override
+    {
+        // all compressed levels come from the importer
+        if (m_format.compressed)
+        {
+            return;
+        }
+
+        glGenerateTextureMipmap(static_cast<GLuint>(m_handle));
+    }
+
+    // base level is texture state, the bound sampler object does not override it
+    void setBaseLevel(int level) override
     {
-        // TODO use glTexSubImage2D if dimensions stay the same and only data changes
-        glBindTexture(GL_TEXTURE_2D, m_handle);
-        glTexImage2D(GL_TEXTURE_2D, 0, m_format.internalFormat,
-            width, height, 0, m_format.dataFormat, m_format.dataType, 
-            data);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        glTextureParameteri(static_cast<GLuint>(m_handle), GL_TEXTURE_BASE_LEVEL, level);
+    }
+
+    Handle sampler() const override
+    {
+        return static_cast<Handle>(m_sampler);
     }
 
 private:
 
     GLTextureFormat m_format;
 
+    TextureFormat m_textureFormat = TextureFormat::RGBA;
+
+    GLuint m_sampler = 0;
 };
 
 class GLCubemapResource : public ITextureResource
 {
 public:
-    GLCubemapResource(const Cubemap& texture, const void* data = nullptr)
+    GLCubemapResource(const Cubemap& texture, GLuint sampler, const void* data = nullptr)
+        : m_sampler(sampler)
     {
         const auto& found = s_texFormatToGL.find(texture.format());
         if (found == s_texFormatToGL.end())
@@ -637,102 +829,110 @@ public:
         }
         m_format = found->second;
 
-        GLuint textureWrap;
-        switch (texture.sampler().wrap)
+        const int levelCount = texture.levelCount();
+
+        GLuint handle;
+        glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &handle);
+        glTextureStorage2D(handle, levelCount, m_format.internalFormat, 
+            texture.width(), texture.height());
+
+        if (!GraphicsAPICheckError())
         {
-        case TextureWrap::Mirror:
-            textureWrap = GL_MIRRORED_REPEAT;
-            break;
-        case TextureWrap::ClampToBorder:
-            textureWrap = GL_CLAMP_TO_BORDER;
-            break;
-        case TextureWrap::ClampToEdge:
-            textureWrap = GL_CLAMP_TO_EDGE;
-            break;
-        case TextureWrap::Repeat:
-        default:
-            textureWrap = GL_REPEAT;
-            break;
+            glDeleteTextures(1, &handle);
+            return;
         }
+        m_handle = static_cast<SharedResource::Handle>(handle);
 
-        GLuint textureMinFilter;
-        GLuint textureMaxFilter;
-        switch (texture.sampler().filter)
+        // upload cubemap texture data, six faces
+        if (data)
         {
-        case TextureFilter::Nearest:
-            textureMinFilter = GL_NEAREST_MIPMAP_NEAREST;
-            textureMaxFilter = GL_NEAREST;
-            break;
-        case TextureFilter::Linear:
-        default:
-            textureMinFilter = GL_LINEAR_MIPMAP_LINEAR;
-            textureMaxFilter = GL_LINEAR;
-            break;
+            updateLevel(0, texture.width(), texture.height(), data);
+
+            if (levelCount > 1)
+            {
+                generateMipmaps();
+            }
         }
+    }
 
-        if (!texture.sampler().mipmapping)
+    ~GLCubemapResource()
+    {
+        if (isValid())
         {
-            textureMinFilter = textureMaxFilter;
+            const GLuint handle = static_cast<GLuint>(m_handle);
+            glDeleteTextures(1, &handle);
+            m_handle = INVALID_HANDLE;
         }
+    }
 
-        unsigned int handle;
-        glGenTextures(1, &handle);
-        glBindTexture(TARGET_TYPE, handle);
+    void updateLevel(int level, int width, int height, const void* data) override
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        glTexParameteri(TARGET_TYPE, GL_TEXTURE_WRAP_S, textureWrap);
-        glTexParameteri(TARGET_TYPE, GL_TEXTURE_WRAP_T, textureWrap);
-        //if (TARGET_TYPE == GL_TEXTURE_CUBE_MAP)
-        {
-            glTexParameteri(TARGET_TYPE, GL_TEXTURE_WRAP_R, textureWrap);
-        }
-        glTexParameteri(TARGET_TYPE, GL_TEXTURE_MIN_FILTER, textureMinFilter);
-        glTexParameteri(TARGET_TYPE, GL_TEXTURE_MAG_FILTER, textureMaxFilter);
+        // faces are the layers of the cubemap, uploaded at once
+        glTextureSubImage3D(static_cast<GLuint>(m_handle),
+            level, 0, 0, 0, width, height, 6,
+            m_format.dataFormat, m_format.dataType, data);
 
-        // Enable hardware shadow anti aliasing
-        if (texture.format() == TextureFormat::ShadowMapHalf ||
-            texture.format() == TextureFormat::ShadowMapFloat)
-        {
-            glTexParameteri(TARGET_TYPE, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
-        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
 
-        if (texture.sampler().wrap == TextureWrap::ClampToBorder)
-        {
-            glTexParameterfv(TARGET_TYPE, GL_TEXTURE_BORDER_COLOR,
-                glm::value_ptr(texture.sampler().borderColor));
-        }
+    void generateMipmaps() override
+    {
+        glGenerateTextureMipmap(static_cast<GLuint>(m_handle));
+    }
 
-        // upload cubemap texture data
-        for (int side = 0; side < 6; ++side)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + side,
-                0, 
-                m_format.internalFormat, 
-                texture.width(),
-                texture.height(),
-                0,
-                m_format.dataFormat, 
-                m_format.dataType, 
-                data);
-        }
+    // base level is texture state, the bound sampler object does not override it
+    void setBaseLevel(int level) override
+    {
+        glTextureParameteri(static_cast<GLuint>(m_handle), GL_TEXTURE_BASE_LEVEL, level);
+    }
 
-        if (texture.sampler().mipmapping)
-        {
-            glGenerateMipmap(TARGET_TYPE);
-        }
+    Handle sampler() const override
+    {
+        return static_cast<Handle>(m_sampler);
+    }
 
-        if (GraphicsAPICheckError())
+private:
+
+    GLTextureFormat m_format;
+
+    GLuint m_sampler = 0;
+};
+
+class GLTexture3DResource : public ITextureResource
+{
+public:
+    GLTexture3DResource(const Texture3D& texture, GLuint sampler, const void* data = nullptr)
+        : m_sampler(sampler)
+        , m_depth(texture.layers())
+    {
+        const auto& found = s_texFormatToGL.find(texture.format());
+        if (found == s_texFormatToGL.end() || found->second.compressed)
         {
-            m_handle = static_cast<SharedResource::Handle>(handle);
+            return;
         }
-        else
+        m_format = found->second;
+
+        GLuint handle;
+        glCreateTextures(GL_TEXTURE_3D, 1, &handle);
+        glTextureStorage3D(handle, 1, m_format.internalFormat,
+            texture.width(), texture.height(), m_depth);
+
+        if (!GraphicsAPICheckError())
         {
             glDeleteTextures(1, &handle);
+            return;
         }
+        m_handle = static_cast<SharedResource::Handle>(handle);
 
-        glBindTexture(TARGET_TYPE, 0);
+        if (data)
+        {
+            updateLevel(0, texture.width(), texture.height(), data);
+        }
     }
 
-    ~GLCubemapResource()
+    ~GLTexture3DResource()
     {
         if (isValid())
         {
@@ -742,35 +942,46 @@ public:
         }
     }
 
-    void update(int width, int height, const void* data) override
+    void updateLevel(int level, int width, int height, const void* data) override
     {
-        // TODO use glTexSubImage2D if dimensions stay the same and only data changes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        glBindTexture(TARGET_TYPE, m_handle);
+        // all slices at once
+        glTextureSubImage3D(static_cast<GLuint>(m_handle),
+            level, 0, 0, 0, width, height, std::max(1, m_depth >> level),
+            m_format.dataFormat, m_format.dataType, data);
 
-        // upload cubemap texture data
-        for (int side = 0; side < 6; ++side)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + side, 
-                0, m_format.internalFormat, width, height, 0, 
-                m_format.dataFormat, m_format.dataType, data);
-        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
 
-        glBindTexture(GL_TEXTURE_2D, m_handle);
+    void generateMipmaps() override
+    {
     }
 
-private:
+    void setBaseLevel(int) override
+    {
+    }
+
+    Handle sampler() const override
+    {
+        return static_cast<Handle>(m_sampler);
+    }
 
-    static const GLenum TARGET_TYPE = GL_TEXTURE_CUBE_MAP;
+private:
 
     GLTextureFormat m_format;
 
+    GLuint m_sampler = 0;
+
+    int m_depth = 1;
 };
 
 class GLFramebuffer : public IRenderTargetResource
 {
 public:
     GLFramebuffer(const RenderTarget& rendertarget)
+        : m_level(rendertarget.level())
+        , m_layer(rendertarget.layer())
     {
         unsigned int handle;
         glGenFramebuffers(1, &handle);
@@ -779,6 +990,8 @@ public:
         GLenum attachement = GL_COLOR_ATTACHMENT0;
         for (ITextureSPtr att : rendertarget.colorTargets())
         {
+            m_colorAttachments.push_back(static_cast<GLuint>(att->handle()));
+
             switch (att->layout())
             {
             case TextureLayout::Texture2D:
@@ -787,9 +1000,19 @@ public:
                     att->handle(), rendertarget.level());
                 break;
             case TextureLayout::Cubemap:
-                glFramebufferTexture(GL_FRAMEBUFFER,
-                    attachement, att->handle(),
-                    rendertarget.level());
+            case TextureLayout::Texture3D:
+                if (rendertarget.layer() < 0)
+                {
+                    glFramebufferTexture(GL_FRAMEBUFFER,
+                        attachement, att->handle(),
+                        rendertarget.level());
+                }
+                else
+                {
+                    glFramebufferTextureLayer(GL_FRAMEBUFFER,
+                        attachement, att->handle(),
+                        rendertarget.level(), rendertarget.layer());
+                }
                 break;
             }
 
@@ -845,6 +1068,45 @@ public:
             m_handle = INVALID_HANDLE;
         }
     }
+
+    void setLevel(int level) override
+    {
+        m_level = level;
+        reattach();
+    }
+
+    void setLayer(int layer) override
+    {
+        m_layer = layer;
+        reattach();
+    }
+
+private:
+
+    void reattach()
+    {
+        // layered images stay layered unless a single layer is selected
+        GLenum attachement = GL_COLOR_ATTACHMENT0;
+        for (GLuint texture : m_colorAttachments)
+        {
+            if (m_layer < 0)
+            {
+                glNamedFramebufferTexture(static_cast<GLuint>(m_handle),
+                    attachement++, texture, m_level);
+            }
+            else
+            {
+                glNamedFramebufferTextureLayer(static_cast<GLuint>(m_handle),
+                    attachement++, texture, m_level, m_layer);
+            }
+        }
+    }
+
+    std::vector<GLuint> m_colorAttachments;
+
+    int m_level = 0;
+
+    int m_layer = -1;
 };
 
 class GLRenderbuffer : public IDepthBufferResource
@@ -902,6 +1164,173 @@ private:
     GLuint m_format = 0;
 };
 
+// persistently mapped pixel unpack buffer used as ring, regions are 
+// recycled once the fence of the upload reading them is signaled
+class GLPixelUploadRing
+{
+public:
+    explicit GLPixelUploadRing(size_t capacity)
+        : m_capacity(capacity)
+    {
+        constexpr GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glGenBuffers(1, &m_handle);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_handle);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, m_capacity, nullptr, MAP_FLAGS);
+        m_mapped = static_cast<uint8_t*>(
+            glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_capacity, MAP_FLAGS));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (!GraphicsAPICheckError() || !m_mapped)
+        {
+            glDeleteBuffers(1, &m_handle);
+            m_handle = 0;
+            m_mapped = nullptr;
+        }
+    }
+
+    ~GLPixelUploadRing()
+    {
+        for (const Region& region : m_inFlight)
+        {
+            glDeleteSync(region.fence);
+        }
+
+        if (m_handle)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_handle);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glDeleteBuffers(1, &m_handle);
+        }
+    }
+
+    bool isValid() const
+    {
+        return m_handle != 0;
+    }
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    // finds free space without blocking, false while the GPU still reads it
+    bool reserve(size_t size, size_t& outOffset)
+    {
+        retire();
+
+        size = align(size);
+        if (size > m_capacity)
+        {
+            return false;
+        }
+
+        if (m_inFlight.empty())
+        {
+            m_head = 0;
+            outOffset = 0;
+            return true;
+        }
+
+        const size_t tail = m_inFlight.front().offset;
+        if (m_head > tail)
+        {
+            if (m_head + size <= m_capacity)
+            {
+                outOffset = m_head;
+                return true;
+            }
+            if (size <= tail)
+            {
+                outOffset = 0;
+                return true;
+            }
+        }
+        else if (m_head < tail && m_head + size <= tail)
+        {
+            outOffset = m_head;
+            return true;
+        }
+
+        return false;
+    }
+
+    // the only copy of an upload, straight from the client memory or file
+    // mapping, synchronization is done by the fences of the regions
+    bool write(size_t offset, const void* data, size_t size)
+    {
+        if (!m_mapped || offset + size > m_capacity)
+        {
+            return false;
+        }
+
+        std::memcpy(m_mapped + offset, data, size);
+        return true;
+    }
+
+    void bind()
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_handle);
+    }
+
+    void unbind()
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // marks the region as in use by the commands issued so far
+    void commit(size_t offset, size_t size)
+    {
+        size = align(size);
+        m_inFlight.push_back({ offset, size, 
+            glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+        m_head = offset + size;
+    }
+
+private:
+
+    struct Region
+    {
+        size_t offset;
+        size_t size;
+        GLsync fence;
+    };
+
+    static size_t align(size_t size)
+    {
+        constexpr size_t ALIGNMENT = 64;
+        return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    void retire()
+    {
+        while (!m_inFlight.empty())
+        {
+            const GLenum status = glClientWaitSync(m_inFlight.front().fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && 
+                status != GL_CONDITION_SATISFIED)
+            {
+                break;
+            }
+
+            glDeleteSync(m_inFlight.front().fence);
+            m_inFlight.pop_front();
+        }
+    }
+
+    GLuint m_handle = 0;
+
+    // coherent, writes are visible to the commands issued afterwards
+    uint8_t* m_mapped = nullptr;
+
+    size_t m_capacity;
+
+    size_t m_head = 0;
+
+    std::deque<Region> m_inFlight;
+};
+
 GraphicsAPI::GraphicsAPI()
 {
     glfwInit();
@@ -914,9 +1343,22 @@ GraphicsAPI::GraphicsAPI()
 
 GraphicsAPI::~GraphicsAPI()
 {
+    m_uploadRing.reset();
+    m_samplerCache.reset();
+
     glfwTerminate();
 }
 
+unsigned int GraphicsAPI::samplerFor(const TextureSampler& sampler, TextureFormat format)
+{
+    if (!m_samplerCache)
+    {
+        m_samplerCache = std::make_unique<GLSamplerCache>();
+    }
+
+    return m_samplerCache->acquire(sampler, GLSamplerCache::isShadowMap(format));
+}
+
 class GeometryAllocVisitor : public IGeometryVisitor
 {
 public:
@@ -929,6 +1371,11 @@ public:
             return;
         }
 
+        if (!mesh.hasClientData())
+        {
+            throw std::exception("Could not allocate geometry, client data was released");
+        }
+
         Logger::Info("Allocate geometry buffer (v:%i, f:%i): %.3fKB",
             mesh.vertexCount(), mesh.indexCount() / 3,
             (mesh.vertexBufferSize() + mesh.indexBufferSize()) / 1024.f);
@@ -950,6 +1397,11 @@ public:
             return;
         }
 
+        if (!primitiveSet.hasClientData())
+        {
+            throw std::exception("Could not allocate geometry, client data was released");
+        }
+
         Logger::Info("Allocate geometry buffer (v:%i): %.3fKB",
             primitiveSet.vertexCount(), primitiveSet.vertexBufferSize() / 1024.f);
 
@@ -997,11 +1449,14 @@ bool GraphicsAPI::allocate(ITextureSPtr texture, const void* data)
             return false;
         }
 
+        const int width = std::max(1, texture2D->width() >> texture2D->storageLevel());
+        const int height = std::max(1, texture2D->height() >> texture2D->storageLevel());
+
         Logger::Info("Allocate texture (w:%i, h:%i): %.3fKB",
-            texture2D->width(), texture2D->height(),
-            (static_cast<size_t>(texture2D->width() * texture2D->height()) * found->second.internalBPC) / 1024.f);
+            width, height, MipChain::levelSize(texture2D->format(), width, height) / 1024.f);
 
-        ITextureResourceUPtr resource = std::make_unique<GLTexture2DResource>(*texture2D, data);
+        ITextureResourceUPtr resource = std::make_unique<GLTexture2DResource>(
+            *texture2D, samplerFor(texture2D->sampler(), texture2D->format()), data);
 
         if (resource && resource->isValid())
         {
@@ -1023,7 +1478,8 @@ bool GraphicsAPI::allocate(ITextureSPtr texture, const void* data)
             cubemap->width(),
             (static_cast<size_t>(cubemap->width() * cubemap->width()) * found->second.internalBPC) / 1024.f);
 
-        ITextureResourceUPtr resource = std::make_unique<GLCubemapResource>(*cubemap, data);
+        ITextureResourceUPtr resource = std::make_unique<GLCubemapResource>(
+            *cubemap, samplerFor(cubemap->sampler(), cubemap->format()), data);
         if (resource && resource->isValid())
         {
             cubemap->link(std::move(resource));
@@ -1031,11 +1487,158 @@ bool GraphicsAPI::allocate(ITextureSPtr texture, const void* data)
         }
     }
 
+    else if (texture->layout() == TextureLayout::Texture3D)
+    {
+        Texture3DSPtr texture3D = std::static_pointer_cast<Texture3D>(texture);
+
+        Logger::Info("Allocate 3D texture (w:%i, h:%i, d:%i): %.3fKB",
+            texture3D->width(), texture3D->height(), texture3D->layers(),
+            (MipChain::levelSize(texture3D->format(), texture3D->width(), texture3D->height()) * texture3D->layers()) / 1024.f);
+
+        ITextureResourceUPtr resource = std::make_unique<GLTexture3DResource>(
+            *texture3D, samplerFor(texture3D->sampler(), texture3D->format()), data);
+        if (resource && resource->isValid())
+        {
+            texture3D->link(std::move(resource));
+            return true;
+        }
+    }
+
     Logger::Error("Could not allocate Texture.");
 
     return false;
 }
 
+bool GraphicsAPI::reallocate(Texture2DSPtr texture, int storageLevel)
+{
+    storageLevel = std::clamp(storageLevel, 0, texture->levelCount() - 1);
+
+    const int previousLevel = texture->storageLevel();
+    if (texture->handle() == SharedResource::INVALID_HANDLE)
+    {
+        texture->setStorageLevel(storageLevel);
+        return true;
+    }
+    else if (storageLevel == previousLevel)
+    {
+        return true;
+    }
+
+    const GLuint source = static_cast<GLuint>(texture->handle());
+
+    texture->setStorageLevel(storageLevel);
+    ITextureResourceUPtr resource = std::make_unique<GLTexture2DResource>(
+        *texture, samplerFor(texture->sampler(), texture->format()));
+    if (!resource->isValid())
+    {
+        texture->setStorageLevel(previousLevel);
+        return false;
+    }
+
+    // resident levels present in both storages are copied on the GPU
+    const int baseLevel = std::max(texture->baseLevel(), storageLevel);
+    for (int level = baseLevel; level < texture->levelCount(); ++level)
+    {
+        glCopyImageSubData(
+            source, GL_TEXTURE_2D, level - previousLevel, 0, 0, 0,
+            static_cast<GLuint>(resource->handle()), GL_TEXTURE_2D, level - storageLevel, 0, 0, 0,
+            std::max(1, texture->width() >> level), std::max(1, texture->height() >> level), 1);
+    }
+
+    texture->setBaseLevel(baseLevel);
+    texture->link(std::move(resource));
+
+    return GraphicsAPICheckError();
+}
+
+GraphicsAPI::UploadStatus GraphicsAPI::upload(Texture2DSPtr texture, int level, const void* data, size_t size)
+{
+    constexpr size_t UPLOAD_RING_SIZE = 64 * 1024 * 1024;
+
+    if (!m_uploadRing)
+    {
+        m_uploadRing = std::make_unique<GLPixelUploadRing>(UPLOAD_RING_SIZE);
+    }
+
+    // levels exceeding the ring are uploaded directly
+    const bool useRing = m_uploadRing->isValid() && size <= m_uploadRing->capacity();
+
+    size_t offset = 0;
+    if (useRing && !m_uploadRing->reserve(size, offset))
+    {
+        return UploadStatus::Deferred;
+    }
+
+    if (!allocate(texture))
+    {
+        return UploadStatus::Failed;
+    }
+
+    if (useRing)
+    {
+        if (!m_uploadRing->write(offset, data, size))
+        {
+            return UploadStatus::Failed;
+        }
+
+        m_uploadRing->bind();
+        texture->updateLevel(level, reinterpret_cast<const void*>(offset));
+        m_uploadRing->unbind();
+
+        m_uploadRing->commit(offset, size);
+    }
+    else
+    {
+        texture->updateLevel(level, data);
+    }
+
+    return GraphicsAPICheckError() ? UploadStatus::Complete : UploadStatus::Failed;
+}
+
+static bool downloadLevel(GLuint handle, TextureFormat format, int width, int height, int layers,
+    int level, std::vector<uint8_t>& outPixels)
+{
+    const auto& found = s_texFormatToGL.find(format);
+    if (found == s_texFormatToGL.end() || found->second.compressed)
+    {
+        return false;
+    }
+
+    const size_t size = MipChain::levelSize(format, width, height) * layers;
+    outPixels.resize(size);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTextureImage(handle, level, found->second.dataFormat, found->second.dataType,
+        static_cast<GLsizei>(size), outPixels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    return GraphicsAPICheckError();
+}
+
+bool GraphicsAPI::download(Texture2DSPtr texture, int level, std::vector<uint8_t>& outPixels)
+{
+    if (texture->handle() == SharedResource::INVALID_HANDLE || level < texture->storageLevel())
+    {
+        return false;
+    }
+
+    return downloadLevel(static_cast<GLuint>(texture->handle()), texture->format(),
+        std::max(1, texture->width() >> level), std::max(1, texture->height() >> level), 1,
+        level - texture->storageLevel(), outPixels);
+}
+
+bool GraphicsAPI::download(CubemapSPtr cubemap, int level, std::vector<uint8_t>& outPixels)
+{
+    if (cubemap->handle() == SharedResource::INVALID_HANDLE)
+    {
+        return false;
+    }
+
+    const int width = std::max(1, cubemap->width() >> level);
+    return downloadLevel(static_cast<GLuint>(cubemap->handle()), cubemap->format(),
+        width, width, 6, level, outPixels);
+}
+
 bool GraphicsAPI::allocate(RenderTargetSPtr rendertarget)
 {
     if (rendertarget->colorTargets().empty() && 
@@ -1123,6 +1726,32 @@ bool GraphicsAPI::allocate(IUniformBlockDataSPtr uniformBlockData)
     return false;
 }
 
+bool GraphicsAPI::allocate(InstanceBufferSPtr instanceBuffer)
+{
+    if (instanceBuffer->linked())
+    {
+        return true;
+    }
+
+    Logger::Info("Allocate instance buffer (n:%i): %.3fKB",
+        static_cast<int>(instanceBuffer->count()), instanceBuffer->dataSize() / 1024.f);
+
+    IStorageBufferResourceUPtr resource(new GLShaderStorageBuffer(
+        instanceBuffer->bindingPoint(), 
+        instanceBuffer->data().data(), 
+        instanceBuffer->dataSize()));
+
+    if (resource && resource->isValid())
+    {
+        instanceBuffer->link(std::move(resource));
+        return true;
+    }
+
+    Logger::Error("Could not allocate instance buffer.");
+
+    return false;
+}
+
 GraphicsAPI::Result GraphicsAPI::compile(ShaderSourceSPtr shader)
 {
     Result result = { true, std::string() };
@@ -1210,6 +1839,26 @@ GraphicsAPI::Result GraphicsAPI::compile(ShaderProgramSPtr program)
     return result;
 }
 
+static bool hasExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const GLubyte* extension = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i));
+        if (extension && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GraphicsAPI::supportsVertexLayer() const
+{
+    return hasExtension("GL_ARB_shader_viewport_layer_array");
+}
+
 GraphicsAPISPtr GraphicsAPI::create()
 {
     return std::make_shared<GraphicsAPI>();
@@ -1285,3 +1934,80 @@ double GPUTimer::fetchElapsedMs()
 {
     return fetchElapsedNs() * 1e-6;
 }
+
+GPUReadback::GPUReadback()
+{
+    GLuint handle;
+    glGenBuffers(1, &handle);
+
+    m_buffer = static_cast<unsigned int>(handle);
+}
+
+GPUReadback::~GPUReadback()
+{
+    if (m_fence)
+    {
+        glDeleteSync(static_cast<GLsync>(m_fence));
+    }
+
+    GLuint handle = static_cast<GLuint>(m_buffer);
+    glDeleteBuffers(1, &handle);
+}
+
+bool GPUReadback::request(IRenderTargetSPtr source)
+{
+    if (m_fence)
+    {
+        return false;
+    }
+
+    m_width = source->width();
+    m_height = source->height();
+    const size_t size = static_cast<size_t>(m_width) * m_height * 4 * sizeof(float);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source->handle());
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+    if (size != m_size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        m_size = size;
+    }
+
+    // copies into the buffer without waiting for the GPU
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    return GraphicsAPICheckError();
+}
+
+bool GPUReadback::fetch(std::vector<float>& outPixels, int& outWidth, int& outHeight)
+{
+    if (!m_fence)
+    {
+        return false;
+    }
+
+    const GLenum status = glClientWaitSync(static_cast<GLsync>(m_fence), 0, 0);
+    if (status != GL_ALREADY_SIGNALED && 
+        status != GL_CONDITION_SATISFIED)
+    {
+        return false;
+    }
+
+    glDeleteSync(static_cast<GLsync>(m_fence));
+    m_fence = nullptr;
+
+    outWidth = m_width;
+    outHeight = m_height;
+    outPixels.resize(m_size / sizeof(float));
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+    glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, m_size, outPixels.data());
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return GraphicsAPICheckError();
+}
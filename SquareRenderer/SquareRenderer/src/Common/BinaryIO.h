@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+// sequential writer for the binary caches
+class CacheWriter
+{
+public:
+	explicit CacheWriter(const std::string& path)
+		: m_stream(path, std::ios::binary | std::ios::trunc)
+	{
+	}
+
+	template<typename T>
+	void write(const T& value)
+	{
+		write(&value, sizeof(T));
+	}
+
+	void write(const void* data, size_t size)
+	{
+		m_stream.write(static_cast<const char*>(data), size);
+	}
+
+	bool good() const
+	{
+		return m_stream.good();
+	}
+
+private:
+	std::ofstream m_stream;
+};
+
+// bounds checked reader over a memory mapped cache file
+class CacheReader
+{
+public:
+	CacheReader(const uint8_t* data, size_t size)
+		: m_current(data)
+		, m_end(data + size)
+	{
+	}
+
+	template<typename T>
+	bool read(T& value)
+	{
+		return read(&value, sizeof(T));
+	}
+
+	bool read(void* target, size_t size)
+	{
+		const uint8_t* source = skip(size);
+		if (source)
+		{
+			std::memcpy(target, source, size);
+		}
+		return source != nullptr;
+	}
+
+	// whether count values of T fit into the remaining bytes, checked
+	// before allocating for counts read out of the file
+	template<typename T>
+	bool fits(size_t count) const
+	{
+		return count <= static_cast<size_t>(m_end - m_current) / sizeof(T);
+	}
+
+	// returns a pointer into the mapping, nullptr if out of bounds
+	const uint8_t* skip(size_t size)
+	{
+		if (static_cast<size_t>(m_end - m_current) < size)
+		{
+			return nullptr;
+		}
+
+		const uint8_t* result = m_current;
+		m_current += size;
+		return result;
+	}
+
+private:
+	const uint8_t* m_current;
+	const uint8_t* m_end;
+};
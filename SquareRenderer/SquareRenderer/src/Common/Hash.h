@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace Hash
+{
+	constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+	constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+	// FNV-1a, for short keys
+	inline uint64_t fnv1a(const void* data, size_t size, uint64_t seed = FNV_OFFSET)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+		uint64_t hash = seed;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	inline uint64_t fnv1a(const std::string& str, uint64_t seed = FNV_OFFSET)
+	{
+		return fnv1a(str.data(), str.size(), seed);
+	}
+
+	template<typename T>
+	inline uint64_t combine(uint64_t seed, const T& value)
+	{
+		return fnv1a(&value, sizeof(T), seed);
+	}
+
+	// word wise 64 bit hash (xxHash64 scheme) for large file contents
+	uint64_t content(const void* data, size_t size, uint64_t seed = 0);
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Common/Math3D.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ImportanceSampling
+{
+	// van der Corput sequence in base 2
+	float radicalInverse(uint32_t bits);
+
+	glm::vec2 hammersley(uint32_t index, uint32_t count);
+
+	// GGX distributed half vector around +Z
+	glm::vec3 sampleGGX(const glm::vec2& xi, float roughness);
+
+	float distributionGGX(float NdotH, float roughness);
+
+	// light directions around +Z of the GGX lobe with the view along the
+	// normal, the source mip is chosen from the pdf and stored in w,
+	// directions below the horizon are dropped
+	std::vector<glm::vec4> prefilterSamples(float roughness, uint32_t count, 
+		int sourceWidth, int sourceLevelCount);
+};
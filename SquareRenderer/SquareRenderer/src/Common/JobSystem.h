@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Common/Macros.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+DECLARE_PTRS(JobCounter);
+
+typedef std::function<void()> Job;
+
+enum class JobAffinity
+{
+	Worker,	// any worker thread, stolen between workers
+	Main	// thread owning the GL context, see JobSystem::processMainThreadJobs
+};
+
+// number of unfinished jobs, continuations are scheduled once it drops to zero
+class JobCounter
+{
+public:
+
+	JobCounter() = default;
+
+	bool done() const;
+
+	int pending() const;
+
+private:
+	friend class JobSystem;
+
+	std::atomic<int> m_pending{ 0 };
+
+	std::mutex m_mutex;
+
+	std::condition_variable m_condition;
+
+	std::vector<Job> m_continuations;
+};
+
+class JobSystem
+{
+public:
+
+	// 0 uses all hardware threads except the main thread
+	explicit JobSystem(size_t threadCount = 0);
+
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// engine wide instance, the first use has to happen on the main thread
+	static JobSystem& instance();
+
+	void run(Job job, JobCounterSPtr counter = nullptr, JobAffinity affinity = JobAffinity::Worker);
+
+	// scheduled once the dependency counter is done
+	void runAfter(JobCounterSPtr dependency, Job job, 
+		JobCounterSPtr counter = nullptr, JobAffinity affinity = JobAffinity::Worker);
+
+	// executes other jobs while waiting, on the main thread this includes
+	// the queued main thread jobs unless runMainThreadJobs is false, so
+	// the caller must not hold state those jobs could touch
+	void wait(JobCounterSPtr counter, bool runMainThreadJobs = true);
+
+	// runs body(i) for i in [0, count) in chunks of grainSize, the calling
+	// thread takes part so nested calls from workers cannot starve, it
+	// only executes worker jobs while waiting for the helpers
+	void parallelFor(size_t count,
+		const std::function<void(size_t)>& body,
+		size_t grainSize = 1);
+
+	// executes the queued main thread jobs, returns their number
+	size_t processMainThreadJobs();
+
+	size_t threadCount() const;
+
+	// index of the calling worker, -1 for all other threads
+	int workerIndex() const;
+
+	bool isMainThread() const;
+
+private:
+
+	struct Worker
+	{
+		std::thread thread;
+		std::deque<std::pair<Job, JobCounterSPtr>> jobs;
+		std::mutex mutex;
+	};
+
+	typedef std::pair<Job, JobCounterSPtr> QueuedJob;
+
+	void workerLoop(int index);
+
+	// own deque from the back, others from the front
+	bool popJob(int index, QueuedJob& outJob);
+
+	bool popMainJob(QueuedJob& outJob);
+
+	void execute(QueuedJob& job);
+
+	void finish(JobCounterSPtr counter);
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+
+	std::deque<QueuedJob> m_mainJobs;
+
+	std::mutex m_mainMutex;
+
+	std::atomic<size_t> m_nextWorker{ 0 };
+
+	std::atomic<size_t> m_queuedJobs{ 0 };
+
+	std::mutex m_sleepMutex;
+
+	std::condition_variable m_wakeUp;
+
+	std::atomic<bool> m_stop{ false };
+
+	std::thread::id m_mainThread;
+};
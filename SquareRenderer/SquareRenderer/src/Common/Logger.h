@@ -7,6 +7,7 @@
 #include <vector>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <stdexcept>
 
@@ -97,4 +98,7 @@ private:
 	Logger& operator=(const Logger&) = delete;
 
 	std::vector<LogCallbackWPtr> m_callbacks;
+
+	// messages are logged from worker threads as well
+	std::recursive_mutex m_mutex;
 };
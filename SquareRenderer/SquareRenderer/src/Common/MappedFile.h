@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Common/Macros.h"
+
+#include <cstdint>
+#include <string>
+
+DECLARE_PTRS(MappedFile);
+
+// read only memory mapping of a whole file
+class MappedFile
+{
+public:
+
+	explicit MappedFile(const std::string& filepath);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool isValid() const;
+
+	const uint8_t* data() const;
+
+	size_t size() const;
+
+private:
+
+	const uint8_t* m_data = nullptr;
+
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_file = nullptr;
+
+	void* m_mapping = nullptr;
+#else
+	int m_file = -1;
+#endif
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Common/Math3D.h"
+
+#include <array>
+
+namespace SphericalHarmonics
+{
+	constexpr int COEFFICIENT_COUNT = 9;
+
+	// L2 projection of an RGB signal, band 0 first
+	typedef std::array<glm::vec3, COEFFICIENT_COUNT> Coefficients;
+
+	// real basis functions at a unit direction
+	std::array<float, COEFFICIENT_COUNT> basis(const glm::vec3& direction);
+
+	// GL direction of a texel center, faces in +X, -X, +Y, -Y, +Z, -Z order
+	glm::vec3 cubemapDirection(int face, int x, int y, int width);
+
+	// solid angle weighted projection of six tightly packed RGB float faces,
+	// rows are spread over the job system
+	Coefficients projectCubemap(const float* faces, int width);
+
+	// convolution with the clamped cosine lobe, evaluates to the 
+	// irradiance divided by pi like the convolved irradiance cubemap
+	Coefficients convolveIrradiance(const Coefficients& radiance);
+
+	glm::vec3 evaluate(const Coefficients& coefficients, const glm::vec3& direction);
+};
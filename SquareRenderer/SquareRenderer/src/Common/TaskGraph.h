@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Common/JobSystem.h"
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// dependency graph of tasks executed by the job system, tasks with main
+// affinity run on the main thread while it waits in run(), e.g. for GL calls
+class TaskGraph
+{
+public:
+
+	typedef size_t TaskId;
+
+	typedef JobAffinity Affinity;
+
+	TaskGraph();
+
+	TaskId add(const std::string& name,
+		std::function<void()> work,
+		Affinity affinity = Affinity::Worker,
+		const std::vector<TaskId>& dependencies = {});
+
+	void addDependency(TaskId task, TaskId dependency);
+
+	// blocks until all tasks are done, rethrows the first task exception
+	void run();
+
+	// logs start and end of every task and the critical path
+	void logTimeline(const std::string& title) const;
+
+private:
+
+	typedef std::chrono::steady_clock Clock;
+
+	struct Task
+	{
+		std::string name;
+		std::function<void()> work;
+		Affinity affinity;
+		std::vector<TaskId> dependencies;
+		std::vector<TaskId> dependents;
+		size_t pendingDependencies = 0;
+		Clock::time_point start;
+		Clock::time_point end;
+		int thread = -1;
+	};
+
+	void schedule(TaskId id);
+
+	void execute(TaskId id);
+
+	std::vector<Task> m_tasks;
+
+	JobCounterSPtr m_counter;
+
+	std::mutex m_mutex;
+
+	std::exception_ptr m_exception;
+
+	Clock::time_point m_start;
+};
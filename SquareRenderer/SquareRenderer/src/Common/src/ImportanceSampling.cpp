@@ -0,0 +1,88 @@
+#include "Common/ImportanceSampling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	constexpr float PI = 3.14159265358979f;
+
+	// one level coarser than the solid angle ratio, smooths the
+	// undersampled lobe at the cost of a slightly wider filter
+	constexpr float MIP_BIAS = 1.f;
+}
+
+float ImportanceSampling::radicalInverse(uint32_t bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return static_cast<float>(bits) * 2.3283064365386963e-10f;
+}
+
+glm::vec2 ImportanceSampling::hammersley(uint32_t index, uint32_t count)
+{
+	return glm::vec2(static_cast<float>(index) / count, radicalInverse(index));
+}
+
+glm::vec3 ImportanceSampling::sampleGGX(const glm::vec2& xi, float roughness)
+{
+	const float a = roughness * roughness;
+
+	const float phi = 2.f * PI * xi.x;
+	const float cosTheta = std::sqrt((1.f - xi.y) / (1.f + (a * a - 1.f) * xi.y));
+	const float sinTheta = std::sqrt(1.f - cosTheta * cosTheta);
+
+	return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+}
+
+float ImportanceSampling::distributionGGX(float NdotH, float roughness)
+{
+	const float a = roughness * roughness;
+	const float a2 = a * a;
+	const float denom = NdotH * NdotH * (a2 - 1.f) + 1.f;
+
+	return a2 / (PI * denom * denom);
+}
+
+std::vector<glm::vec4> ImportanceSampling::prefilterSamples(float roughness, uint32_t count,
+	int sourceWidth, int sourceLevelCount)
+{
+	std::vector<glm::vec4> samples;
+
+	// a mirror reflects the source texel itself
+	if (roughness <= 0.f || count == 0)
+	{
+		samples.emplace_back(0.f, 0.f, 1.f, 0.f);
+		return samples;
+	}
+
+	const float maxLevel = static_cast<float>(std::max(sourceLevelCount - 1, 0));
+	const float texelSolidAngle = 4.f * PI / (6.f * sourceWidth * sourceWidth);
+
+	samples.reserve(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const glm::vec3 H = sampleGGX(hammersley(i, count), roughness);
+
+		// reflected around H with V = N = +Z
+		const glm::vec3 L(2.f * H.z * H.x, 2.f * H.z * H.y, 2.f * H.z * H.z - 1.f);
+		if (L.z <= 0.f)
+		{
+			continue;
+		}
+
+		// pdf of L is D * NdotH / (4 * VdotH), which reduces to D / 4
+		const float pdf = distributionGGX(H.z, roughness) * .25f;
+		const float sampleSolidAngle = 1.f / (count * pdf + 1e-5f);
+
+		// the source level whose texels cover the solid angle of the sample
+		const float level = .5f * std::log2(sampleSolidAngle / texelSolidAngle) + MIP_BIAS;
+
+		samples.emplace_back(L.x, L.y, L.z, std::clamp(level, 0.f, maxLevel));
+	}
+
+	return samples;
+}
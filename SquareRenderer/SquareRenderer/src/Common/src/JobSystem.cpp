@@ -0,0 +1,358 @@
+#include "Common/JobSystem.h"
+#include "Common/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+thread_local int t_workerIndex = -1;
+
+bool JobCounter::done() const
+{
+	return m_pending.load() == 0;
+}
+
+int JobCounter::pending() const
+{
+	return m_pending.load();
+}
+
+JobSystem::JobSystem(size_t threadCount)
+	: m_mainThread(std::this_thread::get_id())
+{
+	if (threadCount == 0)
+	{
+		const size_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = std::max<size_t>(hardwareThreads, 2) - 1;
+	}
+
+	m_workers.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i)
+	{
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+
+	// all deques exist before the first worker can steal
+	for (size_t i = 0; i < threadCount; ++i)
+	{
+		m_workers[i]->thread = std::thread(&JobSystem::workerLoop, this, static_cast<int>(i));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stop = true;
+	}
+	m_wakeUp.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker->thread.join();
+	}
+}
+
+JobSystem& JobSystem::instance()
+{
+	static JobSystem instance;
+	return instance;
+}
+
+void JobSystem::run(Job job, JobCounterSPtr counter, JobAffinity affinity)
+{
+	if (counter)
+	{
+		counter->m_pending += 1;
+	}
+
+	if (affinity == JobAffinity::Main || m_workers.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_mainMutex);
+		m_mainJobs.emplace_back(std::move(job), counter);
+		return;
+	}
+
+	// workers push to their own deque, other threads distribute round robin
+	const int self = workerIndex();
+	const size_t target = self >= 0 
+		? static_cast<size_t>(self) : m_nextWorker++ % m_workers.size();
+
+	// counted before it can be popped, the decrement in popJob 
+	// must never run first and wrap the counter around
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_queuedJobs += 1;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_workers[target]->mutex);
+		m_workers[target]->jobs.emplace_back(std::move(job), counter);
+	}
+	m_wakeUp.notify_one();
+}
+
+void JobSystem::runAfter(JobCounterSPtr dependency, Job job, JobCounterSPtr counter, JobAffinity affinity)
+{
+	if (dependency)
+	{
+		// counted right away, so waiting on it covers the continuation
+		if (counter)
+		{
+			counter->m_pending += 1;
+		}
+
+		std::unique_lock<std::mutex> lock(dependency->m_mutex);
+		if (!dependency->done())
+		{
+			dependency->m_continuations.emplace_back([this, job, counter, affinity]() {
+				run(job, counter, affinity);
+				finish(counter);
+			});
+			return;
+		}
+		lock.unlock();
+
+		run(std::move(job), counter, affinity);
+		finish(counter);
+		return;
+	}
+
+	run(std::move(job), counter, affinity);
+}
+
+void JobSystem::wait(JobCounterSPtr counter, bool runMainThreadJobs)
+{
+	if (!counter)
+	{
+		return;
+	}
+
+	const bool mainThread = runMainThreadJobs && isMainThread();
+	const int self = workerIndex();
+
+	while (!counter->done())
+	{
+		QueuedJob job;
+		if ((mainThread && popMainJob(job)) || popJob(self, job))
+		{
+			execute(job);
+			continue;
+		}
+
+		// woken by the counter, the timeout catches newly queued jobs
+		std::unique_lock<std::mutex> lock(counter->m_mutex);
+		counter->m_condition.wait_for(lock, std::chrono::microseconds(200),
+			[&counter]() { return counter->done(); });
+	}
+}
+
+void JobSystem::parallelFor(size_t count,
+	const std::function<void(size_t)>& body,
+	size_t grainSize)
+{
+	grainSize = std::max<size_t>(grainSize, 1);
+	const size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+	if (chunkCount <= 1 || m_workers.empty())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			body(i);
+		}
+		return;
+	}
+
+	// helpers grab chunks until none are left, 
+	// late helpers return without touching the body
+	std::shared_ptr<std::atomic<size_t>> nextChunk = std::make_shared<std::atomic<size_t>>(0);
+	std::shared_ptr<std::exception_ptr> exception = std::make_shared<std::exception_ptr>();
+	std::shared_ptr<std::mutex> exceptionMutex = std::make_shared<std::mutex>();
+
+	auto work = [nextChunk, exception, exceptionMutex, chunkCount, count, grainSize, &body]() {
+		for (size_t chunk = (*nextChunk)++; chunk < chunkCount; chunk = (*nextChunk)++)
+		{
+			const size_t end = std::min(count, (chunk + 1) * grainSize);
+			try
+			{
+				for (size_t i = chunk * grainSize; i < end; ++i)
+				{
+					body(i);
+				}
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(*exceptionMutex);
+				if (!*exception)
+				{
+					*exception = std::current_exception();
+				}
+			}
+		}
+	};
+
+	JobCounterSPtr counter = std::make_shared<JobCounter>();
+
+	const size_t helperCount = std::min(m_workers.size(), chunkCount - 1);
+	for (size_t i = 0; i < helperCount; ++i)
+	{
+		run(work, counter);
+	}
+
+	// the loop body must not be interleaved with arbitrary main thread jobs
+	work();
+	wait(counter, false);
+
+	if (*exception)
+	{
+		std::rethrow_exception(*exception);
+	}
+}
+
+size_t JobSystem::processMainThreadJobs()
+{
+	size_t executed = 0;
+
+	QueuedJob job;
+	while (popMainJob(job))
+	{
+		execute(job);
+		++executed;
+	}
+
+	return executed;
+}
+
+size_t JobSystem::threadCount() const
+{
+	return m_workers.size();
+}
+
+int JobSystem::workerIndex() const
+{
+	return t_workerIndex;
+}
+
+bool JobSystem::isMainThread() const
+{
+	return std::this_thread::get_id() == m_mainThread;
+}
+
+void JobSystem::workerLoop(int index)
+{
+	t_workerIndex = index;
+
+	while (true)
+	{
+		QueuedJob job;
+		if (popJob(index, job))
+		{
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wakeUp.wait(lock, [this]() { return m_stop || m_queuedJobs > 0; });
+
+		if (m_stop && m_queuedJobs == 0)
+		{
+			return;
+		}
+	}
+}
+
+bool JobSystem::popJob(int index, QueuedJob& outJob)
+{
+	const size_t workerCount = m_workers.size();
+	if (workerCount == 0)
+	{
+		return false;
+	}
+
+	const size_t start = index >= 0 ? static_cast<size_t>(index) : m_nextWorker.load() % workerCount;
+
+	for (size_t i = 0; i < workerCount; ++i)
+	{
+		const size_t victim = (start + i) % workerCount;
+		const bool own = static_cast<int>(victim) == index;
+
+		Worker& worker = *m_workers[victim];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (worker.jobs.empty())
+		{
+			continue;
+		}
+
+		if (own)
+		{
+			outJob = std::move(worker.jobs.back());
+			worker.jobs.pop_back();
+		}
+		else
+		{
+			outJob = std::move(worker.jobs.front());
+			worker.jobs.pop_front();
+		}
+
+		m_queuedJobs -= 1;
+		return true;
+	}
+
+	return false;
+}
+
+bool JobSystem::popMainJob(QueuedJob& outJob)
+{
+	std::lock_guard<std::mutex> lock(m_mainMutex);
+	if (m_mainJobs.empty())
+	{
+		return false;
+	}
+
+	outJob = std::move(m_mainJobs.front());
+	m_mainJobs.pop_front();
+	return true;
+}
+
+void JobSystem::execute(QueuedJob& job)
+{
+	try
+	{
+		job.first();
+	}
+	catch (const std::exception& e)
+	{
+		Logger::Error("Job failed: %s", e.what());
+	}
+	catch (...)
+	{
+		Logger::Error("Job failed");
+	}
+
+	finish(job.second);
+}
+
+void JobSystem::finish(JobCounterSPtr counter)
+{
+	if (!counter)
+	{
+		return;
+	}
+
+	std::vector<Job> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		if (--counter->m_pending > 0)
+		{
+			return;
+		}
+
+		continuations.swap(counter->m_continuations);
+		counter->m_condition.notify_all();
+	}
+
+	for (Job& continuation : continuations)
+	{
+		continuation();
+	}
+}
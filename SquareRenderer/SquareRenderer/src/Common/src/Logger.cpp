@@ -2,6 +2,8 @@
 
 void Logger::log(LogSeverity s, const std::string& message)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
 	try
 	{
 		for (auto it = m_callbacks.begin(); it != m_callbacks.end(); ++it)
@@ -26,6 +28,8 @@ void Logger::log(LogSeverity s, const std::string& message)
 
 LogCallbackSPtr Logger::registerCallback(const LogCallback& func)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
 	LogCallbackSPtr ptr = std::make_shared<LogCallback>(func);
 
 	m_callbacks.push_back(ptr);
@@ -35,6 +39,8 @@ LogCallbackSPtr Logger::registerCallback(const LogCallback& func)
 
 LogCallbackSPtr Logger::registerCallback(LogCallback&& func)
 {
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
 	LogCallbackSPtr ptr = std::make_shared<LogCallback>(std::move(func));
 
 	m_callbacks.push_back(ptr);
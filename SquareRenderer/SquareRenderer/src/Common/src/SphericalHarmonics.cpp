@@ -0,0 +1,231 @@
+#include "Common/SphericalHarmonics.h"
+#include "Common/JobSystem.h"
+
+#include <cmath>
+#include <vector>
+
+// every x64 target supports SSE2
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define SPHERICAL_HARMONICS_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr float PI = 3.14159265358979f;
+
+	// rows per job
+	constexpr size_t ROW_GRAIN = 16;
+
+	constexpr float Y0 = 0.282094792f;	// 1/2 sqrt(1/pi)
+	constexpr float Y1 = 0.488602512f;	// sqrt(3/(4pi))
+	constexpr float Y2 = 1.092548431f;	// 1/2 sqrt(15/pi)
+	constexpr float Y20 = 0.315391565f;	// 1/4 sqrt(5/pi)
+	constexpr float Y22 = 0.546274215f;	// 1/4 sqrt(15/pi)
+
+	constexpr int SUM_COUNT = SphericalHarmonics::COEFFICIENT_COUNT * 3;
+
+	// texels of one cubemap row, structure of arrays
+	struct Row
+	{
+		std::vector<float> x, y, z, weight, r, g, b;
+
+		explicit Row(size_t count)
+			: x(count), y(count), z(count), weight(count), r(count), g(count), b(count)
+		{
+		}
+	};
+
+	void accumulate(float x, float y, float z, float wr, float wg, float wb, float* sums)
+	{
+		const float basis[SphericalHarmonics::COEFFICIENT_COUNT] = {
+			Y0, Y1 * y, Y1 * z, Y1 * x,
+			Y2 * x * y, Y2 * y * z, Y20 * (3.f * z * z - 1.f), Y2 * x * z, Y22 * (x * x - y * y)
+		};
+
+		for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; ++i)
+		{
+			sums[i * 3 + 0] += basis[i] * wr;
+			sums[i * 3 + 1] += basis[i] * wg;
+			sums[i * 3 + 2] += basis[i] * wb;
+		}
+	}
+
+	// per coefficient and channel sums of the weighted row
+	void accumulateRow(const Row& row, int count, float* sums)
+	{
+		int i = 0;
+
+#ifdef SPHERICAL_HARMONICS_SSE
+		__m128 acc[SUM_COUNT];
+		for (__m128& a : acc)
+		{
+			a = _mm_setzero_ps();
+		}
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(&row.x[i]);
+			const __m128 y = _mm_loadu_ps(&row.y[i]);
+			const __m128 z = _mm_loadu_ps(&row.z[i]);
+			const __m128 w = _mm_loadu_ps(&row.weight[i]);
+
+			const __m128 wr = _mm_mul_ps(w, _mm_loadu_ps(&row.r[i]));
+			const __m128 wg = _mm_mul_ps(w, _mm_loadu_ps(&row.g[i]));
+			const __m128 wb = _mm_mul_ps(w, _mm_loadu_ps(&row.b[i]));
+
+			const __m128 zz = _mm_mul_ps(z, z);
+			const __m128 basis[SphericalHarmonics::COEFFICIENT_COUNT] = {
+				_mm_set1_ps(Y0),
+				_mm_mul_ps(_mm_set1_ps(Y1), y),
+				_mm_mul_ps(_mm_set1_ps(Y1), z),
+				_mm_mul_ps(_mm_set1_ps(Y1), x),
+				_mm_mul_ps(_mm_set1_ps(Y2), _mm_mul_ps(x, y)),
+				_mm_mul_ps(_mm_set1_ps(Y2), _mm_mul_ps(y, z)),
+				_mm_mul_ps(_mm_set1_ps(Y20), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.f), zz), _mm_set1_ps(1.f))),
+				_mm_mul_ps(_mm_set1_ps(Y2), _mm_mul_ps(x, z)),
+				_mm_mul_ps(_mm_set1_ps(Y22), _mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)))
+			};
+
+			for (int c = 0; c < SphericalHarmonics::COEFFICIENT_COUNT; ++c)
+			{
+				acc[c * 3 + 0] = _mm_add_ps(acc[c * 3 + 0], _mm_mul_ps(basis[c], wr));
+				acc[c * 3 + 1] = _mm_add_ps(acc[c * 3 + 1], _mm_mul_ps(basis[c], wg));
+				acc[c * 3 + 2] = _mm_add_ps(acc[c * 3 + 2], _mm_mul_ps(basis[c], wb));
+			}
+		}
+
+		for (int s = 0; s < SUM_COUNT; ++s)
+		{
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, acc[s]);
+			sums[s] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+		}
+#endif
+
+		for (; i < count; ++i)
+		{
+			const float w = row.weight[i];
+			accumulate(row.x[i], row.y[i], row.z[i], w * row.r[i], w * row.g[i], w * row.b[i], sums);
+		}
+	}
+}
+
+std::array<float, SphericalHarmonics::COEFFICIENT_COUNT> SphericalHarmonics::basis(const glm::vec3& d)
+{
+	return {
+		Y0,
+		Y1 * d.y, Y1 * d.z, Y1 * d.x,
+		Y2 * d.x * d.y, Y2 * d.y * d.z, Y20 * (3.f * d.z * d.z - 1.f), Y2 * d.x * d.z, Y22 * (d.x * d.x - d.y * d.y)
+	};
+}
+
+glm::vec3 SphericalHarmonics::cubemapDirection(int face, int x, int y, int width)
+{
+	// texel center in [-1, 1], rows start at t = -1
+	const float s = 2.f * (x + .5f) / width - 1.f;
+	const float t = 2.f * (y + .5f) / width - 1.f;
+
+	glm::vec3 direction;
+	switch (face)
+	{
+	case 0:	direction = glm::vec3( 1.f,  -t,  -s); break;
+	case 1:	direction = glm::vec3(-1.f,  -t,   s); break;
+	case 2:	direction = glm::vec3(   s, 1.f,   t); break;
+	case 3:	direction = glm::vec3(   s,-1.f,  -t); break;
+	case 4:	direction = glm::vec3(   s,  -t, 1.f); break;
+	default:direction = glm::vec3(  -s,  -t,-1.f); break;
+	}
+
+	return glm::normalize(direction);
+}
+
+SphericalHarmonics::Coefficients SphericalHarmonics::projectCubemap(const float* faces, int width)
+{
+	const size_t rowCount = static_cast<size_t>(width) * 6;
+	const float texelSize = 2.f / width;
+
+	// summed per row and reduced in order, the result does not depend on scheduling
+	std::vector<float> rowSums(rowCount * SUM_COUNT, 0.f);
+	std::vector<float> rowWeights(rowCount, 0.f);
+
+	JobSystem::instance().parallelFor(rowCount, [&](size_t index) {
+		const int face = static_cast<int>(index / width);
+		const int y = static_cast<int>(index % width);
+		const float* pixels = faces + index * width * 3;
+
+		Row row(width);
+		for (int x = 0; x < width; ++x)
+		{
+			const float s = 2.f * (x + .5f) / width - 1.f;
+			const float t = 2.f * (y + .5f) / width - 1.f;
+			const float lengthSq = 1.f + s * s + t * t;
+
+			// solid angle of the texel projected onto the unit sphere
+			const float weight = texelSize * texelSize / (lengthSq * std::sqrt(lengthSq));
+
+			const glm::vec3 direction = cubemapDirection(face, x, y, width);
+			row.x[x] = direction.x;
+			row.y[x] = direction.y;
+			row.z[x] = direction.z;
+			row.weight[x] = weight;
+			row.r[x] = pixels[x * 3 + 0];
+			row.g[x] = pixels[x * 3 + 1];
+			row.b[x] = pixels[x * 3 + 2];
+
+			rowWeights[index] += weight;
+		}
+
+		accumulateRow(row, width, &rowSums[index * SUM_COUNT]);
+	}, ROW_GRAIN);
+
+	double totalWeight = 0.0;
+	double sums[SUM_COUNT] = {};
+	for (size_t index = 0; index < rowCount; ++index)
+	{
+		totalWeight += rowWeights[index];
+		for (int s = 0; s < SUM_COUNT; ++s)
+		{
+			sums[s] += rowSums[index * SUM_COUNT + s];
+		}
+	}
+
+	// the texel solid angles only approximately add up to the full sphere
+	const double normalization = totalWeight > 0.0 ? 4.0 * PI / totalWeight : 0.0;
+
+	Coefficients result;
+	for (int c = 0; c < COEFFICIENT_COUNT; ++c)
+	{
+		result[c] = glm::vec3(
+			static_cast<float>(sums[c * 3 + 0] * normalization),
+			static_cast<float>(sums[c * 3 + 1] * normalization),
+			static_cast<float>(sums[c * 3 + 2] * normalization));
+	}
+	return result;
+}
+
+SphericalHarmonics::Coefficients SphericalHarmonics::convolveIrradiance(const Coefficients& radiance)
+{
+	// cosine lobe per band (pi, 2pi/3, pi/4), divided by pi
+	const float bands[3] = { 1.f, 2.f / 3.f, .25f };
+
+	Coefficients result;
+	for (int c = 0; c < COEFFICIENT_COUNT; ++c)
+	{
+		const int band = c == 0 ? 0 : (c < 4 ? 1 : 2);
+		result[c] = radiance[c] * bands[band];
+	}
+	return result;
+}
+
+glm::vec3 SphericalHarmonics::evaluate(const Coefficients& coefficients, const glm::vec3& direction)
+{
+	const auto values = basis(direction);
+
+	glm::vec3 result(0.f);
+	for (int c = 0; c < COEFFICIENT_COUNT; ++c)
+	{
+		result += coefficients[c] * values[c];
+	}
+	return result;
+}
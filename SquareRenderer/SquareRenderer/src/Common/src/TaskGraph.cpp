@@ -0,0 +1,169 @@
+#include "Common/TaskGraph.h"
+#include "Common/Logger.h"
+
+#include <algorithm>
+
+TaskGraph::TaskGraph()
+	: m_counter(std::make_shared<JobCounter>())
+{
+}
+
+TaskGraph::TaskId TaskGraph::add(const std::string& name,
+	std::function<void()> work,
+	Affinity affinity,
+	const std::vector<TaskId>& dependencies)
+{
+	const TaskId id = m_tasks.size();
+
+	Task& task = m_tasks.emplace_back();
+	task.name = name;
+	task.work = std::move(work);
+	task.affinity = affinity;
+
+	for (TaskId dependency : dependencies)
+	{
+		addDependency(id, dependency);
+	}
+
+	return id;
+}
+
+void TaskGraph::addDependency(TaskId task, TaskId dependency)
+{
+	if (task >= m_tasks.size() || dependency >= task)
+	{
+		throw std::runtime_error("Invalid task dependency.");
+	}
+
+	m_tasks[task].dependencies.push_back(dependency);
+	m_tasks[task].pendingDependencies += 1;
+	m_tasks[dependency].dependents.push_back(task);
+}
+
+void TaskGraph::run()
+{
+	m_start = Clock::now();
+
+	for (TaskId id = 0; id < m_tasks.size(); ++id)
+	{
+		if (m_tasks[id].pendingDependencies == 0)
+		{
+			schedule(id);
+		}
+	}
+
+	// dependents are scheduled before their dependency finishes,
+	// so the counter only drops to zero once all tasks are done
+	JobSystem::instance().wait(m_counter);
+
+	if (m_exception)
+	{
+		std::rethrow_exception(m_exception);
+	}
+}
+
+void TaskGraph::schedule(TaskId id)
+{
+	JobSystem::instance().run([this, id]() { execute(id); }, 
+		m_counter, m_tasks[id].affinity);
+}
+
+void TaskGraph::execute(TaskId id)
+{
+	Task& task = m_tasks[id];
+	task.thread = JobSystem::instance().workerIndex();
+	task.start = Clock::now();
+
+	// dependents still run, they have to cope with missing results
+	try
+	{
+		if (task.work)
+		{
+			task.work();
+		}
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_exception)
+		{
+			m_exception = std::current_exception();
+		}
+	}
+
+	task.end = Clock::now();
+
+	std::vector<TaskId> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (TaskId dependent : task.dependents)
+		{
+			if (--m_tasks[dependent].pendingDependencies == 0)
+			{
+				ready.push_back(dependent);
+			}
+		}
+	}
+
+	for (TaskId dependent : ready)
+	{
+		schedule(dependent);
+	}
+}
+
+void TaskGraph::logTimeline(const std::string& title) const
+{
+	if (m_tasks.empty())
+	{
+		return;
+	}
+
+	auto toMs = [this](Clock::time_point t) {
+		return std::chrono::duration<double, std::milli>(t - m_start).count();
+	};
+
+	std::vector<TaskId> order(m_tasks.size());
+	for (TaskId id = 0; id < order.size(); ++id)
+	{
+		order[id] = id;
+	}
+	std::sort(order.begin(), order.end(), [this](TaskId a, TaskId b) {
+		return m_tasks[a].start < m_tasks[b].start; });
+
+	std::string timeline;
+	for (TaskId id : order)
+	{
+		const Task& task = m_tasks[id];
+		const std::string thread = task.thread < 0 
+			? "main" : "worker " + std::to_string(task.thread);
+
+		timeline += string_format("\n  %9.2f - %9.2fms  %-9s  %s",
+			toMs(task.start), toMs(task.end), thread.c_str(), task.name.c_str());
+	}
+
+	// follow the dependency which finished last, starting at the last task
+	TaskId current = *std::max_element(order.begin(), order.end(), [this](TaskId a, TaskId b) {
+		return m_tasks[a].end < m_tasks[b].end; });
+
+	std::vector<TaskId> criticalPath{ current };
+	while (!m_tasks[current].dependencies.empty())
+	{
+		const std::vector<TaskId>& dependencies = m_tasks[current].dependencies;
+		current = *std::max_element(dependencies.begin(), dependencies.end(), [this](TaskId a, TaskId b) {
+			return m_tasks[a].end < m_tasks[b].end; });
+
+		criticalPath.push_back(current);
+	}
+
+	std::string path;
+	for (auto it = criticalPath.rbegin(); it != criticalPath.rend(); ++it)
+	{
+		const Task& task = m_tasks[*it];
+		path += string_format("\n  %9.2fms  %s",
+			std::chrono::duration<double, std::milli>(task.end - task.start).count(), task.name.c_str());
+	}
+
+	Logger::Info("%s timeline (%.2fms):%s\nCritical path:%s", title.c_str(),
+		toMs(m_tasks[criticalPath.front()].end),
+		timeline.c_str(), path.c_str());
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "GUI/IWidget.h"
+
+DECLARE_PTRS(TextureResidencyManager);
+
+class TextureResidencyWidget : public IWidget
+{
+public:
+
+	TextureResidencyWidget(const std::string& title, TextureResidencyManagerSPtr residency);
+
+	virtual ~TextureResidencyWidget();
+
+	virtual const std::string& name() const override;
+
+	virtual bool visible() const override;
+
+	virtual void setVisible(bool flag) override;
+
+	virtual void update(double deltaTime) override;
+
+	virtual void draw() override;
+
+private:
+
+	std::string m_title;
+
+	bool m_visible = false;
+
+	TextureResidencyManagerSPtr m_residency;
+
+	// budget slider value
+	int m_budgetMB = 0;
+};
@@ -62,6 +62,7 @@ void StatisticsWidget::draw()
 		double gpuTime = 0;
 		double cpuTime = 0;
 		int primitiveCount = 0;
+		int drawCalls = 0;
 
 		if (pass->isEnabled())
 		{
@@ -69,6 +70,7 @@ void StatisticsWidget::draw()
 			gpuTime = stats.gpuTimeMs;
 			cpuTime = stats.cpuTimeMs;
 			primitiveCount = static_cast<int>(stats.rendererdPrimitives);
+			drawCalls = static_cast<int>(stats.drawCalls);
 		}
 
 		if (m_detailView && pass->isEnabled())
@@ -77,6 +79,7 @@ void StatisticsWidget::draw()
 			ImGui::Text("GPU time: %.2fms", gpuTime);
 			ImGui::Text("CPU time: %.2fms", cpuTime);
 			ImGui::Text("Primitives: %i", primitiveCount);
+			ImGui::Text("Draw calls: %i", drawCalls);
 		}
 		else
 		{
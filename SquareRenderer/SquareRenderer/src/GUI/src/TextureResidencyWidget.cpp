@@ -0,0 +1,88 @@
+#include "GUI/TextureResidencyWidget.h"
+#include "GUI/imgui.h"
+#include "Renderer/TextureResidencyManager.h"
+#include "Texture/Texture2D.h"
+
+constexpr float BYTES_TO_MB = 1.f / (1024.f * 1024.f);
+
+TextureResidencyWidget::TextureResidencyWidget(const std::string& title, TextureResidencyManagerSPtr residency)
+	: m_title(title)
+	, m_residency(residency)
+	, m_budgetMB(static_cast<int>(residency->budget() / (1024 * 1024)))
+{
+}
+
+TextureResidencyWidget::~TextureResidencyWidget()
+{
+}
+
+const std::string& TextureResidencyWidget::name() const
+{
+	return m_title;
+}
+
+bool TextureResidencyWidget::visible() const
+{
+	return m_visible;
+}
+
+void TextureResidencyWidget::setVisible(bool flag)
+{
+	m_visible = flag;
+}
+
+void TextureResidencyWidget::update(double /*deltaTime*/)
+{
+	m_residency->setBudget(static_cast<size_t>(m_budgetMB) * 1024 * 1024);
+}
+
+void TextureResidencyWidget::draw()
+{
+	if (!visible()) return;
+
+	if (!ImGui::Begin(m_title.c_str(), &m_visible))
+	{
+		ImGui::End();
+		return;
+	}
+
+	ImGui::SliderInt("Budget (MB)", &m_budgetMB, 16, 4096);
+
+	ImGui::Text("Resident: %.2fMB", m_residency->residentBytes() * BYTES_TO_MB);
+	ImGui::Text("Requested: %.2fMB", m_residency->requestedBytes() * BYTES_TO_MB);
+
+	if (ImGui::BeginTable("Textures", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Texture");
+		ImGui::TableSetupColumn("Size");
+		ImGui::TableSetupColumn("Levels");
+		ImGui::TableSetupColumn("Resident (MB)");
+		ImGui::TableSetupColumn("Requested (MB)");
+		ImGui::TableHeadersRow();
+
+		for (const TextureResidencyManager::Entry& entry : m_residency->entries())
+		{
+			ImGui::TableNextRow();
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", entry.name.c_str());
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%dx%d", entry.texture->width(), entry.texture->height());
+
+			// base / storage / requested
+			ImGui::TableNextColumn();
+			ImGui::Text("%d/%d/%d", entry.texture->baseLevel(), entry.texture->storageLevel(), entry.requestedLevel);
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", m_residency->residentBytes(entry) * BYTES_TO_MB);
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", m_residency->requestedBytes(entry) * BYTES_TO_MB);
+		}
+
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
@@ -44,6 +44,9 @@ public:
 
 	UniformValue uniformDefaultValue(const std::string& name) const;
 
+	// false for uniforms the compiler removed
+	bool hasUniform(const std::string& name) const;
+
 	bool setUniformDefault(const std::string& name, const UniformValue& value);
 	bool setUniformDefault(const std::string& name, UniformValue&& value);
 	bool setUniformDefault(const std::string& name, ITextureSPtr texture);
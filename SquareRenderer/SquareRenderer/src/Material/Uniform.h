@@ -7,7 +7,7 @@
 
 enum class UniformType : unsigned int
 {
-	Invalid, Int, Float, Vec4, Mat4, Texture2D, Cubemap
+	Invalid, Int, Float, Vec4, Mat4, Texture2D, Cubemap, Texture3D
 };
 
 struct UniformValue
@@ -133,6 +133,11 @@ UniformValue ShaderProgram::uniformDefaultValue(const std::string& name) const
 	return UniformValue();
 }
 
+bool ShaderProgram::hasUniform(const std::string& name) const
+{
+	return fetchUniformLocation(name) != -1;
+}
+
 const std::unordered_map<std::string, UniformMetaInfo>& ShaderProgram::uniformMetaInfo() const
 {
 	return m_nameToUniformMetaInfo;
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Preprocessor/IBLCache.h"
+#include "Texture/TextureDefines.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+DECLARE_PTRS(MipChain);
+
+// CPU versions of the image based lighting precomputation of the render
+// engine for baking without a graphics context, the results have the
+// layout of the generated textures and can be written to the IBLCache
+namespace IBLBaker
+{
+	// resolutions and sample counts of the precomputation, 
+	// the defaults are the ones of the render engine
+	struct Settings
+	{
+		int diffuseWidth = 32;
+		float diffuseSampleDelta = .025f;
+		int specularWidth = 128;
+
+		// per roughness level, doubled with every level up to the maximum
+		uint32_t specularMinSamples = 32;
+		uint32_t specularMaxSamples = 512;
+
+		// L2 only holds low frequencies, a downsampled level is enough
+		int shWidth = 128;
+	};
+
+	struct Result
+	{
+		IBLCache::CubemapLevels diffuse;
+		IBLCache::CubemapLevels specular;
+		SphericalHarmonics::Coefficients irradianceSH;
+	};
+
+	// IBLCache key bound to the source file content, the width
+	// of the environment cubemap and the settings
+	uint64_t cacheKey(uint64_t sourceHash, int cubemapWidth, const Settings& settings);
+
+	// whole precomputation of an RGB float equirectangular image in upload
+	// order, rounded to half precision like the uploaded HDRI, the cubemap
+	// has half the image height like the sky of the SceneImporter
+	Result bake(const float* pixels, int width, int height, const Settings& settings = Settings());
+
+	// bakes the image decoded from sourcePath and writes its IBLCache entry,
+	// which the render engine loads instead of precomputing, so environments
+	// can be baked on machines without a graphics context
+	bool bakeToCache(const std::string& sourcePath, const float* pixels, int width, int height,
+		const Settings& settings = Settings());
+
+	// L2 irradiance of the finest level not wider than maxWidth
+	SphericalHarmonics::Coefficients irradianceSH(const IBLCache::CubemapLevels& source, int maxWidth);
+
+	// RGB half or float levels to tightly packed RGB floats, empty if unsupported
+	std::vector<float> toFloat(const IBLCache::CubemapLevels& levels);
+
+	// split sum scale and bias over NdotV in x and roughness in y like
+	// Util/IntegratedBRDF.frag, nullptr if the format is not RG half or float
+	MipChainUPtr integrateBRDF(int resolution, uint32_t sampleCount,
+		TextureFormat format = TextureFormat::RGHalf);
+
+	// RGB float pixels of a 2:1 image in upload order to cubemap faces like
+	// Util/Eqr2Cube.frag, the levels below are box filtered like glGenerateMipmap
+	IBLCache::CubemapLevels projectEquirectangular(const float* pixels, int width, int height,
+		int faceWidth, int levelCount, TextureFormat format = TextureFormat::RGBHalf);
+
+	// hemisphere convolution of RGB half or float levels like Util/IBLDiffuse.frag
+	IBLCache::CubemapLevels diffuseIrradiance(const IBLCache::CubemapLevels& source,
+		int width, float sampleDelta, TextureFormat format = TextureFormat::RGBHalf);
+
+	// filtered importance sampling of RGB half or float levels like
+	// Util/IBLSpecular.frag, the roughness reaches 1 at the 2x2 level
+	IBLCache::CubemapLevels specularIrradiance(const IBLCache::CubemapLevels& source,
+		int width, int levelCount, uint32_t minSamples, uint32_t maxSamples,
+		TextureFormat format = TextureFormat::RGBHalf);
+
+	float specularRoughness(int level, int width);
+
+	// single sample at the mirror level, doubled with every level from the minimum
+	uint32_t specularSampleCount(int level, uint32_t minSamples, uint32_t maxSamples);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Common/SphericalHarmonics.h"
+#include "Texture/TextureDefines.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// binary snapshot of the precomputed image based lighting of 
+// an environment map, stored next to the source file
+class IBLCache
+{
+public:
+
+	// bump on any change of the file layout or the precomputation
+	static constexpr uint32_t VERSION = 3;
+
+	// levels of a cubemap, six faces per level in upload order,
+	// no levels if the cubemap was not generated
+	struct CubemapLevels
+	{
+		TextureFormat format = TextureFormat::RGBHalf;
+		int width = 0;
+		int levelCount = 0;
+		std::vector<uint8_t> pixels;
+
+		// byte offset of the level in the pixels
+		size_t offset(int level) const;
+
+		// of all six faces
+		size_t levelSize(int level) const;
+	};
+
+	static std::string cachePath(const std::string& sourcePath);
+
+	static bool write(const std::string& cachePath,
+		uint64_t key,
+		const CubemapLevels& diffuse,
+		const CubemapLevels& specular,
+		const SphericalHarmonics::Coefficients& irradianceSH);
+
+	// false if the cache is missing, outdated or corrupt
+	static bool read(const std::string& cachePath,
+		uint64_t key,
+		CubemapLevels& outDiffuse,
+		CubemapLevels& outSpecular,
+		SphericalHarmonics::Coefficients& outIrradianceSH);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Common/Macros.h"
+
+#include <cstdint>
+#include <string>
+
+class IrradianceVolume;
+
+// binary snapshot of the baked probes of an irradiance volume, 
+// stored next to the scene file, partially baked volumes resume
+class IrradianceVolumeCache
+{
+public:
+
+	// bump on any change of the file layout or the bake
+	static constexpr uint32_t VERSION = 1;
+
+	static std::string cachePath(const std::string& scenePath);
+
+	static bool write(const std::string& cachePath,
+		uint64_t key,
+		const IrradianceVolume& volume);
+
+	// restores the baked probes, false if the cache is missing, 
+	// outdated, corrupt or of another resolution
+	static bool read(const std::string& cachePath,
+		uint64_t key,
+		IrradianceVolume& volume);
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Common/Macros.h"
+
+DECLARE_PTRS(Mesh);
+struct aiMesh;
+
+// conversion of imported assimp meshes into the upload layout,
+// without material library or graphics API access
+namespace MeshConversion
+{
+	// nullptr if the mesh lacks triangles, normals, uvs or tangents,
+	// allocates the vertex and index buffers once each and moves them
+	// into the mesh, which shares one allocation with its control block
+	MeshSPtr fromAssimp(const aiMesh& mesh);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Common/Macros.h"
+
+#include <cstdint>
+#include <string>
+
+DECLARE_PTRS(ModelData);
+
+// binary snapshot of imported model data with GPU ready 
+// vertex and index blobs, stored next to the source file
+class ModelCache
+{
+public:
+
+	// bump on any change of the file layout
+	static constexpr uint32_t VERSION = 2;
+
+	static std::string cachePath(const std::string& sourcePath);
+
+	static bool write(const std::string& cachePath,
+		uint64_t sourceHash,
+		uint64_t importFlags,
+		const ModelData& data);
+
+	// returns nullptr if the cache is missing, outdated or corrupt
+	static ModelDataUPtr read(const std::string& cachePath,
+		uint64_t sourceHash,
+		uint64_t importFlags);
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Common/Math3D.h"
+#include "Scene/BoundingBox.h"
+
+#include <string>
+#include <vector>
+
+DECLARE_PTRS(Mesh);
+DECLARE_PTRS(ModelData);
+
+// imported model before materials are resolved, can be created 
+// without touching the material library or the graphics API
+class ModelData
+{
+public:
+
+	struct Node
+	{
+		std::string name;
+		glm::mat4 localTransform = glm::mat4(1);
+		BoundingBox bounds;
+		int mesh = -1;
+		int material = -1;
+		std::vector<Node> children;
+	};
+
+	std::vector<std::string> materials;
+
+	std::vector<MeshSPtr> meshes;
+
+	Node root;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Common/Macros.h"
+#include "Preprocessor/ModelData.h"
 
 #include <string>
 #include <vector>
@@ -11,7 +12,6 @@ DECLARE_PTRS(Mesh);
 DECLARE_PTRS(Material);
 DECLARE_PTRS(MaterialLibrary);
 struct aiMaterial;
-struct aiMesh;
 struct aiScene;
 struct aiNode;
 
@@ -27,23 +27,40 @@ public:
 
 	void setUseExistingMaterials(bool useExisting);
 
+	// processed models are stored in a binary cache next to the source
+	void setUseCache(bool useCache);
+
 	SceneNodeSPtr loadFromFile(const std::string& filepath);
 
+	// file import without material library access, safe on worker threads
+	ModelDataUPtr parse(const std::string& filepath);
+
+	// resolves the materials and creates the node hierarchy
+	SceneNodeSPtr build(const ModelData& data);
+
 private:
 
-	MaterialSPtr processMaterial(const aiMaterial& mat);
+	std::string processMaterial(const aiMaterial& mat);
 
-	MeshSPtr processMesh(const aiMesh& mesh);
+	MaterialSPtr resolveMaterial(const std::string& materialName);
 
-	SceneNodeSPtr processNode(
+	bool processNode(
 		const aiNode& currentNode,
-		const std::vector<MaterialSPtr>& materialSet,
-		const std::vector<std::pair<MeshSPtr, unsigned int>>& meshSet);
+		const aiScene& scene,
+		const ModelData& data,
+		ModelData::Node& newNode);
+
+	SceneNodeSPtr buildNode(
+		const ModelData::Node& node,
+		const ModelData& data,
+		const std::vector<MaterialSPtr>& materialSet);
 
 	MaterialLibrarySPtr m_matLib;
 
 	std::string m_defaultProgramName;
 
 	bool m_useExistingMaterials = true;
+
+	bool m_useCache = true;
 };
 
@@ -1,31 +1,69 @@
 #pragma once
 
 #include "Common/Macros.h"
+#include "Common/TaskGraph.h"
+#include "Preprocessor/TextureImporter.h"
 
+#include <set>
 #include <string>
+#include <unordered_map>
 
 DECLARE_PTRS(Scene);
+DECLARE_PTRS(SceneNode);
 DECLARE_PTRS(GraphicsAPI);
 DECLARE_PTRS(MaterialLibrary);
+DECLARE_PTRS(Mesh);
 DECLARE_PTRS(MeshImporter);
 DECLARE_PTRS(RenderEngine);
+DECLARE_PTRS(Texture2D);
 
 class SceneImporter
 {
 public:
 
-	explicit SceneImporter(GraphicsAPISPtr api, MaterialLibrarySPtr matLib, RenderEngineSPtr renderEngine);
+	// material textures are streamed by the texture importer, 
+	// which has to be updated once per frame
+	explicit SceneImporter(GraphicsAPISPtr api, MaterialLibrarySPtr matLib, 
+		RenderEngineSPtr renderEngine, TextureImporterSPtr textureImporter);
 
 	~SceneImporter();
 
 	SceneUPtr importFromFile(const std::string& filepath);
 
+	void clearModelCache();
+
 private:
 
+	// returns the task storing the model prototype in the cache
+	TaskGraph::TaskId scheduleModel(TaskGraph& graph,
+		const std::string& filepath,
+		const std::string& defaultProgramName,
+		bool useExistingMaterials,
+		std::unordered_map<std::string, TaskGraph::TaskId>& scheduled);
+
+	// returns a dummy texture which is filled by the upload task,
+	// for textures other import tasks depend on
+	Texture2DSPtr scheduleTexture(TaskGraph& graph,
+		const std::string& filepath,
+		TextureImporter::ImportFormat format,
+		TextureSampler sampler,
+		TaskGraph::TaskId& outUploadTask,
+		const TextureImporter::ProcessingSettings& processing = TextureImporter::ProcessingSettings());
+
 	GraphicsAPISPtr m_api;
 
 	MaterialLibrarySPtr m_matLib;
 
 	RenderEngineSPtr m_renderEngine;
+
+	TextureImporterSPtr m_textureImporter;
+
+	// imported model hierarchies keyed by path and import options,
+	// references to the same model share meshes and materials
+	std::unordered_map<std::string, SceneNodeSPtr> m_modelCache;
+
+	// meshes of models instanced as static keep their client data
+	// regardless of the residency, later imports may batch them again
+	std::set<MeshSPtr> m_staticMeshes;
 };
 
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Common/Macros.h"
+
+#include <cstdint>
+#include <string>
+
+DECLARE_PTRS(MipChain);
+
+// binary snapshot of a decoded image and its mip levels, 
+// stored next to the source file
+class TextureCache
+{
+public:
+
+	// bump on any change of the file layout or the level processing
+	static constexpr uint32_t VERSION = 3;
+
+	static std::string cachePath(const std::string& sourcePath);
+
+	static bool write(const std::string& cachePath,
+		uint64_t sourceHash,
+		uint64_t importFlags,
+		const MipChain& mips);
+
+	// returns nullptr if the cache is missing, outdated or corrupt
+	static MipChainUPtr read(const std::string& cachePath,
+		uint64_t sourceHash,
+		uint64_t importFlags);
+};
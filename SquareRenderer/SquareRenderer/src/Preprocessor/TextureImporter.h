@@ -3,11 +3,21 @@
 #include "Common/Macros.h"
 #include "Texture/TextureDefines.h"
 
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 #include <string>
-#include <future>
+#include <unordered_map>
+#include <vector>
 
 DECLARE_PTRS(Texture2D);
 DECLARE_PTRS(GraphicsAPI);
+DECLARE_PTRS(JobCounter);
+DECLARE_PTRS(MappedFile);
+DECLARE_PTRS(MipChain);
+DECLARE_PTRS(TextureResidencyManager);
+DECLARE_PTRS(TextureImporter);
 
 class TextureImporter
 {
@@ -17,23 +27,110 @@ public:
         Auto, R, RG, RGB, RGBA, sRGB, sRGBA
     };
 
+    // block compression of 8 bit images, Auto picks the codec from the
+    // channel count: BC4 for masks, BC5 for normal maps, BC1 or BC7 for color,
+    // HDR images stay half float unless BC6H or RGB9E5 is requested
+    enum class Compression
+    {
+        None, Auto, BC1, BC3, BC4, BC5, BC7, BC6H, RGB9E5
+    };
+
+    // applied to the decoded image before it is cached
+    struct ProcessingSettings
+    {
+        // initialized in the constructor, the struct is used
+        // as a default argument within this class
+        ProcessingSettings()
+            : compression(Compression::None)
+            , normalMap(false)
+            , alphaCutoff(0.f)
+        {
+        }
+
+        Compression compression;
+
+        // mip levels of tangent space normals are renormalized
+        bool normalMap;
+
+        // alpha test threshold whose coverage all mip levels keep, 0 disables
+        float alphaCutoff;
+    };
+
+    // source of one channel of a packed texture, the
+    // constant value is used if there is no file
+    struct PackedChannel
+    {
+        std::string path;
+        uint8_t value = 0;
+    };
+
+    // limits of the asynchronous imports
+    struct StreamingSettings
+    {
+        size_t maxConcurrentDecodes = 4;
+
+        // decoded images in flight and waiting for upload, in bytes
+        size_t memoryBudget = 256 * 1024 * 1024;
+
+        // time spent on uploads per update
+        double uploadBudgetMs = 2.0;
+    };
+
+    // imports answered with an earlier texture of the same options
+    struct ImportStatistics
+    {
+        size_t requests = 0;
+
+        // same canonical path
+        size_t pathHits = 0;
+
+        // byte identical file under another path, asynchronous 
+        // imports find it before their decode and skip it
+        size_t contentHits = 0;
+
+        // decoded size of the deduplicated imports
+        size_t bytesSaved = 0;
+    };
+
     TextureImporter(GraphicsAPISPtr api);
 
     ~TextureImporter();
 
+    void setStreamingSettings(const StreamingSettings& settings);
+
+    const StreamingSettings& streamingSettings() const;
+
+    // decoded mip chains are stored in a binary cache next to the source
+    void setUseCache(bool useCache);
+
+    // streamed textures keep only their coarse levels resident and
+    // are handed over to the manager with their mip chain
+    void setResidencyManager(TextureResidencyManagerSPtr residency);
+
     Texture2DSPtr importFromFile(
         const std::string& filePath,
         ImportFormat format = ImportFormat::Auto,
         TextureSampler sampler = TextureSampler());
 
+    // returns an unallocated texture, its mip levels are uploaded
+    // coarse to fine by later updates
     Texture2DSPtr importFromFileAsync(
         const std::string& filePath,
         ImportFormat format = ImportFormat::Auto,
-        TextureSampler sampler = TextureSampler());
+        TextureSampler sampler = TextureSampler(),
+        const ProcessingSettings& processing = ProcessingSettings());
+
+    // starts queued decodes, uploads the coarse levels of all decoded
+    // images and refines them within the upload budget, 
+    // called once per frame on the main thread
+    void update();
 
     void waitForCompletion();
 
-private:
+    // asynchronous imports not uploaded yet
+    size_t pendingCount() const;
+
+    const ImportStatistics& importStatistics() const;
 
     struct ImageWrapper
     {
@@ -45,17 +142,140 @@ private:
         void* data;
     };
 
+    // decodes the file without any API call, safe on worker threads
+    ImageWrapper loadRawImageFile(const std::string& path, ImportFormat format = ImportFormat::Auto) const;
+
+    // allocates the texture and copies all levels, blocking
+    bool upload(Texture2DSPtr texture, const MipChain& mips);
+
+    // reads the cached mip chain or decodes the file, generates 
+    // the levels and compresses them, safe on worker threads, 
+    // outSourceHash receives the content hash of the file
+    MipChainUPtr loadMipChain(const std::string& path, 
+        ImportFormat format = ImportFormat::Auto, 
+        TextureSampler sampler = TextureSampler(),
+        const ProcessingSettings& processing = ProcessingSettings(),
+        uint64_t* outSourceHash = nullptr) const;
+
+    // interleaves the red channels of up to four 8 bit images into one
+    // RGBA chain, read from the cache if the sources did not change,
+    // safe on worker threads
+    MipChainUPtr loadPackedMipChain(const std::array<PackedChannel, 4>& channels,
+        TextureSampler sampler = TextureSampler(),
+        const ProcessingSettings& processing = ProcessingSettings()) const;
+
+private:
+
+    ImageWrapper decodeImage(const MappedFile& file, const std::string& path, ImportFormat format) const;
+
+    // loadMipChain of an already mapped and hashed file
+    MipChainUPtr loadMipChain(const MappedFile& source, uint64_t sourceHash, 
+        const std::string& path, ImportFormat format, 
+        const TextureSampler& sampler, const ProcessingSettings& processing) const;
+
+    // generates the mip levels and compresses them
+    void processLevels(MipChainUPtr& mips, const TextureSampler& sampler,
+        const ProcessingSettings& processing, const std::string& name) const;
+
     struct AsyncTask
     {
         Texture2DSPtr texture;
-        std::future<ImageWrapper> result;
+        std::string filePath;
+        ImportFormat format;
+        ProcessingSettings processing;
+        size_t decodedSize;
+        MipChainUPtr mips;
+
+        std::string pathKey;
+
+        // import options hash, the content hash is written by the decode
+        uint64_t options;
+        uint64_t sourceHash;
+
+        // earlier import of the same content, set instead of the mips
+        Texture2DSPtr sharedTexture;
+
+        // next level to upload, below finestLevel once all are resident
+        int nextLevel;
+
+        // 0 unless the residency manager streams the finer levels
+        int finestLevel;
     };
 
-    std::vector<AsyncTask> m_runningTasks;
+    typedef std::shared_ptr<AsyncTask> AsyncTaskSPtr;
 
-    GraphicsAPISPtr m_api;
+    // textures stay cached only as long as they are used
+    struct ImportedTexture
+    {
+        std::weak_ptr<Texture2D> texture;
+        size_t size;
+    };
 
-    ImageWrapper loadRawImageFile(const std::string& path, ImportFormat format = ImportFormat::Auto) const;
+    // returns the texture of an earlier import with the same options and 
+    // canonical path, no file access so it is cheap on the main thread
+    Texture2DSPtr findImported(const std::string& filePath, uint64_t options,
+        std::string& outPathKey);
 
-};
+    // returns the texture of an earlier import with the same options and
+    // content, the hash comes from the decode of the new import
+    Texture2DSPtr findImportedByContent(const std::string& filePath, 
+        uint64_t contentKey, const std::string& pathKey);
+
+    void addImported(const std::string& pathKey, uint64_t contentKey,
+        Texture2DSPtr texture, size_t size);
+
+    // returns the live texture registered for the content or registers 
+    // the given one, called by the decode jobs before they decode
+    Texture2DSPtr claimContent(uint64_t contentKey, Texture2DSPtr texture, size_t size);
+
+    // moves the images finished by the workers to the upload queue
+    void collectDecoded();
+
+    void dispatchDecodes();
+
+    // returns false while the upload ring is busy
+    bool uploadNextLevel(AsyncTask& task);
+
+    // hands the uploaded texture over to the residency manager
+    void finish(AsyncTask& task);
 
+    void release(AsyncTask& task);
+
+    StreamingSettings m_settings;
+
+    // waiting for a decode slot
+    std::deque<AsyncTaskSPtr> m_queuedTasks;
+
+    // written by the workers
+    std::vector<AsyncTaskSPtr> m_decodedTasks;
+
+    std::mutex m_decodedMutex;
+
+    std::deque<AsyncTaskSPtr> m_uploadTasks;
+
+    JobCounterSPtr m_decodeCounter;
+
+    size_t m_activeDecodes = 0;
+
+    size_t m_reservedMemory = 0;
+
+    size_t m_peakMemory = 0;
+
+    size_t m_streamedCount = 0;
+
+    bool m_useCache = true;
+
+    std::unordered_map<std::string, ImportedTexture> m_importedByPath;
+
+    // shared with the decode jobs, in flight imports are registered
+    // with their texture before it is uploaded
+    std::unordered_map<uint64_t, ImportedTexture> m_importedByContent;
+
+    std::mutex m_contentMutex;
+
+    ImportStatistics m_importStatistics;
+
+    TextureResidencyManagerSPtr m_residency;
+
+    GraphicsAPISPtr m_api;
+};
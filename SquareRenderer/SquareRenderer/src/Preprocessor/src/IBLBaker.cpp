@@ -0,0 +1,728 @@
+#include "Preprocessor/IBLBaker.h"
+#include "Common/Hash.h"
+#include "Common/ImportanceSampling.h"
+#include "Common/JobSystem.h"
+#include "Common/Logger.h"
+#include "Common/MappedFile.h"
+#include "Common/SphericalHarmonics.h"
+#include "Texture/FloatPacking.h"
+#include "Texture/MipChain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// every x64 target supports SSE2
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define IBL_BAKER_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr float PI = 3.14159265358979f;
+
+	// rows per job
+	constexpr size_t ROW_GRAIN = 4;
+
+	// tightly packed RGB float levels, six faces per level
+	struct FloatCube
+	{
+		const float* pixels = nullptr;
+		int width = 0;
+		int levelCount = 0;
+		std::vector<size_t> offsets;
+
+		FloatCube(const float* data, int baseWidth, int levels)
+			: pixels(data), width(baseWidth), levelCount(levels)
+		{
+			size_t offset = 0;
+			for (int level = 0; level < levelCount; ++level)
+			{
+				offsets.push_back(offset);
+				const size_t size = std::max(1, width >> level);
+				offset += size * size * 6 * 3;
+			}
+		}
+	};
+
+	// tangent space samples, structure of arrays padded to a multiple of four
+	struct SampleSet
+	{
+		std::vector<float> x, y, z, weight, lod;
+
+		size_t count = 0;
+
+		void add(float sx, float sy, float sz, float sampleWeight, float sampleLod)
+		{
+			x.push_back(sx);
+			y.push_back(sy);
+			z.push_back(sz);
+			weight.push_back(sampleWeight);
+			lod.push_back(sampleLod);
+			++count;
+		}
+
+		void pad()
+		{
+			while (x.size() % 4 != 0)
+			{
+				add(0.f, 0.f, 1.f, 0.f, 0.f);
+				--count;
+			}
+		}
+	};
+
+	size_t floatCount(int width, int levelCount)
+	{
+		size_t count = 0;
+		for (int level = 0; level < levelCount; ++level)
+		{
+			const size_t size = std::max(1, width >> level);
+			count += size * size * 6 * 3;
+		}
+		return count;
+	}
+
+	IBLCache::CubemapLevels pack(const std::vector<float>& pixels, int width, int levelCount, TextureFormat format)
+	{
+		IBLCache::CubemapLevels result;
+		if (format != TextureFormat::RGBHalf && format != TextureFormat::RGBFloat)
+		{
+			return result;
+		}
+
+		result.format = format;
+		result.width = width;
+		result.levelCount = levelCount;
+		result.pixels.resize(result.offset(levelCount));
+
+		if (format == TextureFormat::RGBHalf)
+		{
+			FloatPacking::toHalf(pixels.data(), reinterpret_cast<uint16_t*>(result.pixels.data()), pixels.size());
+		}
+		else
+		{
+			std::memcpy(result.pixels.data(), pixels.data(), pixels.size() * sizeof(float));
+		}
+
+		return result;
+	}
+
+	// GL face selection, see cubemap texture selection in the GL specification
+	void cubeFace(float x, float y, float z, int& face, float& s, float& t)
+	{
+		const float ax = std::abs(x);
+		const float ay = std::abs(y);
+		const float az = std::abs(z);
+
+		float sc, tc, ma;
+		if (ax >= ay && ax >= az)
+		{
+			face = x > 0.f ? 0 : 1;
+			ma = ax;
+			sc = x > 0.f ? -z : z;
+			tc = -y;
+		}
+		else if (ay >= az)
+		{
+			face = y > 0.f ? 2 : 3;
+			ma = ay;
+			sc = x;
+			tc = y > 0.f ? z : -z;
+		}
+		else
+		{
+			face = z > 0.f ? 4 : 5;
+			ma = az;
+			sc = z > 0.f ? x : -x;
+			tc = -y;
+		}
+
+		s = .5f * (sc / ma + 1.f);
+		t = .5f * (tc / ma + 1.f);
+	}
+
+	// bilinear, clamped to the face instead of filtering across the seams
+	void sampleFace(const FloatCube& cube, int level, int face, float s, float t, float* rgb)
+	{
+		const int width = std::max(1, cube.width >> level);
+		const float* pixels = cube.pixels + cube.offsets[level] + static_cast<size_t>(face) * width * width * 3;
+
+		const float px = s * width - .5f;
+		const float py = t * width - .5f;
+		const float fx = px - std::floor(px);
+		const float fy = py - std::floor(py);
+
+		const int x0 = std::clamp(static_cast<int>(std::floor(px)), 0, width - 1);
+		const int y0 = std::clamp(static_cast<int>(std::floor(py)), 0, width - 1);
+		const int x1 = std::min(x0 + 1, width - 1);
+		const int y1 = std::min(y0 + 1, width - 1);
+
+		const float* p00 = pixels + (static_cast<size_t>(y0) * width + x0) * 3;
+		const float* p10 = pixels + (static_cast<size_t>(y0) * width + x1) * 3;
+		const float* p01 = pixels + (static_cast<size_t>(y1) * width + x0) * 3;
+		const float* p11 = pixels + (static_cast<size_t>(y1) * width + x1) * 3;
+
+		for (int c = 0; c < 3; ++c)
+		{
+			const float top = p00[c] + (p10[c] - p00[c]) * fx;
+			const float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+			rgb[c] = top + (bottom - top) * fy;
+		}
+	}
+
+	// trilinear like textureLod
+	void sampleCube(const FloatCube& cube, float x, float y, float z, float lod, float* rgb)
+	{
+		int face;
+		float s, t;
+		cubeFace(x, y, z, face, s, t);
+
+		lod = std::clamp(lod, 0.f, static_cast<float>(cube.levelCount - 1));
+		const int level = static_cast<int>(lod);
+		const float blend = lod - level;
+
+		sampleFace(cube, level, face, s, t, rgb);
+		if (blend > 0.f && level + 1 < cube.levelCount)
+		{
+			float coarse[3];
+			sampleFace(cube, level + 1, face, s, t, coarse);
+			for (int c = 0; c < 3; ++c)
+			{
+				rgb[c] += (coarse[c] - rgb[c]) * blend;
+			}
+		}
+	}
+
+	// weighted sum of the samples rotated into the frame, the rotation
+	// runs four samples at a time, the fetches stay scalar
+	float convolve(const FloatCube& cube, const SampleSet& samples,
+		const float* tangent, const float* bitangent, const float* normal, float* rgb)
+	{
+		alignas(16) float dx[4];
+		alignas(16) float dy[4];
+		alignas(16) float dz[4];
+
+		float totalWeight = 0.f;
+		rgb[0] = rgb[1] = rgb[2] = 0.f;
+
+		for (size_t i = 0; i < samples.count; i += 4)
+		{
+#ifdef IBL_BAKER_SSE
+			const __m128 sx = _mm_loadu_ps(&samples.x[i]);
+			const __m128 sy = _mm_loadu_ps(&samples.y[i]);
+			const __m128 sz = _mm_loadu_ps(&samples.z[i]);
+
+			_mm_store_ps(dx, _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(sx, _mm_set1_ps(tangent[0])),
+				_mm_mul_ps(sy, _mm_set1_ps(bitangent[0]))),
+				_mm_mul_ps(sz, _mm_set1_ps(normal[0]))));
+			_mm_store_ps(dy, _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(sx, _mm_set1_ps(tangent[1])),
+				_mm_mul_ps(sy, _mm_set1_ps(bitangent[1]))),
+				_mm_mul_ps(sz, _mm_set1_ps(normal[1]))));
+			_mm_store_ps(dz, _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(sx, _mm_set1_ps(tangent[2])),
+				_mm_mul_ps(sy, _mm_set1_ps(bitangent[2]))),
+				_mm_mul_ps(sz, _mm_set1_ps(normal[2]))));
+#else
+			for (size_t lane = 0; lane < 4; ++lane)
+			{
+				const float sx = samples.x[i + lane];
+				const float sy = samples.y[i + lane];
+				const float sz = samples.z[i + lane];
+				dx[lane] = sx * tangent[0] + sy * bitangent[0] + sz * normal[0];
+				dy[lane] = sx * tangent[1] + sy * bitangent[1] + sz * normal[1];
+				dz[lane] = sx * tangent[2] + sy * bitangent[2] + sz * normal[2];
+			}
+#endif
+
+			const size_t lanes = std::min<size_t>(4, samples.count - i);
+			for (size_t lane = 0; lane < lanes; ++lane)
+			{
+				const float weight = samples.weight[i + lane];
+
+				float color[3];
+				sampleCube(cube, dx[lane], dy[lane], dz[lane], samples.lod[i + lane], color);
+				rgb[0] += color[0] * weight;
+				rgb[1] += color[1] * weight;
+				rgb[2] += color[2] * weight;
+				totalWeight += weight;
+			}
+		}
+
+		return totalWeight;
+	}
+
+	void cross(const float* a, const float* b, float* result)
+	{
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	void normalize(float* v)
+	{
+		const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+
+	// split sum terms of one sample, see Util/IntegratedBRDF.frag
+	void integrateSample(float NdotV, float k, float cosPhi, float cosTheta, float& a, float& b)
+	{
+		const float sinTheta = std::sqrt(std::max(1.f - cosTheta * cosTheta, 0.f));
+		const float Hx = cosPhi * sinTheta;
+		const float Hz = cosTheta;
+
+		const float Vx = std::sqrt(1.f - NdotV * NdotV);
+		const float VdotH = Vx * Hx + NdotV * Hz;
+		const float NdotL = 2.f * VdotH * Hz - NdotV;
+		if (NdotL <= 0.f)
+		{
+			return;
+		}
+
+		const float clampedVdotH = std::clamp(VdotH, 0.f, 1.f);
+		const float G = (NdotL / (NdotL * (1.f - k) + k)) * (NdotV / (NdotV * (1.f - k) + k));
+		const float Gvis = G * clampedVdotH / (Hz * NdotV);
+
+		const float f = 1.f - clampedVdotH;
+		const float Fc = f * f * f * f * f;
+
+		a += (1.f - Fc) * Gvis;
+		b += Fc * Gvis;
+	}
+}
+
+std::vector<float> IBLBaker::toFloat(const IBLCache::CubemapLevels& levels)
+{
+	std::vector<float> result;
+	if (levels.format != TextureFormat::RGBHalf && levels.format != TextureFormat::RGBFloat)
+	{
+		return result;
+	}
+
+	result.resize(floatCount(levels.width, levels.levelCount));
+	if (levels.pixels.size() < levels.offset(levels.levelCount))
+	{
+		result.clear();
+	}
+	else if (levels.format == TextureFormat::RGBHalf)
+	{
+		FloatPacking::fromHalf(reinterpret_cast<const uint16_t*>(levels.pixels.data()), result.data(), result.size());
+	}
+	else
+	{
+		std::memcpy(result.data(), levels.pixels.data(), result.size() * sizeof(float));
+	}
+
+	return result;
+}
+
+MipChainUPtr IBLBaker::integrateBRDF(int resolution, uint32_t sampleCount, TextureFormat format)
+{
+	if ((format != TextureFormat::RGHalf && format != TextureFormat::RGFloat) || sampleCount == 0)
+	{
+		return nullptr;
+	}
+
+	// everything but the roughness term of the GGX samples is shared by all texels
+	std::vector<float> cosPhi(sampleCount);
+	std::vector<float> xiY(sampleCount);
+	for (uint32_t i = 0; i < sampleCount; ++i)
+	{
+		const glm::vec2 xi = ImportanceSampling::hammersley(i, sampleCount);
+		cosPhi[i] = std::cos(2.f * PI * xi.x);
+		xiY[i] = xi.y;
+	}
+
+	std::vector<float> pixels(static_cast<size_t>(resolution) * resolution * 2);
+
+	JobSystem::instance().parallelFor(static_cast<size_t>(resolution), [&](size_t y) {
+		const float roughness = (y + .5f) / resolution;
+		const float a = roughness * roughness;
+		const float a2 = a * a;
+		const float k = a / 2.f;
+
+		for (int x = 0; x < resolution; ++x)
+		{
+			const float NdotV = (x + .5f) / resolution;
+
+			float A = 0.f;
+			float B = 0.f;
+			uint32_t i = 0;
+
+#ifdef IBL_BAKER_SSE
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.f);
+			const __m128 two = _mm_set1_ps(2.f);
+			const __m128 vK = _mm_set1_ps(k);
+			const __m128 vA2 = _mm_set1_ps(a2 - 1.f);
+			const __m128 vNdotV = _mm_set1_ps(NdotV);
+			const __m128 vVx = _mm_set1_ps(std::sqrt(1.f - NdotV * NdotV));
+
+			// G1 of the view is constant over the samples
+			const __m128 G1V = _mm_set1_ps(NdotV / (NdotV * (1.f - k) + k));
+
+			__m128 sumA = zero;
+			__m128 sumB = zero;
+			for (; i + 4 <= sampleCount; i += 4)
+			{
+				const __m128 u = _mm_loadu_ps(&xiY[i]);
+				const __m128 cosTheta = _mm_sqrt_ps(_mm_div_ps(_mm_sub_ps(one, u), _mm_add_ps(one, _mm_mul_ps(vA2, u))));
+				const __m128 sinTheta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosTheta, cosTheta)), zero));
+
+				const __m128 Hx = _mm_mul_ps(_mm_loadu_ps(&cosPhi[i]), sinTheta);
+				const __m128 VdotH = _mm_add_ps(_mm_mul_ps(vVx, Hx), _mm_mul_ps(vNdotV, cosTheta));
+				const __m128 NdotL = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(two, VdotH), cosTheta), vNdotV);
+				const __m128 valid = _mm_cmpgt_ps(NdotL, zero);
+
+				const __m128 clampedVdotH = _mm_min_ps(_mm_max_ps(VdotH, zero), one);
+				const __m128 G1L = _mm_div_ps(NdotL, _mm_add_ps(_mm_mul_ps(NdotL, _mm_sub_ps(one, vK)), vK));
+				const __m128 Gvis = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(G1L, G1V), clampedVdotH), _mm_mul_ps(cosTheta, vNdotV));
+
+				const __m128 f = _mm_sub_ps(one, clampedVdotH);
+				const __m128 f2 = _mm_mul_ps(f, f);
+				const __m128 Fc = _mm_mul_ps(_mm_mul_ps(f2, f2), f);
+
+				// masked lanes may hold inf or NaN, the mask clears all bits
+				sumA = _mm_add_ps(sumA, _mm_and_ps(valid, _mm_mul_ps(_mm_sub_ps(one, Fc), Gvis)));
+				sumB = _mm_add_ps(sumB, _mm_and_ps(valid, _mm_mul_ps(Fc, Gvis)));
+			}
+
+			alignas(16) float lanesA[4];
+			alignas(16) float lanesB[4];
+			_mm_store_ps(lanesA, sumA);
+			_mm_store_ps(lanesB, sumB);
+			A += (lanesA[0] + lanesA[1]) + (lanesA[2] + lanesA[3]);
+			B += (lanesB[0] + lanesB[1]) + (lanesB[2] + lanesB[3]);
+#endif
+
+			for (; i < sampleCount; ++i)
+			{
+				const float cosTheta = std::sqrt((1.f - xiY[i]) / (1.f + (a2 - 1.f) * xiY[i]));
+				integrateSample(NdotV, k, cosPhi[i], cosTheta, A, B);
+			}
+
+			float* texel = &pixels[(y * resolution + x) * 2];
+			texel[0] = A / sampleCount;
+			texel[1] = B / sampleCount;
+		}
+	}, ROW_GRAIN);
+
+	MipChainUPtr result = std::make_unique<MipChain>(format, resolution, resolution, false);
+	if (format == TextureFormat::RGHalf)
+	{
+		FloatPacking::toHalf(pixels.data(), reinterpret_cast<uint16_t*>(result->data()), pixels.size());
+	}
+	else
+	{
+		std::memcpy(result->data(), pixels.data(), pixels.size() * sizeof(float));
+	}
+
+	return result;
+}
+
+IBLCache::CubemapLevels IBLBaker::projectEquirectangular(const float* pixels, int width, int height,
+	int faceWidth, int levelCount, TextureFormat format)
+{
+	std::vector<float> faces(floatCount(faceWidth, levelCount));
+
+	const size_t rowCount = static_cast<size_t>(faceWidth) * 6;
+	JobSystem::instance().parallelFor(rowCount, [&](size_t index) {
+		const int face = static_cast<int>(index / faceWidth);
+		const int y = static_cast<int>(index % faceWidth);
+		float* row = &faces[index * faceWidth * 3];
+
+		for (int x = 0; x < faceWidth; ++x)
+		{
+			const glm::vec3 direction = SphericalHarmonics::cubemapDirection(face, x, y, faceWidth);
+
+			// -z points to the center of the image
+			const float u = std::atan2(direction.z, direction.x) / (2.f * PI) + .75f;
+			const float v = std::asin(std::clamp(direction.y, -1.f, 1.f)) / PI + .5f;
+
+			// repeats horizontally, clamps at the poles
+			const float px = u * width - .5f;
+			const float py = std::clamp(v * height - .5f, 0.f, static_cast<float>(height - 1));
+			const float fx = px - std::floor(px);
+			const float fy = py - std::floor(py);
+
+			const int x0 = ((static_cast<int>(std::floor(px)) % width) + width) % width;
+			const int x1 = (x0 + 1) % width;
+			const int y0 = static_cast<int>(py);
+			const int y1 = std::min(y0 + 1, height - 1);
+
+			const float* p00 = pixels + (static_cast<size_t>(y0) * width + x0) * 3;
+			const float* p10 = pixels + (static_cast<size_t>(y0) * width + x1) * 3;
+			const float* p01 = pixels + (static_cast<size_t>(y1) * width + x0) * 3;
+			const float* p11 = pixels + (static_cast<size_t>(y1) * width + x1) * 3;
+
+			for (int c = 0; c < 3; ++c)
+			{
+				const float top = p00[c] + (p10[c] - p00[c]) * fx;
+				const float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+				row[x * 3 + c] = top + (bottom - top) * fy;
+			}
+		}
+	}, ROW_GRAIN);
+
+	// 2x2 box filter per face
+	const FloatCube cube(faces.data(), faceWidth, levelCount);
+	for (int level = 1; level < levelCount; ++level)
+	{
+		const int sourceWidth = std::max(1, faceWidth >> (level - 1));
+		const int levelWidth = std::max(1, faceWidth >> level);
+
+		const float* source = faces.data() + cube.offsets[level - 1];
+		float* target = faces.data() + cube.offsets[level];
+
+		JobSystem::instance().parallelFor(static_cast<size_t>(levelWidth) * 6, [&](size_t index) {
+			const size_t face = index / levelWidth;
+			const int y = static_cast<int>(index % levelWidth);
+			const float* sourceFace = source + face * sourceWidth * sourceWidth * 3;
+
+			const int y0 = std::min(y * 2, sourceWidth - 1);
+			const int y1 = std::min(y * 2 + 1, sourceWidth - 1);
+
+			for (int x = 0; x < levelWidth; ++x)
+			{
+				const int x0 = std::min(x * 2, sourceWidth - 1);
+				const int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+
+				for (int c = 0; c < 3; ++c)
+				{
+					target[(index * levelWidth + x) * 3 + c] = .25f * (
+						sourceFace[(static_cast<size_t>(y0) * sourceWidth + x0) * 3 + c] +
+						sourceFace[(static_cast<size_t>(y0) * sourceWidth + x1) * 3 + c] +
+						sourceFace[(static_cast<size_t>(y1) * sourceWidth + x0) * 3 + c] +
+						sourceFace[(static_cast<size_t>(y1) * sourceWidth + x1) * 3 + c]);
+				}
+			}
+		}, ROW_GRAIN);
+	}
+
+	return pack(faces, faceWidth, levelCount, format);
+}
+
+IBLCache::CubemapLevels IBLBaker::diffuseIrradiance(const IBLCache::CubemapLevels& source,
+	int width, float sampleDelta, TextureFormat format)
+{
+	const std::vector<float> sourcePixels = toFloat(source);
+	if (sourcePixels.empty())
+	{
+		return IBLCache::CubemapLevels();
+	}
+
+	const FloatCube cube(sourcePixels.data(), source.width, source.levelCount);
+
+	// the implicit level of the fragment shader for the target resolution
+	const float lod = std::log2(std::max(1.f, static_cast<float>(source.width) / width));
+
+	// same stepping as the shader, weighted by cos and sin of theta
+	SampleSet samples;
+	for (float phi = 0.f; phi < 2.f * PI; phi += sampleDelta)
+	{
+		for (float theta = 0.f; theta < .5f * PI; theta += sampleDelta)
+		{
+			samples.add(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta),
+				std::cos(theta) * std::sin(theta), lod);
+		}
+	}
+	const float normalization = PI / samples.count;
+	samples.pad();
+
+	std::vector<float> faces(floatCount(width, 1));
+
+	const size_t rowCount = static_cast<size_t>(width) * 6;
+	JobSystem::instance().parallelFor(rowCount, [&](size_t index) {
+		const int face = static_cast<int>(index / width);
+		const int y = static_cast<int>(index % width);
+		float* row = &faces[index * width * 3];
+
+		for (int x = 0; x < width; ++x)
+		{
+			const glm::vec3 direction = SphericalHarmonics::cubemapDirection(face, x, y, width);
+			const float normal[3] = { direction.x, direction.y, direction.z };
+
+			// right handed frame around the normal, x to the right of world up
+			float up[3] = { 0.f, 1.f, 0.f };
+			float right[3];
+			if (std::abs(normal[1]) > .999f)
+			{
+				up[1] = 0.f;
+				up[2] = 1.f;
+			}
+			cross(up, normal, right);
+			normalize(right);
+			cross(normal, right, up);
+
+			float rgb[3];
+			convolve(cube, samples, right, up, normal, rgb);
+
+			for (int c = 0; c < 3; ++c)
+			{
+				row[x * 3 + c] = rgb[c] * normalization;
+			}
+		}
+	}, ROW_GRAIN);
+
+	return pack(faces, width, 1, format);
+}
+
+IBLCache::CubemapLevels IBLBaker::specularIrradiance(const IBLCache::CubemapLevels& source,
+	int width, int levelCount, uint32_t minSamples, uint32_t maxSamples, TextureFormat format)
+{
+	const std::vector<float> sourcePixels = toFloat(source);
+	if (sourcePixels.empty())
+	{
+		return IBLCache::CubemapLevels();
+	}
+
+	const FloatCube cube(sourcePixels.data(), source.width, source.levelCount);
+
+	std::vector<float> faces(floatCount(width, levelCount));
+	const FloatCube target(faces.data(), width, levelCount);
+
+	for (int level = 0; level < levelCount; ++level)
+	{
+		const auto directions = ImportanceSampling::prefilterSamples(specularRoughness(level, width),
+			specularSampleCount(level, minSamples, maxSamples), source.width, source.levelCount);
+
+		// NdotL weighted
+		SampleSet samples;
+		for (const glm::vec4& sample : directions)
+		{
+			samples.add(sample.x, sample.y, sample.z, sample.z, sample.w);
+		}
+		samples.pad();
+
+		const int levelWidth = std::max(1, width >> level);
+		float* levelPixels = faces.data() + target.offsets[level];
+
+		JobSystem::instance().parallelFor(static_cast<size_t>(levelWidth) * 6, [&](size_t index) {
+			const int face = static_cast<int>(index / levelWidth);
+			const int y = static_cast<int>(index % levelWidth);
+			float* row = levelPixels + index * levelWidth * 3;
+
+			for (int x = 0; x < levelWidth; ++x)
+			{
+				const glm::vec3 direction = SphericalHarmonics::cubemapDirection(face, x, y, levelWidth);
+				const float normal[3] = { direction.x, direction.y, direction.z };
+
+				// same frame as Util/IBLSpecular.frag
+				const bool poleZ = std::abs(normal[2]) >= .999f;
+				const float up[3] = { poleZ ? 1.f : 0.f, 0.f, poleZ ? 0.f : 1.f };
+				float tangent[3];
+				float bitangent[3];
+				cross(up, normal, tangent);
+				normalize(tangent);
+				cross(normal, tangent, bitangent);
+
+				float rgb[3];
+				const float totalWeight = convolve(cube, samples, tangent, bitangent, normal, rgb);
+
+				for (int c = 0; c < 3; ++c)
+				{
+					row[x * 3 + c] = rgb[c] / std::max(totalWeight, .001f);
+				}
+			}
+		}, ROW_GRAIN);
+	}
+
+	return pack(faces, width, levelCount, format);
+}
+
+float IBLBaker::specularRoughness(int level, int width)
+{
+	// the 2x2 level is fully rough, the 1x1 level repeats it
+	const int roughLevel = std::max(1, static_cast<int>(std::ceil(std::log2(width))) - 1);
+	return std::min(1.f, static_cast<float>(level) / roughLevel);
+}
+
+uint32_t IBLBaker::specularSampleCount(int level, uint32_t minSamples, uint32_t maxSamples)
+{
+	if (level == 0)
+	{
+		return 1;
+	}
+
+	// wider lobes need more samples, the filtered source keeps them cheap
+	const int shift = std::min(level - 1, 16);
+	return std::min(minSamples << shift, maxSamples);
+}
+
+uint64_t IBLBaker::cacheKey(uint64_t sourceHash, int cubemapWidth, const Settings& settings)
+{
+	uint64_t key = Hash::combine(sourceHash, cubemapWidth);
+	key = Hash::combine(key, settings.diffuseWidth);
+	key = Hash::combine(key, settings.diffuseSampleDelta);
+	key = Hash::combine(key, settings.specularWidth);
+	key = Hash::combine(key, settings.specularMinSamples);
+	key = Hash::combine(key, settings.specularMaxSamples);
+	key = Hash::combine(key, settings.shWidth);
+	return key;
+}
+
+IBLBaker::Result IBLBaker::bake(const float* pixels, int width, int height, const Settings& settings)
+{
+	// the engine samples the HDRI uploaded with half precision
+	const size_t valueCount = static_cast<size_t>(width) * height * 3;
+	std::vector<uint16_t> halfPixels(valueCount);
+	std::vector<float> image(valueCount);
+	FloatPacking::toHalf(pixels, halfPixels.data(), valueCount);
+	FloatPacking::fromHalf(halfPixels.data(), image.data(), valueCount);
+
+	const int cubemapWidth = std::max(1, height / 2);
+	const IBLCache::CubemapLevels environment = projectEquirectangular(image.data(), width, height,
+		cubemapWidth, MipChain::maxLevelCount(cubemapWidth, cubemapWidth), TextureFormat::RGBHalf);
+
+	Result result;
+	result.irradianceSH = irradianceSH(environment, settings.shWidth);
+	result.diffuse = diffuseIrradiance(environment, settings.diffuseWidth, settings.diffuseSampleDelta);
+	result.specular = specularIrradiance(environment, settings.specularWidth,
+		MipChain::maxLevelCount(settings.specularWidth, settings.specularWidth),
+		settings.specularMinSamples, settings.specularMaxSamples);
+	return result;
+}
+
+bool IBLBaker::bakeToCache(const std::string& sourcePath, const float* pixels, int width, int height,
+	const Settings& settings)
+{
+	const MappedFile source(sourcePath);
+	if (!source.isValid() || width != height * 2)
+	{
+		Logger::Error("Could not bake image based lighting of '%s'", sourcePath.c_str());
+		return false;
+	}
+
+	const uint64_t key = cacheKey(Hash::content(source.data(), source.size()), height / 2, settings);
+	const Result result = bake(pixels, width, height, settings);
+
+	return IBLCache::write(IBLCache::cachePath(sourcePath), key, 
+		result.diffuse, result.specular, result.irradianceSH);
+}
+
+SphericalHarmonics::Coefficients IBLBaker::irradianceSH(const IBLCache::CubemapLevels& source, int maxWidth)
+{
+	SphericalHarmonics::Coefficients result;
+	result.fill(glm::vec3(0.f));
+
+	const std::vector<float> pixels = toFloat(source);
+	if (pixels.empty())
+	{
+		return result;
+	}
+
+	int level = 0;
+	while ((source.width >> level) > maxWidth && level + 1 < source.levelCount)
+	{
+		++level;
+	}
+
+	return SphericalHarmonics::convolveIrradiance(SphericalHarmonics::projectCubemap(
+		pixels.data() + floatCount(source.width, level), std::max(1, source.width >> level)));
+}
@@ -0,0 +1,151 @@
+#include "Preprocessor/IBLCache.h"
+#include "Common/BinaryIO.h"
+#include "Common/Logger.h"
+#include "Common/MappedFile.h"
+#include "Texture/MipChain.h"
+
+#include <algorithm>
+#include <cstring>
+
+constexpr char IBL_MAGIC[4] = { 'S', 'R', 'I', 'B' };
+
+struct IBLCubemapHeader
+{
+	uint32_t format;
+	int32_t width;
+	int32_t levelCount;
+};
+
+struct IBLCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	IBLCubemapHeader diffuse;
+	IBLCubemapHeader specular;
+	float irradianceSH[SphericalHarmonics::COEFFICIENT_COUNT * 3];
+};
+
+static_assert(sizeof(SphericalHarmonics::Coefficients) == sizeof(IBLCacheHeader::irradianceSH),
+	"Coefficients are copied as tightly packed floats");
+
+size_t IBLCache::CubemapLevels::offset(int level) const
+{
+	size_t result = 0;
+	for (int i = 0; i < level; ++i)
+	{
+		result += levelSize(i);
+	}
+	return result;
+}
+
+size_t IBLCache::CubemapLevels::levelSize(int level) const
+{
+	const int size = std::max(1, width >> level);
+	return MipChain::levelSize(format, size, size) * 6;
+}
+
+namespace
+{
+	IBLCubemapHeader describe(const IBLCache::CubemapLevels& cubemap)
+	{
+		IBLCubemapHeader header;
+		header.format = static_cast<uint32_t>(cubemap.format);
+		header.width = cubemap.width;
+		header.levelCount = cubemap.levelCount;
+		return header;
+	}
+
+	bool readLevels(CacheReader& reader, const IBLCubemapHeader& header, 
+		IBLCache::CubemapLevels& outCubemap)
+	{
+		if (header.width == 0 && header.levelCount == 0)
+		{
+			outCubemap = IBLCache::CubemapLevels();
+			return true;
+		}
+
+		if (header.width <= 0 || header.levelCount <= 0 ||
+			header.levelCount > MipChain::maxLevelCount(header.width, header.width))
+		{
+			return false;
+		}
+
+		outCubemap.format = static_cast<TextureFormat>(header.format);
+		outCubemap.width = header.width;
+		outCubemap.levelCount = header.levelCount;
+		outCubemap.pixels.resize(outCubemap.offset(header.levelCount));
+
+		return reader.read(outCubemap.pixels.data(), outCubemap.pixels.size());
+	}
+}
+
+std::string IBLCache::cachePath(const std::string& sourcePath)
+{
+	return sourcePath + ".sribl";
+}
+
+bool IBLCache::write(const std::string& cachePath,
+	uint64_t key,
+	const CubemapLevels& diffuse,
+	const CubemapLevels& specular,
+	const SphericalHarmonics::Coefficients& irradianceSH)
+{
+	CacheWriter writer(cachePath);
+
+	IBLCacheHeader header;
+	std::memcpy(header.magic, IBL_MAGIC, sizeof(IBL_MAGIC));
+	header.version = VERSION;
+	header.key = key;
+	header.diffuse = describe(diffuse);
+	header.specular = describe(specular);
+	std::memcpy(header.irradianceSH, irradianceSH.data(), sizeof(header.irradianceSH));
+	writer.write(header);
+
+	writer.write(diffuse.pixels.data(), diffuse.pixels.size());
+	writer.write(specular.pixels.data(), specular.pixels.size());
+
+	if (!writer.good())
+	{
+		Logger::Warning("Could not write IBL cache: %s", cachePath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool IBLCache::read(const std::string& cachePath,
+	uint64_t key,
+	CubemapLevels& outDiffuse,
+	CubemapLevels& outSpecular,
+	SphericalHarmonics::Coefficients& outIrradianceSH)
+{
+	const MappedFile file(cachePath);
+	if (!file.isValid())
+	{
+		return false;
+	}
+
+	CacheReader reader(file.data(), file.size());
+
+	IBLCacheHeader header;
+	if (!reader.read(header)
+		|| std::memcmp(header.magic, IBL_MAGIC, sizeof(IBL_MAGIC)) != 0
+		|| header.version != VERSION
+		|| header.key != key)
+	{
+		Logger::Info("IBL cache is outdated: %s", cachePath.c_str());
+		return false;
+	}
+
+	if (!readLevels(reader, header.diffuse, outDiffuse) ||
+		!readLevels(reader, header.specular, outSpecular))
+	{
+		Logger::Warning("IBL cache is corrupt: %s", cachePath.c_str());
+		return false;
+	}
+
+	std::memcpy(outIrradianceSH.data(), header.irradianceSH, sizeof(header.irradianceSH));
+
+	return true;
+}
@@ -0,0 +1,111 @@
+#include "Preprocessor/IrradianceVolumeCache.h"
+#include "Common/BinaryIO.h"
+#include "Common/Logger.h"
+#include "Common/MappedFile.h"
+#include "Renderer/IrradianceVolume.h"
+
+#include <cstring>
+
+constexpr char VOLUME_MAGIC[4] = { 'S', 'R', 'P', 'V' };
+
+struct IrradianceVolumeCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	int32_t resolution[3];
+	int32_t bakedCount;
+};
+
+// followed by the baked probes
+struct IrradianceProbeRecord
+{
+	int32_t index;
+	float coefficients[SphericalHarmonics::COEFFICIENT_COUNT * 3];
+};
+
+static_assert(sizeof(SphericalHarmonics::Coefficients) == sizeof(IrradianceProbeRecord::coefficients),
+	"Coefficients are copied as tightly packed floats");
+
+std::string IrradianceVolumeCache::cachePath(const std::string& scenePath)
+{
+	return scenePath + ".srprobe";
+}
+
+bool IrradianceVolumeCache::write(const std::string& cachePath,
+	uint64_t key,
+	const IrradianceVolume& volume)
+{
+	CacheWriter writer(cachePath);
+
+	IrradianceVolumeCacheHeader header;
+	std::memcpy(header.magic, VOLUME_MAGIC, sizeof(VOLUME_MAGIC));
+	header.version = VERSION;
+	header.key = key;
+	header.resolution[0] = volume.resolution().x;
+	header.resolution[1] = volume.resolution().y;
+	header.resolution[2] = volume.resolution().z;
+	header.bakedCount = volume.bakedCount();
+	writer.write(header);
+
+	for (int i = 0; i < volume.probeCount(); ++i)
+	{
+		if (volume.isBaked(i))
+		{
+			IrradianceProbeRecord record;
+			record.index = i;
+			std::memcpy(record.coefficients, volume.probe(i).data(), sizeof(record.coefficients));
+			writer.write(record);
+		}
+	}
+
+	if (!writer.good())
+	{
+		Logger::Warning("Could not write irradiance volume cache: %s", cachePath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool IrradianceVolumeCache::read(const std::string& cachePath,
+	uint64_t key,
+	IrradianceVolume& volume)
+{
+	const MappedFile file(cachePath);
+	if (!file.isValid())
+	{
+		return false;
+	}
+
+	CacheReader reader(file.data(), file.size());
+
+	IrradianceVolumeCacheHeader header;
+	if (!reader.read(header)
+		|| std::memcmp(header.magic, VOLUME_MAGIC, sizeof(VOLUME_MAGIC)) != 0
+		|| header.version != VERSION
+		|| header.key != key
+		|| header.resolution[0] != volume.resolution().x
+		|| header.resolution[1] != volume.resolution().y
+		|| header.resolution[2] != volume.resolution().z)
+	{
+		Logger::Info("Irradiance volume cache is outdated: %s", cachePath.c_str());
+		return false;
+	}
+
+	for (int32_t i = 0; i < header.bakedCount; ++i)
+	{
+		IrradianceProbeRecord record;
+		if (!reader.read(record) || record.index < 0 || record.index >= volume.probeCount())
+		{
+			Logger::Warning("Irradiance volume cache is corrupt: %s", cachePath.c_str());
+			return false;
+		}
+
+		SphericalHarmonics::Coefficients coefficients;
+		std::memcpy(coefficients.data(), record.coefficients, sizeof(record.coefficients));
+		volume.setProbe(record.index, coefficients);
+	}
+
+	return true;
+}
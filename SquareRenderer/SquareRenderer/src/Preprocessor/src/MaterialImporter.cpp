@@ -115,6 +115,7 @@ MaterialLibraryUPtr MaterialImporter::importFromFile(const std::string& filepath
                 break;
             case UniformType::Texture2D:
             case UniformType::Cubemap:
+            case UniformType::Texture3D:
             {
                 ITextureSPtr tex = matLib->findDefaultTexture(metaInfo.hint);
                 if (tex)
@@ -0,0 +1,138 @@
+#include "Preprocessor/MeshConversion.h"
+#include "Common/Logger.h"
+#include "Common/Math3D.h"
+#include "Scene/Mesh.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <assimp/mesh.h>
+
+#if !defined(ASSIMP_DOUBLE_PRECISION) && (defined(_M_X64) || defined(__SSE2__))
+#define SIMD_VERTEX_CONVERSION
+#include <xmmintrin.h>
+#endif
+
+// 11KB of converted vertices, small enough for the L1 cache
+constexpr unsigned int VERTEX_CHUNK_SIZE = 256;
+
+inline void Map(const aiVector3D& source, glm::vec2& target)
+{
+    target.x = source.x;
+    target.y = source.y;
+}
+
+inline void Map(const aiVector3D& source, glm::vec3& target)
+{
+    target.x = source.x;
+    target.y = source.y;
+    target.z = source.z;
+}
+
+void convertVertices(const aiMesh& mesh, unsigned int first, unsigned int count, Vertex* target)
+{
+    unsigned int i = 0;
+
+#ifdef SIMD_VERTEX_CONVERSION
+    static_assert(sizeof(Vertex) == 11 * sizeof(float), "Unexpected vertex layout");
+
+    // 4 wide loads and stores spill one float into the next attribute,
+    // which is written afterwards, the last vertex is converted scalar
+    for (; i + 1 < count; ++i)
+    {
+        float* out = reinterpret_cast<float*>(target + i);
+        const unsigned int k = first + i;
+
+        const __m128 position = _mm_loadu_ps(&mesh.mVertices[k].x);
+        const __m128 uv = _mm_loadl_pi(_mm_setzero_ps(),
+            reinterpret_cast<const __m64*>(&mesh.mTextureCoords[0][k].x));
+        const __m128 normal = _mm_loadu_ps(&mesh.mNormals[k].x);
+        const __m128 tangent = _mm_loadu_ps(&mesh.mTangents[k].x);
+
+        _mm_storeu_ps(out + 0, position);
+        _mm_storel_pi(reinterpret_cast<__m64*>(out + 3), uv);
+        _mm_storeu_ps(out + 5, normal);
+        _mm_storeu_ps(out + 8, tangent);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        Vertex& vertex = target[i];
+        const unsigned int k = first + i;
+
+        Map(mesh.mVertices[k], vertex.position);
+        Map(mesh.mTextureCoords[0][k], vertex.uv);
+        Map(mesh.mNormals[k], vertex.normal);
+        Map(mesh.mTangents[k], vertex.tangent);
+    }
+}
+
+MeshSPtr MeshConversion::fromAssimp(const aiMesh& mesh)
+{
+    if ((mesh.mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0
+        || mesh.mNumFaces == 0
+        || mesh.mNumVertices == 0
+        || !mesh.HasNormals()
+        || !mesh.HasPositions()
+        || !mesh.HasTextureCoords(0)
+        || !mesh.HasTangentsAndBitangents())
+    {
+        Logger::Warning("Mesh is incomplete: %s", mesh.mName.C_Str());
+
+        return MeshSPtr();
+    }
+
+    unsigned char dataFieldFlags = 0;
+    dataFieldFlags |= mesh.HasTextureCoords(0) ? Vertex::DATA_UV : 0;
+    dataFieldFlags |= mesh.HasNormals() ? Vertex::DATA_NORMAL : 0;
+    dataFieldFlags |= mesh.HasTangentsAndBitangents() ? Vertex::DATA_TANGENT : 0;
+
+    // converted into the upload layout in chunks that stay in the cache,
+    // appending them avoids the zero initialisation of a sized vector,
+    // the buffers are moved into the mesh without further copies
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.mNumVertices);
+
+    Vertex chunk[VERTEX_CHUNK_SIZE];
+    for (unsigned int first = 0; first < mesh.mNumVertices; first += VERTEX_CHUNK_SIZE)
+    {
+        const unsigned int count = std::min(VERTEX_CHUNK_SIZE, mesh.mNumVertices - first);
+        convertVertices(mesh, first, count, chunk);
+        vertices.insert(vertices.end(), chunk, chunk + count);
+    }
+
+    const size_t faceCount = mesh.mNumFaces;
+    constexpr size_t vertPerTri = 3;
+
+    std::vector<uint32_t> indices;
+    indices.reserve(faceCount * vertPerTri);
+
+    for (unsigned int i = 0; i < faceCount; ++i)
+    {
+        const aiFace& face = mesh.mFaces[i];
+
+        // aiProcess_Triangulate only leaves points and lines behind
+        if (face.mNumIndices != vertPerTri)
+        {
+            Logger::Warning("Skip face with %i indices!", face.mNumIndices);
+            continue;
+        }
+
+        indices.insert(indices.end(), face.mIndices, face.mIndices + vertPerTri);
+    }
+
+    // bounds of aiProcess_GenBoundingBoxes save another pass over the vertices
+    const glm::vec3 boundsMin(mesh.mAABB.mMin.x, mesh.mAABB.mMin.y, mesh.mAABB.mMin.z);
+    const glm::vec3 boundsMax(mesh.mAABB.mMax.x, mesh.mAABB.mMax.y, mesh.mAABB.mMax.z);
+    if (glm::all(glm::lessThanEqual(boundsMin, boundsMax)))
+    {
+        BoundingBox bounds;
+        bounds.insert(boundsMin);
+        bounds.insert(boundsMax);
+
+        return std::make_shared<Mesh>(std::move(vertices), std::move(indices), bounds, dataFieldFlags);
+    }
+
+    return std::make_shared<Mesh>(std::move(vertices), std::move(indices), dataFieldFlags);
+}
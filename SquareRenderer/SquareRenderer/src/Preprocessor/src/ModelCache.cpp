@@ -0,0 +1,277 @@
+#include "Preprocessor/ModelCache.h"
+#include "Preprocessor/ModelData.h"
+#include "Common/BinaryIO.h"
+#include "Common/Logger.h"
+#include "Common/MappedFile.h"
+#include "Scene/BoundingBox.h"
+#include "Scene/Mesh.h"
+
+#include <cstring>
+#include <vector>
+
+constexpr char MAGIC[4] = { 'S', 'R', 'M', 'C' };
+
+struct CacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t importFlags;
+	uint32_t materialCount;
+	uint32_t meshCount;
+};
+
+struct CacheMesh
+{
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t dataFieldFlags;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+struct CacheNode
+{
+	glm::mat4 localTransform;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	int32_t mesh;
+	int32_t material;
+	uint32_t childCount;
+	uint32_t nameLength;
+};
+
+BoundingBox toBounds(const glm::vec3& min, const glm::vec3& max)
+{
+	BoundingBox bounds;
+	if (glm::all(glm::lessThanEqual(min, max)))
+	{
+		bounds.insert(min);
+		bounds.insert(max);
+	}
+	return bounds;
+}
+
+void writeNode(CacheWriter& writer, const ModelData::Node& node)
+{
+	CacheNode data;
+	data.localTransform = node.localTransform;
+	data.boundsMin = node.bounds.min();
+	data.boundsMax = node.bounds.max();
+	data.mesh = node.mesh;
+	data.material = node.material;
+	data.childCount = static_cast<uint32_t>(node.children.size());
+	data.nameLength = static_cast<uint32_t>(node.name.size());
+
+	writer.write(data);
+	writer.write(node.name.data(), data.nameLength);
+
+	for (const ModelData::Node& child : node.children)
+	{
+		writeNode(writer, child);
+	}
+}
+
+bool readNode(CacheReader& reader, const ModelData& model, ModelData::Node& node)
+{
+	CacheNode data;
+	if (!reader.read(data))
+	{
+		return false;
+	}
+
+	const char* name = reinterpret_cast<const char*>(reader.skip(data.nameLength));
+	if (!name
+		|| data.mesh >= static_cast<int32_t>(model.meshes.size())
+		|| data.material >= static_cast<int32_t>(model.materials.size()))
+	{
+		return false;
+	}
+
+	node.name = std::string(name, data.nameLength);
+	node.localTransform = data.localTransform;
+	node.bounds = toBounds(data.boundsMin, data.boundsMax);
+	node.mesh = data.mesh;
+	node.material = data.material;
+
+	if (!reader.fits<CacheNode>(data.childCount))
+	{
+		return false;
+	}
+
+	node.children.resize(data.childCount);
+	for (ModelData::Node& child : node.children)
+	{
+		if (!readNode(reader, model, child))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::string ModelCache::cachePath(const std::string& sourcePath)
+{
+	return sourcePath + ".srcache";
+}
+
+bool ModelCache::write(const std::string& cachePath,
+	uint64_t sourceHash,
+	uint64_t importFlags,
+	const ModelData& data)
+{
+	for (MeshSPtr mesh : data.meshes)
+	{
+		if (mesh && !mesh->hasClientData())
+		{
+			Logger::Warning("Could not write model cache, mesh data was released: %s", cachePath.c_str());
+			return false;
+		}
+	}
+
+	CacheWriter writer(cachePath);
+
+	CacheHeader header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.sourceHash = sourceHash;
+	header.importFlags = importFlags;
+	header.materialCount = static_cast<uint32_t>(data.materials.size());
+	header.meshCount = static_cast<uint32_t>(data.meshes.size());
+	writer.write(header);
+
+	for (const std::string& material : data.materials)
+	{
+		const uint32_t length = static_cast<uint32_t>(material.size());
+		writer.write(length);
+		writer.write(material.data(), length);
+	}
+
+	// incomplete meshes are stored empty to keep the indices stable
+	for (MeshSPtr mesh : data.meshes)
+	{
+		CacheMesh meshData = CacheMesh();
+		if (mesh)
+		{
+			meshData.vertexCount = static_cast<uint32_t>(mesh->vertexCount());
+			meshData.indexCount = static_cast<uint32_t>(mesh->indexCount());
+			meshData.dataFieldFlags = mesh->dataFieldFlags();
+			meshData.boundsMin = mesh->bounds().min();
+			meshData.boundsMax = mesh->bounds().max();
+		}
+
+		writer.write(meshData);
+		if (mesh)
+		{
+			writer.write(mesh->vertices().data(), mesh->vertexBufferSize());
+			writer.write(mesh->indices().data(), mesh->indexBufferSize());
+		}
+	}
+
+	writeNode(writer, data.root);
+
+	if (!writer.good())
+	{
+		Logger::Warning("Could not write model cache: %s", cachePath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+ModelDataUPtr ModelCache::read(const std::string& cachePath,
+	uint64_t sourceHash,
+	uint64_t importFlags)
+{
+	MappedFile file(cachePath);
+	if (!file.isValid())
+	{
+		return nullptr;
+	}
+
+	CacheReader reader(file.data(), file.size());
+
+	CacheHeader header;
+	if (!reader.read(header)
+		|| std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+		|| header.version != VERSION
+		|| header.sourceHash != sourceHash
+		|| header.importFlags != importFlags)
+	{
+		Logger::Info("Model cache is outdated: %s", cachePath.c_str());
+		return nullptr;
+	}
+
+	// every material has its length and every mesh its header
+	if (!reader.fits<uint32_t>(header.materialCount)
+		|| !reader.fits<CacheMesh>(header.meshCount))
+	{
+		Logger::Warning("Model cache is corrupt: %s", cachePath.c_str());
+		return nullptr;
+	}
+
+	ModelDataUPtr data = std::make_unique<ModelData>();
+
+	data->materials.reserve(header.materialCount);
+	for (uint32_t i = 0; i < header.materialCount; ++i)
+	{
+		uint32_t length = 0;
+		const char* name = reader.read(length) 
+			? reinterpret_cast<const char*>(reader.skip(length)) : nullptr;
+
+		if (!name)
+		{
+			return nullptr;
+		}
+
+		data->materials.emplace_back(name, length);
+	}
+
+	data->meshes.reserve(header.meshCount);
+	for (uint32_t i = 0; i < header.meshCount; ++i)
+	{
+		CacheMesh meshData;
+		if (!reader.read(meshData))
+		{
+			return nullptr;
+		}
+
+		if (meshData.vertexCount == 0)
+		{
+			data->meshes.push_back(nullptr);
+			continue;
+		}
+
+		// counts are checked against the mapping before allocating for them
+		if (!reader.fits<Vertex>(meshData.vertexCount)
+			|| !reader.fits<uint32_t>(meshData.indexCount))
+		{
+			Logger::Warning("Model cache is corrupt: %s", cachePath.c_str());
+			return nullptr;
+		}
+
+		// blobs already have the upload layout, only one copy out of the mapping
+		std::vector<Vertex> vertices(meshData.vertexCount);
+		std::vector<uint32_t> indices(meshData.indexCount);
+		if (!reader.read(vertices.data(), sizeof(Vertex) * vertices.size())
+			|| !reader.read(indices.data(), sizeof(uint32_t) * indices.size()))
+		{
+			return nullptr;
+		}
+
+		data->meshes.push_back(std::make_shared<Mesh>(
+			std::move(vertices),
+			std::move(indices),
+			toBounds(meshData.boundsMin, meshData.boundsMax),
+			static_cast<unsigned char>(meshData.dataFieldFlags)));
+	}
+
+	if (!readNode(reader, *data, data->root))
+	{
+		Logger::Warning("Model cache is corrupt: %s", cachePath.c_str());
+		return nullptr;
+	}
+
+	return data;
+}
@@ -1,7 +1,14 @@
+#include "Common/Hash.h"
 #include "Common/Logger.h"
+#include "Common/MappedFile.h"
 #include "Common/Math3D.h"
+#include "Common/JobSystem.h"
+#include "Common/Timer.h"
 
 #include "Preprocessor/ModelLoader.h"
+#include "Preprocessor/ModelCache.h"
+#include "Preprocessor/ModelData.h"
+#include "Preprocessor/MeshConversion.h"
 #include "Scene/Scene.h"
 #include "Scene/SceneNode.h"
 #include "Scene/Mesh.h"
@@ -11,6 +18,31 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+constexpr unsigned int REMOVE_COMPONENT_FLAGS = 0
+    | aiComponent_TEXTURES
+    | aiComponent_COLORS
+    | aiComponent_TANGENTS_AND_BITANGENTS
+    | aiComponent_BONEWEIGHTS
+    | aiComponent_ANIMATIONS
+    | aiComponent_CAMERAS
+    | aiComponent_LIGHTS;
+
+constexpr unsigned int IMPORT_FLAGS = 0u
+    | aiProcess_CalcTangentSpace
+    | aiProcess_JoinIdenticalVertices
+    | aiProcess_GenSmoothNormals
+    | aiProcess_GenBoundingBoxes
+    //| aiProcess_PreTransformVertices        //! Apply transformations
+    | aiProcess_SortByPType                 //! Split up heterogeneous mesh types
+    | aiProcess_RemoveComponent
+    //| aiProcess_RemoveRedundantMaterials
+    | aiProcess_Triangulate
+    //| aiProcess_ImproveCacheLocality
+    //| aiProcess_OptimizeMeshes
+    //| aiProcess_FixInfacingNormals
+    //| aiProcess_FlipWindingOrder
+    ;
+
 inline void Map(const aiMatrix4x4& source, glm::mat4& target)
 {
     //the a,b,c,d in assimp is the row ; the 1,2,3,4 is the column
@@ -20,19 +52,6 @@ inline void Map(const aiMatrix4x4& source, glm::mat4& target)
     target[0][3] = source.d1; target[1][3] = source.d2; target[2][3] = source.d3; target[3][3] = source.d4;
 }
 
-inline void Map(const aiVector3D& source, glm::vec2& target)
-{
-    target.x = source.x;
-    target.y = source.y;
-}
-
-inline void Map(const aiVector3D& source, glm::vec3& target)
-{
-    target.x = source.x;
-    target.y = source.y;
-    target.z = source.z;
-}
-
 inline void Map(const aiColor3D& source, glm::vec3& target)
 {
     target.r = source.r;
@@ -63,15 +82,18 @@ void LogMatrix(const std::string& description, const glm::mat4& m)
     );
 }
 
-MaterialSPtr ModelLoader::processMaterial(const aiMaterial& mat)
+std::string ModelLoader::processMaterial(const aiMaterial& mat)
 {
     aiString name;
     mat.Get(AI_MATKEY_NAME, name);
 
     Logger::Info("Process Material '%s'", name.C_Str());
 
-    const std::string materialName = std::string(name.C_Str());
+    return std::string(name.C_Str());
+}
 
+MaterialSPtr ModelLoader::resolveMaterial(const std::string& materialName)
+{
     MaterialSPtr existing;
     if (m_useExistingMaterials)
     {
@@ -81,118 +103,77 @@ MaterialSPtr ModelLoader::processMaterial(const aiMaterial& mat)
     return existing ? existing : m_matLib->instanciate(m_defaultProgramName, materialName);
 }
 
-MeshSPtr ModelLoader::processMesh(const aiMesh& mesh)
+bool ModelLoader::processNode(
+    const aiNode& currentNode,
+    const aiScene& scene,
+    const ModelData& data,
+    ModelData::Node& newNode)
 {
-    if ((mesh.mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0
-        || mesh.mNumFaces == 0
-        || mesh.mNumVertices == 0
-        || !mesh.HasNormals()
-        || !mesh.HasPositions()
-        || !mesh.HasTextureCoords(0)
-        || !mesh.HasTangentsAndBitangents())
+    if (currentNode.mNumMeshes == 0 
+        && currentNode.mNumChildren == 0)
     {
-        Logger::Warning("Mesh is incomplete: %s", mesh.mName.C_Str());
-
-        return MeshSPtr();
+        return false;
     }
 
-    unsigned char dataFieldFlags = 0;
-    dataFieldFlags |= mesh.HasTextureCoords(0) ? Vertex::DATA_UV : 0;
-    dataFieldFlags |= mesh.HasNormals() ? Vertex::DATA_NORMAL : 0;
-    dataFieldFlags |= mesh.HasTangentsAndBitangents() ? Vertex::DATA_TANGENT : 0;
+    newNode.name = currentNode.mName.C_Str();
+    
+    Logger::Debug("Import node: %s", newNode.name.c_str());
+
+    Map(currentNode.mTransformation, newNode.localTransform);
 
-    std::vector<Vertex> vertices(mesh.mNumVertices);
+    //LogMatrix(newNode.name, newNode.localTransform);
 
-    for (unsigned int i = 0; i < mesh.mNumVertices; ++i)
+    if (currentNode.mNumMeshes > 0)
     {
-        Vertex& vertex = vertices[i];
-        
-        Map(mesh.mVertices[i], vertex.position);
+        const unsigned int meshIndex = currentNode.mMeshes[0];
 
-        if ((dataFieldFlags & Vertex::DATA_UV) != 0)
-        {
-            Map(mesh.mTextureCoords[0][i], vertex.uv);
-        }
-        if ((dataFieldFlags & Vertex::DATA_NORMAL) != 0)
-        {
-            Map(mesh.mNormals[i], vertex.normal);
-        }
-        if ((dataFieldFlags & Vertex::DATA_TANGENT) != 0)
+        newNode.mesh = static_cast<int>(meshIndex);
+        newNode.material = static_cast<int>(scene.mMeshes[meshIndex]->mMaterialIndex);
+
+        if (data.meshes[meshIndex])
         {
-            Map(mesh.mTangents[i], vertex.tangent);
+            newNode.bounds = data.meshes[meshIndex]->bounds();
         }
     }
 
-    const size_t faceCount = mesh.mNumFaces;
-    constexpr size_t vertPerTri = 3;
-    std::vector<uint32_t> indices(faceCount * vertPerTri);
-
-    for (unsigned int i = 0; i < faceCount; ++i)
+    newNode.children.reserve(currentNode.mNumChildren);
+    for (unsigned int i = 0; i < currentNode.mNumChildren; ++i)
     {
-        const aiFace& face = mesh.mFaces[i];
+        ModelData::Node& childNode = newNode.children.emplace_back();
 
-        // TODO Maybe only needed in debug mode
-        if (face.mNumIndices != vertPerTri)
+        if (!processNode(*currentNode.mChildren[i], scene, data, childNode))
         {
-            Logger::Warning("Triangle with more than 3 vertices!");
-        }
-
-        for (unsigned int k = 0; k < vertPerTri; k++)
-        {
-            // TODO use emplace
-            indices[vertPerTri * i + k] = face.mIndices[k];
+            newNode.children.pop_back();
         }
     }
 
-    return std::make_shared<Mesh>(std::move(vertices), std::move(indices), dataFieldFlags);
+    return true;
 }
 
-SceneNodeSPtr ModelLoader::processNode(
-    const aiNode& currentNode,
-    const std::vector<MaterialSPtr>& materialSet,
-    const std::vector<std::pair<MeshSPtr, unsigned int>>& meshSet)
+SceneNodeSPtr ModelLoader::buildNode(
+    const ModelData::Node& node,
+    const ModelData& data,
+    const std::vector<MaterialSPtr>& materialSet)
 {
-    if (currentNode.mNumMeshes == 0 
-        && currentNode.mChildren == 0)
+    SceneNodeSPtr newNode = std::make_shared<SceneNode>(node.name);
+    newNode->setLocalTransform(node.localTransform);
+    newNode->setBounds(node.bounds);
+
+    if (node.mesh >= 0)
     {
-        return nullptr;
+        newNode->setGeometry(data.meshes[node.mesh]);
     }
-
-    SceneNodeSPtr newNode = std::make_shared<SceneNode>(currentNode.mName.C_Str());
-    
-    Logger::Debug("Import node: %s", newNode->name().c_str());
-
-    glm::mat4 localTransform(1);
-    Map(currentNode.mTransformation, localTransform);
-    newNode->setLocalTransform(localTransform);
-
-    //LogMatrix(newNode->name(), newNode->localTransform());
-
-    if (currentNode.mNumMeshes > 0)
+    if (node.material >= 0)
     {
-        const auto& mesh = meshSet[currentNode.mMeshes[0]];
-
-        newNode->setGeometry(mesh.first);
-        newNode->setMaterial(materialSet[mesh.second]);
-
-        BoundingBox aabb;
-        for (const Vertex& v : mesh.first->vertices())
-        {
-            aabb.insert(v.position);
-        }
-        newNode->setBounds(aabb);
+        newNode->setMaterial(materialSet[node.material]);
     }
 
-    for (unsigned int i = 0; i < currentNode.mNumChildren; ++i)
+    for (const ModelData::Node& child : node.children)
     {
-        SceneNodeSPtr childNode = processNode(*currentNode.mChildren[i],
-            materialSet, meshSet);
+        SceneNodeSPtr childNode = buildNode(child, data, materialSet);
 
-        if (childNode)
-        {
-            newNode->addChild(childNode);
-            childNode->setParent(newNode);
-        }
+        newNode->addChild(childNode);
+        childNode->setParent(newNode);
     }
 
     return newNode;
@@ -217,52 +198,98 @@ void ModelLoader::setUseExistingMaterials(bool useExisting)
     m_useExistingMaterials = useExisting;
 }
 
+void ModelLoader::setUseCache(bool useCache)
+{
+    m_useCache = useCache;
+}
+
 SceneNodeSPtr ModelLoader::loadFromFile(const std::string& filepath)
 {
+    ModelDataUPtr data = parse(filepath);
+
+    return data ? build(*data) : nullptr;
+}
+
+ModelDataUPtr ModelLoader::parse(const std::string& filepath)
+{
+    Timer timer;
+
+    // the cache is bound to the source content and the import settings
+    uint64_t sourceHash = 0;
+    const uint64_t importFlags = Hash::combine(
+        Hash::combine(Hash::FNV_OFFSET, IMPORT_FLAGS), REMOVE_COMPONENT_FLAGS);
+    const std::string cachePath = ModelCache::cachePath(filepath);
+
+    if (m_useCache)
+    {
+        MappedFile source(filepath);
+        if (source.isValid())
+        {
+            sourceHash = Hash::content(source.data(), source.size());
+        }
+
+        ModelDataUPtr cached = ModelCache::read(cachePath, sourceHash, importFlags);
+        if (cached)
+        {
+            Logger::Info("Loaded model '%s' from cache in %.3fms", 
+                filepath.c_str(), timer.elapsedMs());
+
+            return cached;
+        }
+    }
+
     Assimp::Importer importer;
-    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, 0
-        | aiComponent_TEXTURES
-        | aiComponent_COLORS
-        | aiComponent_TANGENTS_AND_BITANGENTS
-        | aiComponent_BONEWEIGHTS
-        | aiComponent_ANIMATIONS
-        | aiComponent_CAMERAS 
-        | aiComponent_LIGHTS);
-
-    const aiScene* aiScene = importer.ReadFile(filepath, 0u
-        | aiProcess_CalcTangentSpace
-        | aiProcess_JoinIdenticalVertices
-        | aiProcess_GenSmoothNormals
-        | aiProcess_GenBoundingBoxes
-        //| aiProcess_PreTransformVertices        //! Apply transformations
-        | aiProcess_SortByPType                 //! Split up heterogeneous mesh types
-        | aiProcess_RemoveComponent
-        //| aiProcess_RemoveRedundantMaterials
-        | aiProcess_Triangulate
-        //| aiProcess_ImproveCacheLocality
-        //| aiProcess_OptimizeMeshes
-        //| aiProcess_FixInfacingNormals
-        //| aiProcess_FlipWindingOrder
-    );
+    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, REMOVE_COMPONENT_FLAGS);
+
+    const aiScene* aiScene = importer.ReadFile(filepath, IMPORT_FLAGS);
+    if (!aiScene || !aiScene->mRootNode)
+    {
+        Logger::Error("Could not import model '%s': %s", 
+            filepath.c_str(), importer.GetErrorString());
+
+        return nullptr;
+    }
+
+    ModelDataUPtr data = std::make_unique<ModelData>();
 
     // process materials
-    std::vector<MaterialSPtr> materialSet;
-    materialSet.reserve(aiScene->mNumMaterials);
+    data->materials.reserve(aiScene->mNumMaterials);
     for (unsigned int i = 0; i < aiScene->mNumMaterials; ++i)
     {
-        materialSet.push_back(processMaterial(*aiScene->mMaterials[i]));
+        data->materials.push_back(processMaterial(*aiScene->mMaterials[i]));
     }
 
     // process meshes
-    std::vector<std::pair<MeshSPtr, unsigned int>> meshSet;
-    meshSet.reserve(aiScene->mNumMeshes);
-    for (unsigned int i = 0; i < aiScene->mNumMeshes; ++i)
+    data->meshes.resize(aiScene->mNumMeshes);
+    JobSystem::instance().parallelFor(aiScene->mNumMeshes, [&](size_t i) {
+        data->meshes[i] = MeshConversion::fromAssimp(*aiScene->mMeshes[i]);
+    });
+
+    if (!processNode(*aiScene->mRootNode, *aiScene, *data, data->root))
     {
-        aiMesh& mesh = *aiScene->mMeshes[i];
-        meshSet.emplace_back(processMesh(mesh), mesh.mMaterialIndex);
+        Logger::Warning("Model is empty: %s", filepath.c_str());
+
+        return nullptr;
     }
 
-    const aiNode* importNode = aiScene->mRootNode;
+    Logger::Info("Imported model '%s' in %.3fms", filepath.c_str(), timer.elapsedMs());
+
+    if (m_useCache && sourceHash != 0)
+    {
+        ModelCache::write(cachePath, sourceHash, importFlags, *data);
+    }
+
+    return data;
+}
+
+SceneNodeSPtr ModelLoader::build(const ModelData& data)
+{
+    std::vector<MaterialSPtr> materialSet;
+    materialSet.reserve(data.materials.size());
+    for (const std::string& materialName : data.materials)
+    {
+        materialSet.push_back(resolveMaterial(materialName));
+    }
 
-    return processNode(*importNode, materialSet, meshSet);
+    return buildNode(data.root, data, materialSet);
 }
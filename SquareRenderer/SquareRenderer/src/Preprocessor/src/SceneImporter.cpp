@@ -1,4 +1,5 @@
 #include "Preprocessor/SceneImporter.h"
+#include "Preprocessor/ModelData.h"
 #include "Preprocessor/ModelLoader.h"
 #include "Preprocessor/TextureImporter.h"
 #include "Common/Logger.h"
@@ -6,18 +7,25 @@
 #include "API/GraphicsAPI.h"
 #include "Scene/Scene.h"
 #include "Scene/SceneNode.h"
+#include "Scene/StaticBatchBuilder.h"
 #include "Scene/IGeometry.h"
+#include "Scene/Mesh.h"
 #include "Material/Material.h"
 #include "Material/MaterialLibrary.h"
 #include "Scene/DirectionalLight.h"
 #include "Scene/PointLight.h"
 #include "Texture/Cubemap.h"
+#include "Texture/MipChain.h"
 #include "Texture/Texture2D.h"
+#include "Renderer/IDrawable.h"
 #include "Renderer/RenderEngine.h"
 
 #include <yaml-cpp/yaml.h>
 
+#include <array>
 #include <filesystem>
+#include <functional>
+#include <set>
 
 #undef ASYNC_TEXTURE_IMPORT
 
@@ -281,15 +289,161 @@ namespace YAML
 				rhs = TextureImporter::ImportFormat::Auto;
 			}
 
+			return true;
+		}
+	};
+	template<>
+	struct convert<TextureImporter::Compression>
+	{
+		static Node encode(const TextureImporter::Compression& rhs)
+		{
+			Node node;
+			switch (rhs)
+			{
+			case TextureImporter::Compression::None:
+				node.push_back("None");
+				break;
+			case TextureImporter::Compression::Auto:
+				node.push_back("Auto");
+				break;
+			case TextureImporter::Compression::BC1:
+				node.push_back("BC1");
+				break;
+			case TextureImporter::Compression::BC3:
+				node.push_back("BC3");
+				break;
+			case TextureImporter::Compression::BC4:
+				node.push_back("BC4");
+				break;
+			case TextureImporter::Compression::BC5:
+				node.push_back("BC5");
+				break;
+			case TextureImporter::Compression::BC7:
+				node.push_back("BC7");
+				break;
+			case TextureImporter::Compression::BC6H:
+				node.push_back("BC6H");
+				break;
+			case TextureImporter::Compression::RGB9E5:
+				node.push_back("RGB9E5");
+				break;
+			}
+
+			return node;
+		}
+
+		static bool decode(const Node& node, TextureImporter::Compression& rhs)
+		{
+			if (!node.IsScalar())
+			{
+				return false;
+			}
+
+			const std::string valueStr = node.as<std::string>("");
+			if (valueStr.empty())
+			{
+				return false;
+			}
+
+			if (valueStr == "Auto")
+			{
+				rhs = TextureImporter::Compression::Auto;
+			}
+			else if (valueStr == "BC1")
+			{
+				rhs = TextureImporter::Compression::BC1;
+			}
+			else if (valueStr == "BC3")
+			{
+				rhs = TextureImporter::Compression::BC3;
+			}
+			else if (valueStr == "BC4")
+			{
+				rhs = TextureImporter::Compression::BC4;
+			}
+			else if (valueStr == "BC5")
+			{
+				rhs = TextureImporter::Compression::BC5;
+			}
+			else if (valueStr == "BC7")
+			{
+				rhs = TextureImporter::Compression::BC7;
+			}
+			else if (valueStr == "BC6H")
+			{
+				rhs = TextureImporter::Compression::BC6H;
+			}
+			else if (valueStr == "RGB9E5")
+			{
+				rhs = TextureImporter::Compression::RGB9E5;
+			}
+			else
+			{
+				rhs = TextureImporter::Compression::None;
+			}
+
+			return true;
+		}
+	};
+	template<>
+	struct convert<GeometryResidency>
+	{
+		static Node encode(const GeometryResidency& rhs)
+		{
+			Node node;
+			switch (rhs)
+			{
+			case GeometryResidency::KeepAll:
+				node.push_back("KeepAll");
+				break;
+			case GeometryResidency::PositionsOnly:
+				node.push_back("PositionsOnly");
+				break;
+			case GeometryResidency::Release:
+				node.push_back("Release");
+				break;
+			}
+
+			return node;
+		}
+
+		static bool decode(const Node& node, GeometryResidency& rhs)
+		{
+			if (!node.IsScalar())
+			{
+				return false;
+			}
+
+			const std::string valueStr = node.as<std::string>("");
+			if (valueStr.empty())
+			{
+				return false;
+			}
+
+			if (valueStr == "KeepAll")
+			{
+				rhs = GeometryResidency::KeepAll;
+			}
+			else if (valueStr == "Release")
+			{
+				rhs = GeometryResidency::Release;
+			}
+			else
+			{
+				rhs = GeometryResidency::PositionsOnly;
+			}
+
 			return true;
 		}
 	};
 }
 
-SceneImporter::SceneImporter(GraphicsAPISPtr api, MaterialLibrarySPtr matLib, RenderEngineSPtr renderEngine)
+SceneImporter::SceneImporter(GraphicsAPISPtr api, MaterialLibrarySPtr matLib, 
+	RenderEngineSPtr renderEngine, TextureImporterSPtr textureImporter)
 	: m_api(api)
 	, m_matLib(matLib)
 	, m_renderEngine(renderEngine)
+	, m_textureImporter(textureImporter)
 {
 }
 
@@ -297,8 +451,171 @@ SceneImporter::~SceneImporter()
 {
 }
 
+void SceneImporter::clearModelCache()
+{
+	m_modelCache.clear();
+	m_staticMeshes.clear();
+}
+
+std::string modelCacheKey(const std::string& filepath, 
+	const std::string& defaultProgramName, 
+	bool useExistingMaterials)
+{
+	std::error_code error;
+	const std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(filepath, error);
+
+	return (error ? filepath : canonicalPath.string())
+		+ "|" + defaultProgramName
+		+ "|" + (useExistingMaterials ? "1" : "0");
+}
+
+TaskGraph::TaskId SceneImporter::scheduleModel(TaskGraph& graph,
+	const std::string& filepath,
+	const std::string& defaultProgramName,
+	bool useExistingMaterials,
+	std::unordered_map<std::string, TaskGraph::TaskId>& scheduled)
+{
+	const std::string key = modelCacheKey(filepath, defaultProgramName, useExistingMaterials);
+
+	const auto& found = scheduled.find(key);
+	if (found != scheduled.end())
+	{
+		return found->second;
+	}
+
+	std::shared_ptr<ModelDataUPtr> data = std::make_shared<ModelDataUPtr>();
+
+	const TaskGraph::TaskId parseTask = graph.add("Parse model: " + filepath, 
+		[this, filepath, data]() {
+			ModelLoader loader(m_matLib);
+			*data = loader.parse(filepath);
+		});
+
+	// materials are resolved on the main thread, the cached prototype 
+	// is never part of a scene, so its transforms stay untouched
+	const TaskGraph::TaskId buildTask = graph.add("Build model: " + filepath, 
+		[this, key, defaultProgramName, useExistingMaterials, data]() {
+			ModelLoader loader(m_matLib);
+			loader.setDefaultProgramName(defaultProgramName);
+			loader.setUseExistingMaterials(useExistingMaterials);
+
+			m_modelCache[key] = *data ? loader.build(**data) : nullptr;
+			data->reset();
+		}, TaskGraph::Affinity::Main, { parseTask });
+
+	scheduled[key] = buildTask;
+
+	return buildTask;
+}
+
+Texture2DSPtr SceneImporter::scheduleTexture(TaskGraph& graph,
+	const std::string& filepath,
+	TextureImporter::ImportFormat format,
+	TextureSampler sampler,
+	TaskGraph::TaskId& outUploadTask,
+	const TextureImporter::ProcessingSettings& processing)
+{
+	const std::filesystem::path path(filepath);
+	if (!std::filesystem::exists(path) || !path.has_filename())
+	{
+		throw std::runtime_error("Invalid path to Texture file.");
+	}
+
+	// dummy texture, filled by the upload task
+	Texture2DSPtr texture = std::make_shared<Texture2D>(1, 1, TextureFormat::RGB, sampler);
+
+	std::shared_ptr<MipChainUPtr> mips = std::make_shared<MipChainUPtr>();
+
+	TextureImporter* importer = m_textureImporter.get();
+
+	const TaskGraph::TaskId decodeTask = graph.add("Decode texture: " + filepath,
+		[importer, filepath, format, sampler, processing, mips]() {
+			*mips = importer->loadMipChain(filepath, format, sampler, processing);
+		});
+
+	outUploadTask = graph.add("Upload texture: " + filepath,
+		[importer, texture, mips, filepath]() {
+			if (!*mips || !importer->upload(texture, **mips))
+			{
+				Logger::Error("Could not import texture '%s'", filepath.c_str());
+			}
+		}, TaskGraph::Affinity::Main, { decodeTask });
+
+	return texture;
+}
+
+// channel values of the default textures of the material library
+bool defaultChannelValue(const std::string& name, uint8_t& outValue)
+{
+	if (name == "white")
+	{
+		outValue = 255;
+	}
+	else if (name == "black")
+	{
+		outValue = 0;
+	}
+	else if (name == "normal")
+	{
+		outValue = 128;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void applyGeometryResidency(const Scene& scene, GeometryResidency residency, const std::set<MeshSPtr>& staticMeshes)
+{
+	std::set<MeshSPtr> meshes;
+
+	std::vector<SceneNodeSPtr> nodes = scene.staticBatches();
+	for (auto t = scene.traverser(); t.hasNext();)
+	{
+		nodes.push_back(t.next());
+	}
+
+	for (SceneNodeSPtr node : nodes)
+	{
+		MeshSPtr mesh = std::dynamic_pointer_cast<Mesh>(node->geometry());
+		if (mesh)
+		{
+			meshes.insert(mesh);
+		}
+	}
+
+	size_t gpuSize = 0;
+	size_t clientSizeBefore = 0;
+	size_t clientSizeAfter = 0;
+
+	for (MeshSPtr mesh : meshes)
+	{
+		clientSizeBefore += mesh->clientMemoryUsage();
+
+		// meshes merged into static batches are never uploaded and keep 
+		// their data, cached models might still reference them unbatched
+		if (mesh->linked() && staticMeshes.find(mesh) == staticMeshes.end())
+		{
+			gpuSize += mesh->vertexBufferSize() + mesh->indexBufferSize();
+			mesh->setResidency(residency);
+		}
+
+		clientSizeAfter += mesh->clientMemoryUsage();
+	}
+
+	constexpr float MB = 1024.f * 1024.f;
+
+	Logger::Info("Geometry memory: %.2fMB GPU, %.2fMB CPU (%.2fMB released)",
+		gpuSize / MB, clientSizeAfter / MB, (clientSizeBefore - clientSizeAfter) / MB);
+}
+
 SceneUPtr SceneImporter::importFromFile(const std::string& filepath)
 {
+	typedef TaskGraph::TaskId TaskId;
+	typedef TaskGraph::Affinity Affinity;
+
 	const std::filesystem::path path(filepath);
 
 	if (!std::filesystem::exists(path) || !path.has_filename())
@@ -309,29 +626,104 @@ SceneUPtr SceneImporter::importFromFile(const std::string& filepath)
 	SceneNodeSPtr sceneRoot = std::make_shared<SceneNode>("SceneRoot");
 	SceneUPtr scene = std::make_unique<Scene>(sceneRoot);
 
-	ModelLoader loader(m_matLib);
-	loader.setDefaultProgramName("ForwardLit.PBR");
-
 	YAML::Node config = YAML::LoadFile(filepath);
 
+	const GeometryResidency geometryResidency = 
+		config["geometryResidency"].as<GeometryResidency>(GeometryResidency::PositionsOnly);
+
+	const float staticChunkSize = config["staticBatching"] ? 
+		config["staticBatching"]["chunkSize"].as<float>(0.f) : 0.f;
+	StaticBatchBuilder staticBatchBuilder(staticChunkSize);
+
+	// parsing, decoding and batching run on workers, everything 
+	// touching the material library or the graphics API on this thread,
+	// locals captured by reference outlive the graph execution
+	TaskGraph graph;
+
+	if (config["textureStreaming"])
+	{
+		const auto& streaming = config["textureStreaming"];
+
+		TextureImporter::StreamingSettings settings = m_textureImporter->streamingSettings();
+		settings.maxConcurrentDecodes = streaming["maxConcurrentDecodes"].as<size_t>(settings.maxConcurrentDecodes);
+		settings.memoryBudget = streaming["memoryBudgetMB"].as<size_t>(settings.memoryBudget >> 20) << 20;
+		settings.uploadBudgetMs = streaming["uploadBudgetMs"].as<double>(settings.uploadBudgetMs);
+		m_textureImporter->setStreamingSettings(settings);
+	}
+
+	// default of all material textures, overridden per texture
+	const TextureImporter::Compression textureCompression =
+		config["textureCompression"].as<TextureImporter::Compression>(TextureImporter::Compression::None);
+
+	std::unordered_map<std::string, TaskId> scheduledModels;
+	std::vector<TaskId> instanceTasks;
+
 	for (const auto& model : config["models"])
 	{
 		const std::string modelPath = model["filepath"].as<std::string>();
 		const glm::vec3 position = model["position"].as<glm::vec3>(glm::vec3(0,0,0));
 		const glm::vec3 rotation = model["rotation"].as<glm::vec3>(glm::vec3(0, 0, 0));
 		const float scale = model["scale"].as<float>(1.f);
+		const bool isStatic = model["static"].as<bool>(false);
+
+		const std::string defaultProgramName = "ForwardLit.PBR";
+		const bool useExistingMaterials = true;
+		const std::string key = modelCacheKey(modelPath, defaultProgramName, useExistingMaterials);
 
-		SceneNodeSPtr modelRootNode = loader.loadFromFile(modelPath);
-		if (modelRootNode)
+		std::vector<TaskId> dependencies;
+		if (m_modelCache.find(key) == m_modelCache.end())
+		{
+			dependencies.push_back(scheduleModel(graph, modelPath, 
+				defaultProgramName, useExistingMaterials, scheduledModels));
+		}
+		else
 		{
-			const glm::mat4 transform = modelRootNode->localTransform();
-			const glm::mat4 M = MathUtils::createTransform(rotation, position, glm::vec3(scale));
-			modelRootNode->setLocalTransform(M * transform);
+			Logger::Info("Reuse cached model '%s'", modelPath.c_str());
+		}
 
-			sceneRoot->addChild(modelRootNode);
+		// keeps the child order of the scene file
+		if (!instanceTasks.empty())
+		{
+			dependencies.push_back(instanceTasks.back());
 		}
+
+		instanceTasks.push_back(graph.add("Instantiate model: " + modelPath,
+			[this, key, sceneRoot, &staticBatchBuilder, position, rotation, scale, isStatic]() {
+				SceneNodeSPtr prototype = m_modelCache[key];
+				if (!prototype)
+				{
+					return;
+				}
+
+				SceneNodeSPtr modelRootNode = prototype->clone();
+
+				const glm::mat4 transform = modelRootNode->localTransform();
+				const glm::mat4 M = MathUtils::createTransform(rotation, position, glm::vec3(scale));
+				modelRootNode->setLocalTransform(M * transform);
+
+				sceneRoot->addChild(modelRootNode);
+
+				if (isStatic)
+				{
+					staticBatchBuilder.add(modelRootNode);
+
+					for (Scene::Traverser t(modelRootNode); t.hasNext();)
+					{
+						MeshSPtr mesh = std::dynamic_pointer_cast<Mesh>(t.next()->geometry());
+						if (mesh)
+						{
+							m_staticMeshes.insert(mesh);
+						}
+					}
+				}
+			}, Affinity::Main, dependencies));
 	}
 
+	const TaskId hierarchyTask = graph.add("Scene hierarchy", nullptr, Affinity::Main, instanceTasks);
+
+	// change the layer and program of materials the models created
+	std::vector<TaskId> materialOverrideTasks;
+
 	for (const auto& light : config["lights"])
 	{
 		const std::string type = light["type"].as<std::string>();
@@ -362,16 +754,34 @@ SceneUPtr SceneImporter::importFromFile(const std::string& filepath)
 		}
 	}
 
-	TextureImporter ti(m_api);
-
-	Texture2DSPtr skyHDRI;
 	if (config["sky"])
 	{
 		const auto& sky = config["sky"];
 		const std::string hdriPath = sky["filepath"].as<std::string>();
 		//const float rotation = sky["rotation"].as<float>(0);
 
-		skyHDRI = ti.importFromFileAsync(hdriPath);
+		// half float unless BC6H or RGB9E5 is requested
+		TextureImporter::ProcessingSettings skyProcessing;
+		skyProcessing.compression = sky["compression"].as<TextureImporter::Compression>(TextureImporter::Compression::None);
+
+		TaskId skyUploadTask;
+		Texture2DSPtr skyHDRI = scheduleTexture(graph, hdriPath, 
+			TextureImporter::ImportFormat::Auto, TextureSampler(), skyUploadTask, skyProcessing);
+
+		// convert equirectangular HDRI to cubemap 
+		const TaskId skyboxTask = graph.add("Sky cubemap",
+			[this, &scene, skyHDRI]() {
+				TextureSampler skySampler = { TextureFilter::Linear, TextureWrap::ClampToEdge, true, glm::vec4(0,0,0,0) };
+				CubemapSPtr skybox = std::make_shared<Cubemap>(skyHDRI->height() / 2, TextureFormat::RGBHalf, skySampler);
+				m_renderEngine->projectEquirectangularToCubemap(skyHDRI, skybox);
+				scene->setSky(skybox);
+			}, Affinity::Main, { skyUploadTask });
+
+		// cached by the render engine and reused when the scene is set
+		graph.add("Image based lighting",
+			[this, &scene, hdriPath]() {
+				m_renderEngine->generateIBL(scene->sky(), hdriPath);
+			}, Affinity::Main, { skyboxTask });
 
 		for (const auto& light : sky["lights"])
 		{
@@ -398,30 +808,14 @@ SceneUPtr SceneImporter::importFromFile(const std::string& filepath)
 		for (const auto& materialOverride : config["overrides"]["material"])
 		{
 			const std::string name = materialOverride["name"].as<std::string>();
-			MaterialSPtr material = m_matLib->findMaterial(name);
-			if (!material)
-			{
-				continue;
-			}
 
-			if (materialOverride["program"])
-			{
-				const std::string programName = materialOverride["program"].as<std::string>();
-				ShaderProgramSPtr program = m_matLib->findProgram(programName);
-				if (program)
-				{
-					material->setProgram(program);
-				}
-			}
+			const std::string programName = materialOverride["program"] ? 
+				materialOverride["program"].as<std::string>() : "";
+			const std::string layerStr = materialOverride["layer"] ?
+				materialOverride["layer"].as<std::string>() : "";
 
-			if (materialOverride["layer"])
-			{
-				const std::string layerStr = materialOverride["layer"].as<std::string>();
-				if (layerStr == "Transparent")
-				{
-					material->setLayer(Material::Layer::Transparent);
-				}
-			}
+			// applied once the models created the material
+			std::vector<std::function<void(MaterialSPtr)>> parameters;
 
 			for (const auto& parameter : materialOverride["parameters"])
 			{
@@ -431,119 +825,162 @@ SceneUPtr SceneImporter::importFromFile(const std::string& filepath)
 				if (type == "Texture2D")
 				{
 					typedef TextureImporter::ImportFormat ImportFormat;
+					typedef TextureImporter::Compression Compression;
 
 					const auto& value					= parameter["value"];
 					const std::string textureParamPath	= value["path"].as<std::string>();
 					const ImportFormat format			= value["format"].as<ImportFormat>(ImportFormat::Auto);
 
+					// mip generation and compression depend on the content
+					TextureImporter::ProcessingSettings processing;
+					processing.compression	= value["compression"].as<Compression>(textureCompression);
+					processing.normalMap	= value["normalMap"].as<bool>(uniform == "normalMap");
+					processing.alphaCutoff	= value["alphaCutoff"].as<float>(processing.alphaCutoff);
+
 					TextureSampler sampler;
 					sampler.filter		= value["filter"].as<TextureFilter>(sampler.filter);
 					sampler.wrap		= value["wrap"].as<TextureWrap>(sampler.wrap);
 					sampler.mipmapping  = value["mipmapping"].as<bool>(sampler.mipmapping);
 					sampler.borderColor = value["bordercolor"].as<glm::vec4>(sampler.borderColor);
 
-					Texture2DSPtr texture = ti.importFromFileAsync(textureParamPath, format, sampler);
-					if (texture)
-					{
+					// nothing waits for material textures, they are streamed in after the import
+					Texture2DSPtr texture = m_textureImporter->importFromFileAsync(textureParamPath, format, sampler, processing);
+
+					parameters.push_back([uniform, texture](MaterialSPtr material) {
 						material->setUniform(uniform, texture);
-					}
+					});
 				}
 				else if (type == "PackedTexture2D")
 				{
-					typedef TextureImporter::ImportFormat ImportFormat;
+					typedef TextureImporter::Compression Compression;
 
 					const auto& value = parameter["value"];
 
-					std::vector<std::string> channelTexturePaths{
-						value["r"].as<std::string>(),
-						value["g"].as<std::string>(),
-						value["b"].as<std::string>(),
-						value["a"].as<std::string>()
-					};
-
-					TextureSampler sourceSampler;
-					sourceSampler.mipmapping = false;
-
-					bool waitForImport = false;
-					size_t firstNonDefaultIndex = 0;
-					std::vector< Texture2DSPtr> channelTextures(channelTexturePaths.size());
-					for (size_t i = 0; i < channelTexturePaths.size(); ++i)
+					// default textures are constant channels
+					std::array<TextureImporter::PackedChannel, 4> channels;
+					const char* channelKeys[] = { "r", "g", "b", "a" };
+					for (size_t i = 0; i < channels.size(); ++i)
 					{
-						const std::string& channelTexturePath = channelTexturePaths[i];
-						ITextureSPtr texture = m_matLib->findDefaultTexture(channelTexturePath);
-						if (texture && texture->layout() == TextureLayout::Texture2D)
+						const std::string channelPath = value[channelKeys[i]].as<std::string>();
+						if (!defaultChannelValue(channelPath, channels[i].value))
 						{
-							channelTextures[i] = std::dynamic_pointer_cast<Texture2D>(texture);
-						}
-						else
-						{
-							channelTextures[i] = ti.importFromFileAsync(channelTexturePath, ImportFormat::R, sourceSampler);
-							firstNonDefaultIndex = i;
-							waitForImport = true;
+							channels[i].path = channelPath;
 						}
 					}
 
-					if (waitForImport)
-					{
-						ti.waitForCompletion();
-					}
-
 					TextureSampler targetSampler;
 					targetSampler.filter = value["filter"].as<TextureFilter>(targetSampler.filter);
 					targetSampler.wrap = value["wrap"].as<TextureWrap>(targetSampler.wrap);
 					targetSampler.mipmapping = value["mipmapping"].as<bool>(targetSampler.mipmapping);
 					targetSampler.borderColor = value["bordercolor"].as<glm::vec4>(targetSampler.borderColor);
 
-					const TextureFormat targetFormat = channelTextures[firstNonDefaultIndex]->format() == TextureFormat::R ? TextureFormat::RGBA : TextureFormat::RGBAFloat;
-					Texture2DSPtr texture = std::make_shared<Texture2D>(
-						channelTextures[firstNonDefaultIndex]->width(),
-						channelTextures[firstNonDefaultIndex]->height(),
-						targetFormat, 
-						targetSampler);
-
-					m_renderEngine->packTextures(texture, channelTextures[0], channelTextures[1], channelTextures[2], channelTextures[3]);
-					if (texture)
-					{
-						material->setUniform(uniform, texture);
-					}
+					TextureImporter::ProcessingSettings processing;
+					processing.compression = value["compression"].as<Compression>(textureCompression);
+
+					// packed on a worker, the channel sources are never uploaded
+					std::shared_ptr<MipChainUPtr> mips = std::make_shared<MipChainUPtr>();
+					TextureImporter* importer = m_textureImporter.get();
+
+					const TaskId packTask = graph.add("Pack texture: " + name + "." + uniform,
+						[importer, channels, targetSampler, processing, mips]() {
+							*mips = importer->loadPackedMipChain(channels, targetSampler, processing);
+						});
+
+					graph.add("Upload packed texture: " + name + "." + uniform,
+						[this, importer, name, uniform, targetSampler, mips]() {
+							MaterialSPtr material = m_matLib->findMaterial(name);
+							if (!material || !*mips)
+							{
+								return;
+							}
+
+							Texture2DSPtr texture = std::make_shared<Texture2D>(1, 1, TextureFormat::RGBA, targetSampler);
+							if (importer->upload(texture, **mips))
+							{
+								material->setUniform(uniform, texture);
+							}
+							else
+							{
+								Logger::Error("Could not upload packed texture '%s.%s'", name.c_str(), uniform.c_str());
+							}
+						}, Affinity::Main, { hierarchyTask, packTask });
 				}
 				else if (type == "Float")
 				{
 					const float value = parameter["value"].as<float>();
-					material->setUniform(uniform, value);
+					parameters.push_back([uniform, value](MaterialSPtr material) {
+						material->setUniform(uniform, value);
+					});
 				}
 				else if (type == "Vector4D")
 				{
 					const glm::vec4 value = parameter["value"].as<glm::vec4>();
-					material->setUniform(uniform, value);
+					parameters.push_back([uniform, value](MaterialSPtr material) {
+						material->setUniform(uniform, value);
+					});
 				}
 			}
-		}
-	}
 
-	auto t = scene->traverser();
-	while (t.hasNext())
-	{
-		SceneNodeSPtr node = t.next();
-		IGeometrySPtr geo = node->geometry() ? 
-			std::dynamic_pointer_cast<IGeometry>(node->geometry()) : nullptr;
+			materialOverrideTasks.push_back(graph.add("Material override: " + name,
+				[this, name, programName, layerStr, parameters]() {
+					MaterialSPtr material = m_matLib->findMaterial(name);
+					if (!material)
+					{
+						return;
+					}
 
-		if (geo && !m_api->allocate(geo))
-		{
-			Logger::Warning("Could not allocate geometry buffers.");
+					if (!programName.empty())
+					{
+						ShaderProgramSPtr program = m_matLib->findProgram(programName);
+						if (program)
+						{
+							material->setProgram(program);
+						}
+					}
+
+					if (layerStr == "Transparent")
+					{
+						material->setLayer(Material::Layer::Transparent);
+					}
+
+					for (const auto& applyParameter : parameters)
+					{
+						applyParameter(material);
+					}
+				}, Affinity::Main, { hierarchyTask }));
 		}
 	}
 
-	ti.waitForCompletion();
+	// pre-transform static geometry to world space and merge it per material,
+	// the original hierarchy stays in the scene for picking, batches are 
+	// keyed by the final materials, after the program and layer overrides
+	std::vector<TaskId> batchDependencies = materialOverrideTasks;
+	batchDependencies.push_back(hierarchyTask);
+
+	const TaskId staticBatchTask = graph.add("Static batching",
+		[&scene, &staticBatchBuilder]() {
+			for (SceneNodeSPtr batch : staticBatchBuilder.build())
+			{
+				scene->addStaticBatch(batch);
+			}
+		}, Affinity::Worker, batchDependencies);
+
+	// geometry merged into static batches is never drawn directly
+	graph.add("Upload geometry",
+		[this, &scene, geometryResidency]() {
+			for (IDrawableSPtr drawable : scene->drawables())
+			{
+				if (!m_api->allocate(drawable->geometry()))
+				{
+					Logger::Warning("Could not allocate geometry buffers.");
+				}
+			}
+
+			applyGeometryResidency(*scene, geometryResidency, m_staticMeshes);
+		}, Affinity::Main, { staticBatchTask });
+
+	graph.run();
+	graph.logTimeline("Scene import");
 
-	if (skyHDRI)
-	{
-		// convert equirectangular HDRI to cubemap 
-		TextureSampler skySampler = { TextureFilter::Linear, TextureWrap::ClampToEdge, true, glm::vec4(0,0,0,0) };
-		CubemapSPtr skybox = std::make_shared<Cubemap>(skyHDRI->height() / 2, TextureFormat::RGBHalf, skySampler);
-		m_renderEngine->projectEquirectangularToCubemap(skyHDRI, skybox);
-		scene->setSky(skybox);
-	}
-	
 	return scene;
 }
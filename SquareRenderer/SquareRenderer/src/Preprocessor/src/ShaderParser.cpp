@@ -28,7 +28,8 @@ static const std::unordered_map<std::string, UniformType> s_glslTypeToUniformTyp
     { "vec4",           UniformType::Vec4 },
     { "mat4",           UniformType::Mat4 },
     { "sampler2D",      UniformType::Texture2D },
-    { "samplerCube",    UniformType::Cubemap }
+    { "samplerCube",    UniformType::Cubemap },
+    { "sampler3D",      UniformType::Texture3D }
 };
 
 static const std::regex s_uniformRegEx = std::regex("^.*uniform (\\w+) ([\\w_\\[\\]]+)" // type and name
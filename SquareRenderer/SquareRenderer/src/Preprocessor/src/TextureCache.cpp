@@ -0,0 +1,105 @@
+#include "Preprocessor/TextureCache.h"
+#include "Common/BinaryIO.h"
+#include "Common/Logger.h"
+#include "Common/MappedFile.h"
+#include "Texture/MipChain.h"
+
+#include <cstring>
+
+constexpr char TEXTURE_MAGIC[4] = { 'S', 'R', 'T', 'X' };
+
+struct TextureCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceHash;
+	uint64_t importFlags;
+	uint32_t format;
+	int32_t width;
+	int32_t height;
+	int32_t levelCount;
+};
+
+std::string TextureCache::cachePath(const std::string& sourcePath)
+{
+	return sourcePath + ".srtex";
+}
+
+bool TextureCache::write(const std::string& cachePath,
+	uint64_t sourceHash,
+	uint64_t importFlags,
+	const MipChain& mips)
+{
+	CacheWriter writer(cachePath);
+
+	TextureCacheHeader header;
+	std::memcpy(header.magic, TEXTURE_MAGIC, sizeof(TEXTURE_MAGIC));
+	header.version = VERSION;
+	header.sourceHash = sourceHash;
+	header.importFlags = importFlags;
+	header.format = static_cast<uint32_t>(mips.format());
+	header.width = mips.width();
+	header.height = mips.height();
+	header.levelCount = mips.levelCount();
+	writer.write(header);
+
+	// levels are stored in the upload layout
+	writer.write(mips.data(), mips.size());
+
+	if (!writer.good())
+	{
+		Logger::Warning("Could not write texture cache: %s", cachePath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+MipChainUPtr TextureCache::read(const std::string& cachePath,
+	uint64_t sourceHash,
+	uint64_t importFlags)
+{
+	MappedFileSPtr file = std::make_shared<MappedFile>(cachePath);
+	if (!file->isValid())
+	{
+		return nullptr;
+	}
+
+	CacheReader reader(file->data(), file->size());
+
+	TextureCacheHeader header;
+	if (!reader.read(header)
+		|| std::memcmp(header.magic, TEXTURE_MAGIC, sizeof(TEXTURE_MAGIC)) != 0
+		|| header.version != VERSION
+		|| header.sourceHash != sourceHash
+		|| header.importFlags != importFlags)
+	{
+		Logger::Info("Texture cache is outdated: %s", cachePath.c_str());
+		return nullptr;
+	}
+
+	if (header.width <= 0 || header.height <= 0)
+	{
+		Logger::Warning("Texture cache is corrupt: %s", cachePath.c_str());
+		return nullptr;
+	}
+
+	// the levels stay in the mapping, uploads read them in place
+	const size_t offset = sizeof(TextureCacheHeader);
+	MipChainUPtr mips = std::make_unique<MipChain>(
+		static_cast<TextureFormat>(header.format), 
+		header.width, 
+		header.height, 
+		header.levelCount > 1,
+		file,
+		offset);
+
+	if (mips->levelCount() != header.levelCount ||
+		!reader.skip(mips->size()))
+	{
+		Logger::Warning("Texture cache is corrupt: %s", cachePath.c_str());
+		return nullptr;
+	}
+
+	return mips;
+}
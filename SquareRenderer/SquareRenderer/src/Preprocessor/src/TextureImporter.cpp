@@ -1,23 +1,69 @@
 #include "Preprocessor/TextureImporter.h"
+#include "Preprocessor/TextureCache.h"
+#include "Renderer/TextureResidencyManager.h"
+#include "Texture/BlockCompression.h"
+#include "Texture/FloatPacking.h"
+#include "Texture/MipmapGenerator.h"
 #include "Texture/Texture2D.h"
+#include "Texture/MipChain.h"
 #include "API/GraphicsAPI.h"
+#include "Common/Hash.h"
+#include "Common/JobSystem.h"
 #include "Common/Logger.h"
+#include "Common/MappedFile.h"
+#include "Common/Timer.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <filesystem>
+#include <limits>
 
-TextureFormat getFormat(int channels, bool sRGB, bool floatPrecision)
+// HDR images are stored with half precision
+TextureFormat getFormat(int channels, bool sRGB, bool halfPrecision)
 {
     switch (channels)
     {
-    case 1: return floatPrecision ? TextureFormat::RFloat : TextureFormat::R;
-    case 2: return floatPrecision ? TextureFormat::RGFloat : TextureFormat::RG;
-    case 3: return floatPrecision ? TextureFormat::RGBFloat : sRGB ? TextureFormat::SRGB : TextureFormat::RGB;
+    case 1: return halfPrecision ? TextureFormat::RHalf : TextureFormat::R;
+    case 2: return halfPrecision ? TextureFormat::RGHalf : TextureFormat::RG;
+    case 3: return halfPrecision ? TextureFormat::RGBHalf : sRGB ? TextureFormat::SRGB : TextureFormat::RGB;
     case 4:
     default:
-        return floatPrecision ? TextureFormat::RGBAFloat : sRGB ? TextureFormat::SRGBA : TextureFormat::RGBA;
+        return halfPrecision ? TextureFormat::RGBAHalf : sRGB ? TextureFormat::SRGBA : TextureFormat::RGBA;
+    }
+}
+
+TextureFormat getCompressedFormat(TextureFormat format, TextureImporter::Compression compression)
+{
+    const bool sRGB = format == TextureFormat::SRGB || format == TextureFormat::SRGBA;
+    const bool hdr = format == TextureFormat::RGBHalf || format == TextureFormat::RGBAHalf;
+
+    switch (compression)
+    {
+    case TextureImporter::Compression::BC6H:    return hdr ? TextureFormat::BC6H : format;
+    case TextureImporter::Compression::RGB9E5:  return hdr ? TextureFormat::RGB9E5 : format;
+    case TextureImporter::Compression::BC1: return sRGB ? TextureFormat::BC1SRGB : TextureFormat::BC1;
+    case TextureImporter::Compression::BC3: return sRGB ? TextureFormat::BC3SRGB : TextureFormat::BC3;
+    case TextureImporter::Compression::BC4: return TextureFormat::BC4;
+    case TextureImporter::Compression::BC5: return TextureFormat::BC5;
+    case TextureImporter::Compression::BC7: return sRGB ? TextureFormat::BC7SRGB : TextureFormat::BC7;
+    case TextureImporter::Compression::Auto:
+        switch (format)
+        {
+        case TextureFormat::R:      return TextureFormat::BC4;
+        case TextureFormat::RG:     return TextureFormat::BC5;
+        case TextureFormat::RGB:    return TextureFormat::BC1;
+        case TextureFormat::SRGB:   return TextureFormat::BC1SRGB;
+        case TextureFormat::RGBA:   return TextureFormat::BC7;
+        case TextureFormat::SRGBA:  return TextureFormat::BC7SRGB;
+        default:                    return format;
+        }
+    case TextureImporter::Compression::None:
+    default:
+        return format;
     }
 }
 
@@ -49,14 +95,100 @@ std::pair<int, bool> getChannelCountAndColorspace(TextureImporter::ImportFormat
     return { channels, sRGB };
 }
 
+// rows of an image converted per job
+constexpr size_t ROW_GRAIN = 16;
+
+MipmapGenerator::Settings mipmapSettings(const TextureSampler& sampler, const TextureImporter::ProcessingSettings& processing)
+{
+    // mirrored borders behave like repeated ones for the filter
+    MipmapGenerator::Settings settings;
+    settings.wrap = sampler.wrap == TextureWrap::Repeat || sampler.wrap == TextureWrap::Mirror;
+    settings.normalMap = processing.normalMap;
+    settings.alphaCutoff = processing.alphaCutoff;
+    return settings;
+}
+
+// settings changing the cached levels
+uint64_t processingHash(const TextureSampler& sampler, const TextureImporter::ProcessingSettings& processing)
+{
+    const MipmapGenerator::Settings settings = mipmapSettings(sampler, processing);
+
+    uint64_t hash = Hash::combine(Hash::FNV_OFFSET, sampler.mipmapping);
+    hash = Hash::combine(hash, static_cast<int>(processing.compression));
+    hash = Hash::combine(hash, settings.wrap);
+    hash = Hash::combine(hash, settings.normalMap);
+    hash = Hash::combine(hash, settings.alphaCutoff);
+    return hash;
+}
+
+uint64_t contentHash(const std::string& filepath)
+{
+    MappedFile source(filepath);
+    return source.isValid() ? Hash::content(source.data(), source.size()) : 0;
+}
+
+// everything the decoded and uploaded texture depends on besides the file
+uint64_t importOptionsHash(TextureImporter::ImportFormat format, 
+    const TextureSampler& sampler, 
+    const TextureImporter::ProcessingSettings& processing)
+{
+    uint64_t hash = Hash::combine(Hash::FNV_OFFSET, static_cast<int>(format));
+    hash = Hash::combine(hash, static_cast<int>(sampler.filter));
+    hash = Hash::combine(hash, static_cast<int>(sampler.wrap));
+    hash = Hash::combine(hash, sampler.mipmapping);
+    hash = Hash::combine(hash, sampler.borderColor);
+    hash = Hash::combine(hash, static_cast<int>(processing.compression));
+    hash = Hash::combine(hash, processing.normalMap);
+    hash = Hash::combine(hash, processing.alphaCutoff);
+    return hash;
+}
+
+// 0 for files which could not be read
+uint64_t importContentKey(uint64_t sourceHash, uint64_t options)
+{
+    return sourceHash != 0 ? Hash::combine(sourceHash, options) : 0;
+}
+
 TextureImporter::TextureImporter(GraphicsAPISPtr api)
-    : m_api(api)
+    : m_decodeCounter(std::make_shared<JobCounter>())
+    , m_api(api)
 {
+    // global stb state, written once before any decode job can read it
+    static std::once_flag flipOnLoad;
+    std::call_once(flipOnLoad, []() { stbi_set_flip_vertically_on_load(true); });
 }
 
 TextureImporter::~TextureImporter()
 {
-    waitForCompletion();
+    // pending imports are dropped, running decodes reference this
+    m_queuedTasks.clear();
+    JobSystem::instance().wait(m_decodeCounter);
+
+    collectDecoded();
+    for (AsyncTaskSPtr& task : m_uploadTasks)
+    {
+        release(*task);
+    }
+}
+
+void TextureImporter::setStreamingSettings(const StreamingSettings& settings)
+{
+    m_settings = settings;
+}
+
+const TextureImporter::StreamingSettings& TextureImporter::streamingSettings() const
+{
+    return m_settings;
+}
+
+void TextureImporter::setUseCache(bool useCache)
+{
+    m_useCache = useCache;
+}
+
+void TextureImporter::setResidencyManager(TextureResidencyManagerSPtr residency)
+{
+    m_residency = residency;
 }
 
 Texture2DSPtr TextureImporter::importFromFile(
@@ -64,24 +196,40 @@ Texture2DSPtr TextureImporter::importFromFile(
     ImportFormat format,
     TextureSampler sampler)
 {
-    ImageWrapper image = loadRawImageFile(filePath, format);
-    if (!image.data)
+    const uint64_t options = importOptionsHash(format, sampler, ProcessingSettings());
+
+    std::string pathKey;
+    Texture2DSPtr imported = findImported(filePath, options, pathKey);
+    if (imported)
+    {
+        return imported;
+    }
+
+    // the content is known after the decode, which hashes the file once
+    uint64_t sourceHash = 0;
+    MipChainUPtr mips = loadMipChain(filePath, format, sampler, ProcessingSettings(), &sourceHash);
+    if (!mips)
     {
         return nullptr;
     }
 
-    const TextureFormat textureFormat = getFormat(image.channels, image.sRGB, image.isFloat);
+    const uint64_t contentKey = importContentKey(sourceHash, options);
+    imported = findImportedByContent(filePath, contentKey, pathKey);
+    if (imported)
+    {
+        return imported;
+    }
 
     Texture2DSPtr texture = std::make_shared<Texture2D>(
-        image.width, image.height, textureFormat, sampler);
+        mips->width(), mips->height(), mips->format(), sampler);
 
-    if (!m_api->allocate(texture, image.data))
+    if (!upload(texture, *mips))
     {
-        texture.reset();
-        //TODO log error!
+        Logger::Error("Could not upload texture '%s'", filePath.c_str());
+        return nullptr;
     }
 
-    stbi_image_free(image.data);
+    addImported(pathKey, contentKey, texture, mips->size());
 
     return texture;
 }
@@ -89,7 +237,8 @@ Texture2DSPtr TextureImporter::importFromFile(
 Texture2DSPtr TextureImporter::importFromFileAsync(
     const std::string& filePath,
     ImportFormat format,
-    TextureSampler sampler)
+    TextureSampler sampler,
+    const ProcessingSettings& processing)
 {
     const std::filesystem::path path(filePath);
     if (!std::filesystem::exists(path) || !path.has_filename())
@@ -97,66 +246,664 @@ Texture2DSPtr TextureImporter::importFromFileAsync(
         throw std::runtime_error("Invalid path to Texture file.");
     }
 
-    AsyncTask& task = m_runningTasks.emplace_back();
-    // dummy texture
-    task.texture = std::make_shared<Texture2D>(1, 1, TextureFormat::RGB, sampler);
-    // trigger async texture load
-    task.result = std::async(&TextureImporter::loadRawImageFile, this, filePath, format);
+    // materials sharing a texture share the decode and the upload,
+    // only the path is checked here, the decode job checks the content
+    const uint64_t options = importOptionsHash(format, sampler, processing);
+
+    std::string pathKey;
+    Texture2DSPtr imported = findImported(filePath, options, pathKey);
+    if (imported)
+    {
+        return imported;
+    }
+
+    AsyncTaskSPtr task = std::make_shared<AsyncTask>();
+    task->texture = std::make_shared<Texture2D>(1, 1, TextureFormat::RGB, sampler);
+    task->filePath = filePath;
+    task->pathKey = pathKey;
+    task->format = format;
+    task->processing = processing;
+    task->decodedSize = 0;
+    task->options = options;
+    task->sourceHash = 0;
+    task->nextLevel = -1;
+    task->finestLevel = 0;
+
+    // the header is enough to reserve the decoded size up front,
+    // only the first page of the mapping is touched
+    const MappedFile header(filePath);
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    if (header.isValid() && header.size() <= static_cast<size_t>(std::numeric_limits<int>::max()) &&
+        stbi_info_from_memory(header.data(), static_cast<int>(header.size()), &width, &height, &channels))
+    {
+        const auto [desiredChannels, sRGB] = getChannelCountAndColorspace(format);
+        const bool isFloat = path.extension().string() == ".hdr";
+
+        const TextureFormat textureFormat = getFormat(
+            desiredChannels != 0 ? desiredChannels : channels, sRGB && !isFloat, isFloat);
+
+        task->decodedSize = MipChain::storageSize(textureFormat, width, height, sampler.mipmapping);
+    }
+
+    addImported(pathKey, 0, task->texture, task->decodedSize);
+
+    m_queuedTasks.push_back(task);
+
+    dispatchDecodes();
+
+    return task->texture;
+}
+
+// levels up to this extent are uploaded without budget
+constexpr int COARSE_LEVEL_EXTENT = 64;
+
+void TextureImporter::update()
+{
+    const Timer timer;
+
+    collectDecoded();
+    dispatchDecodes();
+
+    // every decoded texture gets its coarse levels before any is refined
+    bool ringBusy = false;
+    for (AsyncTaskSPtr& task : m_uploadTasks)
+    {
+        while (!ringBusy && task->nextLevel >= task->finestLevel)
+        {
+            const MipChain::Level& level = task->mips->level(task->nextLevel);
+            if (std::max(level.width, level.height) > COARSE_LEVEL_EXTENT)
+            {
+                break;
+            }
+
+            ringBusy = !uploadNextLevel(*task);
+        }
+    }
+
+    while (!ringBusy && !m_uploadTasks.empty() && 
+        timer.elapsedMs() < m_settings.uploadBudgetMs)
+    {
+        AsyncTask& task = *m_uploadTasks.front();
+
+        if (task.nextLevel >= task.finestLevel)
+        {
+            ringBusy = !uploadNextLevel(task);
+        }
+
+        if (task.nextLevel < task.finestLevel)
+        {
+            finish(task);
+            m_uploadTasks.pop_front();
+            ++m_streamedCount;
+        }
+    }
+
+    // uploads freed budget for the next decodes
+    dispatchDecodes();
 
-    return task.texture;
+    if (m_streamedCount > 0 && pendingCount() == 0)
+    {
+        Logger::Info("Streamed %zu textures, peak decoded memory %.2fMB",
+            m_streamedCount, m_peakMemory / (1024.f * 1024.f));
+
+        const ImportStatistics& stats = m_importStatistics;
+        if (stats.pathHits + stats.contentHits > 0)
+        {
+            Logger::Info("Reused %zu of %zu texture imports (%zu by content), saved %.2fMB",
+                stats.pathHits + stats.contentHits, stats.requests, stats.contentHits, 
+                stats.bytesSaved / (1024.f * 1024.f));
+        }
+
+        m_streamedCount = 0;
+        m_peakMemory = 0;
+    }
 }
 
 void TextureImporter::waitForCompletion()
 {
-    for (AsyncTask& task : m_runningTasks)
+    while (pendingCount() > 0)
     {
-        ImageWrapper image = task.result.get();
-        if (!image.data)
+        collectDecoded();
+        dispatchDecodes();
+
+        if (m_uploadTasks.empty())
         {
+            JobSystem::instance().wait(m_decodeCounter);
             continue;
         }
 
-        const TextureFormat textureFormat = getFormat(image.channels, image.sRGB, image.isFloat);
+        // blocking, bypasses the upload ring
+        for (AsyncTaskSPtr& task : m_uploadTasks)
+        {
+            if (m_api->allocate(task->texture))
+            {
+                const MipChain& mips = *task->mips;
+                for (; task->nextLevel >= task->finestLevel; --task->nextLevel)
+                {
+                    task->texture->updateLevel(task->nextLevel, mips.data(task->nextLevel));
+                }
+                task->texture->setBaseLevel(task->finestLevel);
+                finish(*task);
+            }
+            else
+            {
+                release(*task);
+            }
+        }
+        m_uploadTasks.clear();
+    }
+}
+
+size_t TextureImporter::pendingCount() const
+{
+    return m_queuedTasks.size() + m_activeDecodes + m_uploadTasks.size();
+}
+
+const TextureImporter::ImportStatistics& TextureImporter::importStatistics() const
+{
+    return m_importStatistics;
+}
+
+Texture2DSPtr TextureImporter::findImported(const std::string& filePath, uint64_t options,
+    std::string& outPathKey)
+{
+    ++m_importStatistics.requests;
 
-        task.texture->update(image.width, image.height, textureFormat);
-        if (!m_api->allocate(task.texture, image.data))
+    std::error_code error;
+    const std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(filePath, error);
+    outPathKey = (error ? filePath : canonicalPath.string()) + "|" + std::to_string(options);
+
+    const auto byPath = m_importedByPath.find(outPathKey);
+    if (byPath != m_importedByPath.end())
+    {
+        Texture2DSPtr texture = byPath->second.texture.lock();
+        if (texture)
+        {
+            ++m_importStatistics.pathHits;
+            m_importStatistics.bytesSaved += byPath->second.size;
+            return texture;
+        }
+    }
+
+    return nullptr;
+}
+
+Texture2DSPtr TextureImporter::findImportedByContent(const std::string& filePath, 
+    uint64_t contentKey, const std::string& pathKey)
+{
+    ImportedTexture imported = {};
+    {
+        std::lock_guard<std::mutex> lock(m_contentMutex);
+        const auto byContent = m_importedByContent.find(contentKey);
+        if (contentKey == 0 || byContent == m_importedByContent.end())
         {
-            task.texture.reset();
+            return nullptr;
         }
+        imported = byContent->second;
+    }
+
+    Texture2DSPtr texture = imported.texture.lock();
+    if (texture)
+    {
+        Logger::Info("Texture '%s' is identical to an earlier import", filePath.c_str());
+
+        ++m_importStatistics.contentHits;
+        m_importStatistics.bytesSaved += imported.size;
+
+        // the next request of this path is answered by the path lookup
+        m_importedByPath[pathKey] = imported;
+    }
+
+    return texture;
+}
+
+void TextureImporter::addImported(const std::string& pathKey, uint64_t contentKey,
+    Texture2DSPtr texture, size_t size)
+{
+    const ImportedTexture imported = { texture, size };
+
+    m_importedByPath[pathKey] = imported;
+    if (contentKey != 0)
+    {
+        std::lock_guard<std::mutex> lock(m_contentMutex);
+        m_importedByContent[contentKey] = imported;
+    }
+}
+
+Texture2DSPtr TextureImporter::claimContent(uint64_t contentKey, Texture2DSPtr texture, size_t size)
+{
+    if (contentKey == 0)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_contentMutex);
 
-        stbi_image_free(image.data);
+    ImportedTexture& imported = m_importedByContent[contentKey];
+    Texture2DSPtr registered = imported.texture.lock();
+    if (registered && registered != texture)
+    {
+        return registered;
     }
 
-    m_runningTasks.clear();
+    imported = { texture, size };
+    return nullptr;
+}
+
+void TextureImporter::collectDecoded()
+{
+    std::vector<AsyncTaskSPtr> decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_decodedMutex);
+        decoded.swap(m_decodedTasks);
+    }
+
+    for (AsyncTaskSPtr& task : decoded)
+    {
+        --m_activeDecodes;
+
+        if (task->sharedTexture)
+        {
+            // the texture handed out for this path samples the earlier
+            // import, its decode and upload were skipped
+            Logger::Info("Texture '%s' is identical to an earlier import", task->filePath.c_str());
+
+            task->texture->share(task->sharedTexture);
+
+            ++m_importStatistics.contentHits;
+            m_importStatistics.bytesSaved += task->decodedSize;
+
+            // the next request of this path gets the earlier texture itself
+            m_importedByPath[task->pathKey] = { task->sharedTexture, task->decodedSize };
+
+            task->sharedTexture.reset();
+            release(*task);
+        }
+        else if (task->mips)
+        {
+            const MipChain& mips = *task->mips;
+            task->texture->update(mips.width(), mips.height(), mips.format());
+            task->nextLevel = mips.levelCount() - 1;
+
+            // only the coarse levels get storage, the manager streams the rest
+            if (m_residency)
+            {
+                task->finestLevel = mips.levelForExtent(COARSE_LEVEL_EXTENT);
+                task->texture->setStorageLevel(task->finestLevel);
+            }
+
+            m_uploadTasks.push_back(task);
+        }
+        else
+        {
+            Logger::Error("Could not decode texture '%s'", task->filePath.c_str());
+            release(*task);
+
+            // imports of the same content which already share this texture 
+            // would have failed the same way, later ones decode on their own
+            std::lock_guard<std::mutex> lock(m_contentMutex);
+            const auto byContent = m_importedByContent.find(importContentKey(task->sourceHash, task->options));
+            if (byContent != m_importedByContent.end() && 
+                byContent->second.texture.lock() == task->texture)
+            {
+                m_importedByContent.erase(byContent);
+            }
+        }
+    }
+}
+
+void TextureImporter::dispatchDecodes()
+{
+    while (!m_queuedTasks.empty() && 
+        m_activeDecodes < m_settings.maxConcurrentDecodes)
+    {
+        AsyncTaskSPtr task = m_queuedTasks.front();
+
+        // a single image above the budget is decoded on its own
+        if (m_reservedMemory > 0 && 
+            m_reservedMemory + task->decodedSize > m_settings.memoryBudget)
+        {
+            break;
+        }
+
+        m_queuedTasks.pop_front();
+
+        ++m_activeDecodes;
+        m_reservedMemory += task->decodedSize;
+        m_peakMemory = std::max(m_peakMemory, m_reservedMemory);
+
+        JobSystem::instance().run([this, task]() {
+            // hashed before the decode, the first import of a content is 
+            // decoded and uploaded, byte identical files share its texture
+            const MappedFile source(task->filePath);
+            task->sourceHash = source.isValid() ? Hash::content(source.data(), source.size()) : 0;
+
+            task->sharedTexture = claimContent(importContentKey(task->sourceHash, task->options), 
+                task->texture, task->decodedSize);
+            if (!task->sharedTexture)
+            {
+                task->mips = loadMipChain(source, task->sourceHash, task->filePath, task->format,
+                    task->texture->sampler(), task->processing);
+            }
+
+            std::lock_guard<std::mutex> lock(m_decodedMutex);
+            m_decodedTasks.push_back(task);
+        }, m_decodeCounter);
+    }
+}
+
+bool TextureImporter::uploadNextLevel(AsyncTask& task)
+{
+    const int level = task.nextLevel;
+
+    // read only, mapped cache levels are uploaded in place
+    const MipChain& mips = *task.mips;
+    const GraphicsAPI::UploadStatus status = m_api->upload(task.texture, level, 
+        mips.data(level), mips.level(level).size);
+
+    if (status == GraphicsAPI::UploadStatus::Deferred)
+    {
+        return false;
+    }
+
+    if (status == GraphicsAPI::UploadStatus::Complete)
+    {
+        // finer levels stay clamped until they arrive
+        task.texture->setBaseLevel(level);
+        --task.nextLevel;
+    }
+    else
+    {
+        Logger::Error("Could not upload texture '%s'", task.filePath.c_str());
+        task.nextLevel = -1;
+        task.mips.reset();
+    }
+
+    return true;
+}
+
+void TextureImporter::finish(AsyncTask& task)
+{
+    if (m_residency && task.mips)
+    {
+        m_residency->track(task.filePath, task.texture, std::move(task.mips));
+    }
+
+    release(task);
+}
+
+void TextureImporter::release(AsyncTask& task)
+{
+    task.mips.reset();
+
+    m_reservedMemory -= task.decodedSize;
+}
+
+bool TextureImporter::upload(Texture2DSPtr texture, const MipChain& mips)
+{
+    texture->update(mips.width(), mips.height(), mips.format());
+    if (!m_api->allocate(texture))
+    {
+        return false;
+    }
+
+    for (int level = 0; level < mips.levelCount(); ++level)
+    {
+        texture->updateLevel(level, mips.data(level));
+    }
+
+    return true;
 }
 
 TextureImporter::ImageWrapper TextureImporter::loadRawImageFile(const std::string& filepath, ImportFormat format) const
+{
+    const MappedFile file(filepath);
+    return decodeImage(file, filepath, format);
+}
+
+TextureImporter::ImageWrapper TextureImporter::decodeImage(const MappedFile& file, const std::string& filepath, ImportFormat format) const
 {
     ImageWrapper image = ImageWrapper();
 
-    const std::filesystem::path path(filepath);
-    if (!std::filesystem::exists(path) || !path.has_filename())
+    if (!file.isValid() || file.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
     {
         return image;
     }
 
     const auto [desiredChannels, sRGB] = getChannelCountAndColorspace(format);
 
-    image.isFloat = path.extension().string() == ".hdr";
+    image.isFloat = std::filesystem::path(filepath).extension().string() == ".hdr";
     image.sRGB = !image.isFloat && sRGB;
 
-    stbi_set_flip_vertically_on_load(true);
-
+    // stb reads the mapped pages, no stdio buffering
+    const int size = static_cast<int>(file.size());
     if (image.isFloat)
     {
-        image.data = stbi_loadf(filepath.c_str(), &image.width, &image.height, &image.channels, desiredChannels);
+        image.data = stbi_loadf_from_memory(file.data(), size, &image.width, &image.height, &image.channels, desiredChannels);
     }
     else
     {
-        image.data = stbi_load(filepath.c_str(), &image.width, &image.height, &image.channels, desiredChannels);
+        image.data = stbi_load_from_memory(file.data(), size, &image.width, &image.height, &image.channels, desiredChannels);
     }
 
     image.channels = desiredChannels != 0 ? desiredChannels : image.channels;
 
     return image;
 }
+
+MipChainUPtr TextureImporter::loadMipChain(const std::string& filepath, ImportFormat format, TextureSampler sampler, const ProcessingSettings& processing, uint64_t* outSourceHash) const
+{
+    // hashed and decoded from the same mapping
+    const MappedFile source(filepath);
+
+    uint64_t sourceHash = 0;
+    if ((m_useCache || outSourceHash) && source.isValid())
+    {
+        sourceHash = Hash::content(source.data(), source.size());
+    }
+
+    if (outSourceHash)
+    {
+        *outSourceHash = sourceHash;
+    }
+
+    return loadMipChain(source, sourceHash, filepath, format, sampler, processing);
+}
+
+MipChainUPtr TextureImporter::loadMipChain(const MappedFile& source, uint64_t sourceHash, const std::string& filepath, ImportFormat format, const TextureSampler& sampler, const ProcessingSettings& processing) const
+{
+    // the cache is bound to the source content and the import settings
+    const uint64_t importFlags = Hash::combine(processingHash(sampler, processing), static_cast<int>(format));
+    const std::string cachePath = TextureCache::cachePath(filepath);
+
+    if (m_useCache && sourceHash != 0)
+    {
+        MipChainUPtr cached = TextureCache::read(cachePath, sourceHash, importFlags);
+        if (cached)
+        {
+            return cached;
+        }
+    }
+
+    ImageWrapper image = decodeImage(source, filepath, format);
+    if (!image.data)
+    {
+        return nullptr;
+    }
+
+    MipChainUPtr mips = std::make_unique<MipChain>(
+        getFormat(image.channels, image.sRGB, image.isFloat), 
+        image.width, 
+        image.height, 
+        sampler.mipmapping);
+
+    if (image.isFloat)
+    {
+        // halves the decoded image before mip generation and upload
+        const size_t rowCount = static_cast<size_t>(image.width) * image.channels;
+        const float* source = static_cast<const float*>(image.data);
+        uint16_t* target = reinterpret_cast<uint16_t*>(mips->data());
+
+        JobSystem::instance().parallelFor(static_cast<size_t>(image.height), [&](size_t y) {
+            FloatPacking::toHalf(source + y * rowCount, target + y * rowCount, rowCount);
+        }, ROW_GRAIN);
+    }
+    else
+    {
+        std::memcpy(mips->data(), image.data, mips->level(0).size);
+    }
+    stbi_image_free(image.data);
+
+    processLevels(mips, sampler, processing, filepath);
+
+    if (m_useCache && sourceHash != 0)
+    {
+        TextureCache::write(cachePath, sourceHash, importFlags, *mips);
+    }
+
+    return mips;
+}
+
+MipChainUPtr TextureImporter::loadPackedMipChain(const std::array<PackedChannel, 4>& channels, TextureSampler sampler, const ProcessingSettings& processing) const
+{
+    // the first file decides the size and the cache location
+    const auto reference = std::find_if(channels.begin(), channels.end(), 
+        [](const PackedChannel& channel) { return !channel.path.empty(); });
+
+    uint64_t sourceHash = 0;
+    uint64_t importFlags = processingHash(sampler, processing);
+    for (const PackedChannel& channel : channels)
+    {
+        importFlags = Hash::combine(importFlags, channel.value);
+    }
+    const std::string cachePath = reference != channels.end() ? 
+        TextureCache::cachePath(reference->path + ".packed") : "";
+
+    if (m_useCache && !cachePath.empty())
+    {
+        sourceHash = Hash::FNV_OFFSET;
+        for (const PackedChannel& channel : channels)
+        {
+            sourceHash = Hash::combine(sourceHash, channel.path.empty() ? 0 : contentHash(channel.path));
+        }
+
+        MipChainUPtr cached = TextureCache::read(cachePath, sourceHash, importFlags);
+        if (cached)
+        {
+            return cached;
+        }
+    }
+
+    std::array<ImageWrapper, 4> images = {};
+    bool valid = true;
+    for (size_t c = 0; c < channels.size(); ++c)
+    {
+        if (channels[c].path.empty())
+        {
+            continue;
+        }
+
+        images[c] = loadRawImageFile(channels[c].path, ImportFormat::R);
+        if (!images[c].data || images[c].isFloat)
+        {
+            Logger::Error("Texture '%s' cannot be packed, 8 bit images only", channels[c].path.c_str());
+            valid = false;
+        }
+    }
+
+    const ImageWrapper* size = reference != channels.end() ? 
+        &images[reference - channels.begin()] : nullptr;
+
+    MipChainUPtr mips;
+    if (valid)
+    {
+        mips = std::make_unique<MipChain>(TextureFormat::RGBA,
+            size ? size->width : 1,
+            size ? size->height : 1,
+            sampler.mipmapping);
+
+        const int width = mips->width();
+        const int height = mips->height();
+        uint8_t* pixels = mips->data();
+
+        JobSystem::instance().parallelFor(static_cast<size_t>(height), [&](size_t y) {
+            uint8_t* row = pixels + y * width * 4;
+
+            for (size_t c = 0; c < channels.size(); ++c)
+            {
+                const ImageWrapper& image = images[c];
+                if (!image.data)
+                {
+                    for (int x = 0; x < width; ++x)
+                    {
+                        row[x * 4 + c] = channels[c].value;
+                    }
+                    continue;
+                }
+
+                // sources of another size are sampled nearest
+                const size_t sy = y * image.height / height;
+                const uint8_t* source = static_cast<const uint8_t*>(image.data) + sy * image.width;
+                if (image.width == width)
+                {
+                    for (int x = 0; x < width; ++x)
+                    {
+                        row[x * 4 + c] = source[x];
+                    }
+                }
+                else
+                {
+                    for (int x = 0; x < width; ++x)
+                    {
+                        row[x * 4 + c] = source[static_cast<size_t>(x) * image.width / width];
+                    }
+                }
+            }
+        }, ROW_GRAIN);
+    }
+
+    for (ImageWrapper& image : images)
+    {
+        if (image.data)
+        {
+            stbi_image_free(image.data);
+        }
+    }
+
+    if (!mips)
+    {
+        return nullptr;
+    }
+
+    processLevels(mips, sampler, processing, reference != channels.end() ? reference->path : "packed");
+
+    if (m_useCache && sourceHash != 0)
+    {
+        TextureCache::write(cachePath, sourceHash, importFlags, *mips);
+    }
+
+    return mips;
+}
+
+void TextureImporter::processLevels(MipChainUPtr& mips, const TextureSampler& sampler, const ProcessingSettings& processing, const std::string& name) const
+{
+    if (mips->levelCount() > 1 && !MipmapGenerator::generate(*mips, mipmapSettings(sampler, processing)))
+    {
+        Logger::Warning("No mip levels generated for texture '%s'", name.c_str());
+    }
+
+    // HDR images are only compressed on request
+    const TextureFormat compressedFormat = getCompressedFormat(mips->format(), processing.compression);
+    if (compressedFormat != mips->format())
+    {
+        MipChainUPtr compressed = compressedFormat == TextureFormat::RGB9E5 ?
+            FloatPacking::pack(*mips, compressedFormat) :
+            BlockCompression::compress(*mips, compressedFormat);
+        if (compressed)
+        {
+            mips = std::move(compressed);
+        }
+    }
+}
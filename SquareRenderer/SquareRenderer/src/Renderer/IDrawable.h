@@ -13,6 +13,8 @@ public:
 
 	virtual MaterialSPtr material() const = 0;
 
+	virtual unsigned int instanceCount() const = 0;
+
 	virtual void preRender(MaterialSPtr boundMaterial) = 0;
 
 	virtual void postRender() = 0;
@@ -14,6 +14,8 @@ struct RenderStatisticsData
     double gpuTimeMs = 0.0;
 
     size_t rendererdPrimitives = 0;
+
+    size_t drawCalls = 0;
 };
 
 class IRenderPass
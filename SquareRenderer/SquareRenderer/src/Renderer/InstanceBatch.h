@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Renderer/IDrawable.h"
+
+#include <vector>
+
+DECLARE_PTRS(InstanceBatch);
+DECLARE_PTRS(InstanceBuffer);
+DECLARE_PTRS(ResourceManager);
+DECLARE_PTRS(SceneNode);
+
+class InstanceBatch : public IDrawable
+{
+public:
+	// has to match the storage buffer binding in Includes/Instancing.glsl
+	static constexpr int BINDING_POINT = 0;
+
+	InstanceBatch(IGeometrySPtr geometry, MaterialSPtr material);
+
+	void addInstance(SceneNodeSPtr node);
+
+	const std::vector<SceneNodeSPtr>& instances() const;
+
+	InstanceBufferSPtr instanceBuffer() const;
+
+	virtual IGeometrySPtr geometry() const override;
+
+	virtual MaterialSPtr material() const override;
+
+	virtual unsigned int instanceCount() const override;
+
+	virtual void preRender(MaterialSPtr boundMaterial) override;
+
+	virtual void postRender() override;
+
+	// groups scene nodes sharing geometry and material into instanced batches,
+	// all other drawables are passed through unchanged
+	static std::vector<IDrawableSPtr> build(
+		const std::vector<IDrawableSPtr>& drawables,
+		ResourceManagerSPtr resources,
+		size_t minInstanceCount = 2);
+
+private:
+	void updateInstanceData();
+
+	IGeometrySPtr m_geometry;
+
+	MaterialSPtr m_material;
+
+	InstanceBufferSPtr m_instanceBuffer;
+
+	std::vector<SceneNodeSPtr> m_instances;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Common/Math3D.h"
+#include "API/SharedResource.h"
+
+#include <vector>
+
+DECLARE_PTRS(InstanceBuffer);
+
+struct InstanceData
+{
+	glm::mat4 modelToWorld = glm::mat4(1);
+	glm::mat4 normalToWorld = glm::mat4(1);
+
+	bool operator==(const InstanceData& other) const
+	{
+		return modelToWorld == other.modelToWorld;
+	}
+};
+
+class InstanceBuffer
+{
+public:
+	explicit InstanceBuffer(int bindingPoint);
+
+	void link(IStorageBufferResourceUPtr resource);
+
+	bool linked() const;
+
+	int bindingPoint() const;
+
+	size_t count() const;
+
+	size_t dataSize() const;
+
+	const std::vector<InstanceData>& data() const;
+
+	// uploads the instance data only if it differs from the current content
+	bool update(const std::vector<InstanceData>& data);
+
+	void bind();
+
+	void unbind();
+
+private:
+	IStorageBufferResourceUPtr m_linkedResource;
+
+	int m_bindingPoint;
+
+	std::vector<InstanceData> m_data;
+};
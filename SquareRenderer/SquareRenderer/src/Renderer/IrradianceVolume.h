@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Common/Math3D.h"
+#include "Common/SphericalHarmonics.h"
+#include "Scene/BoundingBox.h"
+
+#include <cstdint>
+#include <vector>
+
+DECLARE_PTRS(IrradianceVolume);
+DECLARE_PTRS(Texture3D);
+
+// regular grid of light probes spanning a box, each holding the 
+// L2 diffuse irradiance at its position, probes are baked one by one
+class IrradianceVolume
+{
+public:
+
+	IrradianceVolume(const BoundingBox& bounds, const glm::ivec3& resolution);
+
+	// probes per axis with the longest axis getting the maximum,
+	// at least two probes per axis
+	static glm::ivec3 resolutionFor(const BoundingBox& bounds, int maxProbes);
+
+	const BoundingBox& bounds() const;
+
+	const glm::ivec3& resolution() const;
+
+	int probeCount() const;
+
+	// probes sit on the grid points, the outermost on the bounds
+	glm::vec3 probePosition(int index) const;
+
+	const SphericalHarmonics::Coefficients& probe(int index) const;
+
+	void setProbe(int index, const SphericalHarmonics::Coefficients& coefficients);
+
+	// all probes unbaked, holding the fallback until they are baked
+	void reset(const SphericalHarmonics::Coefficients& fallback);
+
+	bool isBaked(int index) const;
+
+	int bakedCount() const;
+
+	bool isComplete() const;
+
+	// first unbaked probe, -1 if complete
+	int nextUnbaked() const;
+
+	// one slab of probes per coefficient stacked along z, 
+	// allocated on first use
+	Texture3DSPtr texture() const;
+
+	// uploads the probes changed since the last call
+	void updateTexture();
+
+protected:
+
+	BoundingBox m_bounds;
+
+	glm::ivec3 m_resolution;
+
+	std::vector<SphericalHarmonics::Coefficients> m_probes;
+
+	std::vector<uint8_t> m_baked;
+
+	Texture3DSPtr m_texture;
+
+	bool m_dirty = true;
+};
@@ -31,6 +31,11 @@ public:
 		return m_material;
 	}
 
+	virtual unsigned int instanceCount() const override
+	{
+		return 1;
+	}
+
 	virtual void preRender(MaterialSPtr /*boundMaterial*/)
 	{
 	}
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "Common/Macros.h"
+#include "Common/SphericalHarmonics.h"
 #include "Renderer/Renderer.h"
 #include "Renderer/UniformBlockData.h"
 
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <unordered_map>
 
@@ -22,18 +25,26 @@ DECLARE_PTRS(Cubemap);
 DECLARE_PTRS(IRenderPass);
 DECLARE_PTRS(ResourceManager);
 DECLARE_PTRS(ShadowMappingRenderPass);
+DECLARE_PTRS(TextureResidencyManager);
+DECLARE_PTRS(IrradianceVolume);
 
 template<typename T>
 class UniformBlockData;
 struct CameraUniformBlock;
 struct LightsUniformBlock;
+struct EnvironmentUniformBlock;
+struct PrefilterUniformBlock;
 struct RenderCommand;
 
 struct IBLData
 {
+	// only generated while a program samples it
 	CubemapSPtr diffuse;
 	CubemapSPtr specular;
 	Texture2DSPtr brdf;
+
+	// diffuse irradiance divided by pi
+	SphericalHarmonics::Coefficients irradianceSH;
 };
 
 class RenderEngine
@@ -44,7 +55,8 @@ public:
 
 	~RenderEngine();
 
-	void setScene(SceneSPtr scene);
+	// the irradiance volume is cached next to the scene file if its path is given
+	void setScene(SceneSPtr scene, const std::string& sourcePath = std::string());
 
 	void setMainCamera(CameraSPtr camera);
 
@@ -56,39 +68,80 @@ public:
 
 	void setupGizmos(const std::string& programName);
 
+	// adds a texture feedback pass driving the residency of streamed textures
+	void setTextureResidency(TextureResidencyManagerSPtr residency);
+
 	const std::vector<IRenderPassSPtr>& renderPasses() const;
 
+	// nullptr if no program samples it
+	IrradianceVolumeSPtr irradianceVolume() const;
+
 	void update(double deltaTime);
 
 	void render();
 
 	/* Helper Functions */
 
+	// runs the helpers below on the CPU, see IBLBaker, 
+	// falls back to the GPU for unsupported formats
+	void setCPUPrecomputation(bool enabled);
+
 	void projectEquirectangularToCubemap(Texture2DSPtr source, CubemapSPtr target);
 
-	IBLData generateIBL(CubemapSPtr hdri);
+	// results are cached per environment map, on disk next to 
+	// the source image if its path is given
+	IBLData generateIBL(CubemapSPtr hdri, const std::string& sourcePath = std::string());
+
+	// renders the image based lighting of an equirectangular image and
+	// compares the read back levels with the IBLBaker result, true if 
+	// the mean relative error of every level is within the tolerance
+	bool verifyCPUPrecomputation(Texture2DSPtr equirectangular, float tolerance);
 
 	void hdriToDiffuseIrradiance(CubemapSPtr hdri, CubemapSPtr diffIrradiance);
 
+	// projected on the CPU from a read back level of the environment map
+	SphericalHarmonics::Coefficients hdriToIrradianceSH(CubemapSPtr hdri);
+
 	void hdriToSpecularIrradiance(CubemapSPtr hdri, CubemapSPtr specIrradiance);
+
+	// captures the next unbaked probes of the irradiance volume,
+	// called once per frame after rendering until it is complete
+	void bakeIrradianceProbes(int count);
 	
 	void generateIntegratedBRDF(Texture2DSPtr integratedBRDF);
 
-	void packTextures(
-		Texture2DSPtr target, 
-		Texture2DSPtr sourceRed, 
-		Texture2DSPtr sourceGreen, 
-		Texture2DSPtr sourceBlue, 
-		Texture2DSPtr sourceAlpha);
-
 protected:
 
 	void setupPostProcessing();
 
+	// reads the baked lookup table, generates and bakes it if outdated
+	void loadIntegratedBRDF(Texture2DSPtr integratedBRDF);
+
+	// probe grid over the scene bounds, restores baked probes from the cache
+	void setupIrradianceVolume(const std::string& scenePath);
+
+	// renders the opaque scene and the sky around the position into the
+	// capture cubemap and projects it to spherical harmonics
+	bool captureProbe(const glm::vec3& position, SphericalHarmonics::Coefficients& outCoefficients);
+
+	// keeps the progress of a partial bake
+	void writeIrradianceVolumeCache();
+
+	// layered variant of the program if the vertex shader can select 
+	// the layer, the geometry shader variant otherwise
+	MaterialSPtr instanciateCubemapMaterial(const std::string& programName) const;
+
+	// all six faces of the bound cubemap target in one draw
+	void renderCubemapFaces(IGeometrySPtr geometry, MaterialSPtr material);
+
 	GraphicsAPISPtr m_api;
 
 	MaterialLibrarySPtr m_matlib;
 
+	bool m_vertexLayerOutput = false;
+
+	bool m_cpuPrecomputation = false;
+
 	RendererUPtr m_renderer;
 
 	SceneSPtr m_scene;
@@ -107,6 +160,8 @@ protected:
 
 	std::shared_ptr<UniformBlockData<CameraUniformBlock>> m_cameraUniformBlock;
 	std::shared_ptr<UniformBlockData<LightsUniformBlock>> m_lightsUniformBlock;
+	std::shared_ptr<UniformBlockData<EnvironmentUniformBlock>> m_environmentUniformBlock;
+	std::shared_ptr<UniformBlockData<PrefilterUniformBlock>> m_prefilterUniformBlock;
 
 	bool m_showGizmos = true;
 
@@ -116,11 +171,36 @@ protected:
 
 	ShadowMappingRenderPassSPtr m_shadowMapping;
 
+	TextureResidencyManagerSPtr m_textureResidency;
+
 	IBLData m_ibl;
 
+	std::unordered_map<CubemapSPtr, IBLData> m_iblCache;
+
+	Texture2DSPtr m_integratedBRDF;
+
+	IrradianceVolumeSPtr m_irradianceVolume;
+
+	std::string m_irradianceVolumeCachePath;
+
+	uint64_t m_irradianceVolumeKey = 0;
+
+	// baked probes in the cache file
+	int m_irradianceVolumeCachedCount = 0;
+
+	// released once the volume is complete
+	CubemapSPtr m_probeCapture;
+
+	RenderTargetSPtr m_probeTarget;
+
+	CameraSPtr m_probeCamera;
+
+	std::vector<IRenderPassSPtr> m_probeCapturePasses;
+
 	void rebuildCommandList();
 
 	void updateCameraUniformData(CameraSPtr camera);
 	void updateLightsUniformData();
+	void updateEnvironmentUniformData(bool sampleIrradianceVolume = true);
 };
 
@@ -38,6 +38,14 @@ public:
 
 	virtual int level() const;
 
+	// renders into another mip level of the color targets without a new allocation
+	void setLevel(int level);
+
+	// layer of cubemap or 3D color targets rendered into, all layers if negative
+	int layer() const;
+
+	void setLayer(int layer);
+
 	SharedResource::Handle handle() const override;
 
 	const std::vector<ITextureSPtr>& colorTargets() const;
@@ -69,5 +77,7 @@ protected:
 	IRenderTargetResourceUPtr m_linkedResource;
 
 	int m_level;
+
+	int m_layer = -1;
 };
 
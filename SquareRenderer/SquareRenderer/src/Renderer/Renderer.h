@@ -21,7 +21,7 @@ class RenderVisitor : public IGeometryVisitor
 public:
     virtual ~RenderVisitor() {}
 
-	void prepare(const Material& mat);
+	void prepare(const Material& mat, unsigned int instanceCount = 1);
 
 	virtual void visit(Mesh& mesh) override;
 
@@ -31,11 +31,17 @@ public:
 
 	size_t primitiveCount() const;
 
+	size_t drawCallCount() const;
+
 private:
 
     bool m_tesselate = false;
 
+	unsigned int m_instanceCount = 1;
+
 	size_t m_primitiveCount = 0;
+
+	size_t m_drawCallCount = 0;
 };
 
 class Renderer
@@ -44,10 +50,14 @@ public:
 
 	Renderer();
 
-	void render(IGeometrySPtr geo, MaterialSPtr mat);
+	// every instance is drawn once per layer, the vertex shader
+	// selects the layer, see Instancing.glsl
+	void render(IGeometrySPtr geo, MaterialSPtr mat, unsigned int instanceCount = 1, unsigned int layerCount = 1);
 
 	size_t primitiveCounter() const;
 
+	size_t drawCallCounter() const;
+
 	void resetPrimitiveCounter();
 
 	void blit(IRenderTargetSPtr source, IRenderTargetSPtr target, 
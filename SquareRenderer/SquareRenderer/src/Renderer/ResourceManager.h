@@ -8,6 +8,7 @@ DECLARE_PTRS(GraphicsAPI);
 DECLARE_PTRS(IGeometry);
 DECLARE_PTRS(IRenderTarget);
 DECLARE_PTRS(RenderTarget);
+DECLARE_PTRS(InstanceBuffer);
 
 class ResourceManager
 {
@@ -20,6 +21,8 @@ public:
 
 	bool allocateRenderTarget(RenderTargetSPtr source);
 
+	bool allocateInstanceBuffer(InstanceBufferSPtr instanceBuffer);
+
 	RenderTargetSPtr createSimpleColorTarget(IRenderTargetSPtr source, float scale = 1.f,
 		TextureFormat format = TextureFormat::RGBAHalf,
 		TextureSampler sampler = { TextureFilter::Linear, TextureWrap::Mirror, false, glm::vec4(0) });
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Renderer/BaseGeometryRenderPass.h"
+
+#include <vector>
+
+DECLARE_PTRS(IDrawable);
+DECLARE_PTRS(RenderTarget);
+DECLARE_PTRS(GPUReadback);
+DECLARE_PTRS(TextureResidencyManager);
+DECLARE_PTRS(TextureFeedbackRenderPass);
+
+// renders the drawable index and uv footprint of every screen tile
+// into a small buffer, the readback tells the residency manager which 
+// mip levels of which textures are visible
+class TextureFeedbackRenderPass : public BaseGeometryRenderPass
+{
+public:
+
+	TextureFeedbackRenderPass(ResourceManagerSPtr resources, MaterialLibrarySPtr matlib, TextureResidencyManagerSPtr residency);
+
+	virtual ~TextureFeedbackRenderPass();
+
+	void setup(IRenderTargetSPtr source, const std::vector<IDrawableSPtr>& drawables);
+
+protected:
+
+	virtual void renderInternal(Renderer& renderer) const override;
+
+	virtual void updateInternal(double deltaTime) override;
+
+	TextureResidencyManagerSPtr m_residency;
+
+	RenderTargetSPtr m_feedbackBuffer;
+
+	MaterialSPtr m_feedbackMaterial;
+
+	std::vector<IDrawableSPtr> m_drawables;
+
+	GPUReadbackUPtr m_readback;
+
+	std::vector<float> m_pixels;
+
+	mutable int m_frame = 0;
+};
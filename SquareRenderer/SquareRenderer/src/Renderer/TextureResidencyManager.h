@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Common/Macros.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+DECLARE_PTRS(GraphicsAPI);
+DECLARE_PTRS(Texture2D);
+DECLARE_PTRS(MipChain);
+DECLARE_PTRS(TextureResidencyManager);
+
+// keeps the mip levels requested by the texture feedback resident
+// within a GPU memory budget, finer levels of the textures seen least
+// recently are evicted first
+class TextureResidencyManager
+{
+public:
+
+	struct Entry
+	{
+		std::string name;
+
+		Texture2DSPtr texture;
+
+		// client copy of all levels, evicted levels are streamed back from it
+		MipChainSPtr mips;
+
+		// coarsest storage level, never evicted
+		int floorLevel;
+
+		// finest level the last feedback asked for
+		int requestedLevel;
+
+		// feedback cycle the texture was last visible in
+		uint64_t lastUsed;
+	};
+
+	TextureResidencyManager(GraphicsAPISPtr api, size_t budget);
+
+	~TextureResidencyManager();
+
+	void setBudget(size_t budget);
+
+	size_t budget() const;
+
+	// the current storage level of the texture becomes its floor
+	void track(const std::string& name, Texture2DSPtr texture, MipChainSPtr mips);
+
+	// collects the levels of one feedback readback, untracked
+	// textures are ignored
+	void beginFeedback();
+
+	void request(const Texture2DSPtr& texture, int level);
+
+	void endFeedback();
+
+	// evicts and streams levels within the upload budget,
+	// called once per frame on the main thread
+	void update();
+
+	const std::vector<Entry>& entries() const;
+
+	size_t residentBytes(const Entry& entry) const;
+
+	size_t requestedBytes(const Entry& entry) const;
+
+	// of all tracked textures
+	size_t residentBytes() const;
+
+	size_t requestedBytes() const;
+
+private:
+
+	size_t levelBytes(const Entry& entry, int finestLevel) const;
+
+	// drops finer levels than needed, least recently used first
+	void evict(size_t& resident);
+
+	// one level per visible texture and round, returns false once
+	// the upload ring is busy
+	bool streamIn(size_t& resident);
+
+	GraphicsAPISPtr m_api;
+
+	size_t m_budget;
+
+	std::vector<Entry> m_entries;
+
+	std::unordered_map<const Texture2D*, size_t> m_lookup;
+
+	// finest level per entry of the feedback in progress
+	std::unordered_map<size_t, int> m_requests;
+
+	uint64_t m_feedbackCycle = 0;
+};
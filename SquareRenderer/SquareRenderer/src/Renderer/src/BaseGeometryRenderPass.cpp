@@ -18,7 +18,7 @@ void BaseGeometryRenderPass::renderGeometry(Renderer& renderer, const std::vecto
 	for (const auto& elem : drawables)
 	{
 		elem->preRender(elem->material());
-		renderer.render(elem->geometry(), elem->material());
+		renderer.render(elem->geometry(), elem->material(), elem->instanceCount());
 		elem->postRender();
 	}
 }
@@ -39,7 +39,7 @@ void BaseGeometryRenderPass::renderGeometry(
 		// TODO handle material override
 
 		elem->preRender(overrideMaterial);
-		renderer.render(elem->geometry(), overrideMaterial);
+		renderer.render(elem->geometry(), overrideMaterial, elem->instanceCount());
 		elem->postRender();
 	}
 }
@@ -43,6 +43,7 @@ void BaseRenderPass::render(Renderer& renderer) const
 	m_gpuTimer->end();
 	m_renderStatistics.cpuTimeMs += m_timer.elapsedMs();
 	m_renderStatistics.rendererdPrimitives = renderer.primitiveCounter();
+	m_renderStatistics.drawCalls = renderer.drawCallCounter();
 }
 
 void BaseRenderPass::update(double deltaTime)
@@ -0,0 +1,147 @@
+#include "Renderer/InstanceBatch.h"
+#include "Common/Logger.h"
+#include "Material/Material.h"
+#include "Material/ShaderProgram.h"
+#include "Renderer/InstanceBuffer.h"
+#include "Renderer/ResourceManager.h"
+#include "Scene/IGeometry.h"
+#include "Scene/SceneNode.h"
+
+#include <map>
+
+InstanceBatch::InstanceBatch(IGeometrySPtr geometry, MaterialSPtr material)
+	: m_geometry(geometry)
+	, m_material(material)
+	, m_instanceBuffer(new InstanceBuffer(BINDING_POINT))
+{
+}
+
+void InstanceBatch::addInstance(SceneNodeSPtr node)
+{
+	m_instances.push_back(node);
+}
+
+const std::vector<SceneNodeSPtr>& InstanceBatch::instances() const
+{
+	return m_instances;
+}
+
+InstanceBufferSPtr InstanceBatch::instanceBuffer() const
+{
+	return m_instanceBuffer;
+}
+
+IGeometrySPtr InstanceBatch::geometry() const
+{
+	return m_geometry;
+}
+
+MaterialSPtr InstanceBatch::material() const
+{
+	return m_material;
+}
+
+unsigned int InstanceBatch::instanceCount() const
+{
+	return static_cast<unsigned int>(m_instances.size());
+}
+
+void InstanceBatch::preRender(MaterialSPtr /*boundMaterial*/)
+{
+	updateInstanceData();
+
+	m_instanceBuffer->bind();
+}
+
+void InstanceBatch::postRender()
+{
+	m_instanceBuffer->unbind();
+}
+
+void InstanceBatch::updateInstanceData()
+{
+	std::vector<InstanceData> data(m_instances.size());
+	for (size_t i = 0; i < m_instances.size(); ++i)
+	{
+		data[i].modelToWorld = m_instances[i]->worldTransform();
+		data[i].normalToWorld = m_instances[i]->normalTransform();
+	}
+
+	// only uploads if any transform changed
+	m_instanceBuffer->update(data);
+}
+
+std::vector<IDrawableSPtr> InstanceBatch::build(
+	const std::vector<IDrawableSPtr>& drawables,
+	ResourceManagerSPtr resources,
+	size_t minInstanceCount)
+{
+	typedef std::pair<IGeometry*, Material*> BatchKey;
+
+	// collect candidates per geometry and material
+	std::map<BatchKey, std::vector<SceneNodeSPtr>> candidates;
+	for (const IDrawableSPtr& drawable : drawables)
+	{
+		SceneNodeSPtr node = std::dynamic_pointer_cast<SceneNode>(drawable);
+		if (!node || !node->geometry() || !node->material())
+		{
+			continue;
+		}
+
+		// the instance id is not accessible in the tesselation stages
+		if (node->material()->program()->supportsTesselation())
+		{
+			continue;
+		}
+
+		candidates[{ node->geometry().get(), node->material().get() }].push_back(node);
+	}
+
+	std::vector<IDrawableSPtr> result;
+	result.reserve(drawables.size());
+
+	std::map<BatchKey, InstanceBatchSPtr> batches;
+	for (const IDrawableSPtr& drawable : drawables)
+	{
+		const BatchKey key = { drawable->geometry().get(), drawable->material().get() };
+
+		const auto& found = candidates.find(key);
+		if (found == candidates.end() || found->second.size() < minInstanceCount)
+		{
+			result.push_back(drawable);
+			continue;
+		}
+
+		// batch is emitted at the position of its first instance
+		if (batches.find(key) != batches.end())
+		{
+			continue;
+		}
+
+		InstanceBatchSPtr batch = std::make_shared<InstanceBatch>(
+			drawable->geometry(), drawable->material());
+
+		for (SceneNodeSPtr node : found->second)
+		{
+			batch->addInstance(node);
+		}
+
+		batch->updateInstanceData();
+		if (!resources->allocateInstanceBuffer(batch->instanceBuffer()))
+		{
+			Logger::Warning("Could not allocate instance buffer, fall back to single draw calls.");
+
+			result.push_back(drawable);
+			candidates.erase(found);
+			continue;
+		}
+
+		batches[key] = batch;
+		result.push_back(batch);
+	}
+
+	Logger::Info("Instancing: %i drawables merged into %i draw calls.",
+		static_cast<int>(drawables.size()), static_cast<int>(result.size()));
+
+	return result;
+}
@@ -0,0 +1,74 @@
+#include "Renderer/InstanceBuffer.h"
+
+InstanceBuffer::InstanceBuffer(int bindingPoint)
+	: m_bindingPoint(bindingPoint)
+{
+}
+
+void InstanceBuffer::link(IStorageBufferResourceUPtr resource)
+{
+	m_linkedResource = std::move(resource);
+}
+
+bool InstanceBuffer::linked() const
+{
+	return m_linkedResource && m_linkedResource->isValid();
+}
+
+int InstanceBuffer::bindingPoint() const
+{
+	if (m_linkedResource)
+	{
+		return m_linkedResource->bindingPoint();
+	}
+	else
+	{
+		return m_bindingPoint;
+	}
+}
+
+size_t InstanceBuffer::count() const
+{
+	return m_data.size();
+}
+
+size_t InstanceBuffer::dataSize() const
+{
+	return m_data.size() * sizeof(InstanceData);
+}
+
+const std::vector<InstanceData>& InstanceBuffer::data() const
+{
+	return m_data;
+}
+
+bool InstanceBuffer::update(const std::vector<InstanceData>& data)
+{
+	if (m_data != data)
+	{
+		m_data = data;
+
+		if (m_linkedResource)
+		{
+			return m_linkedResource->update(m_data.data(), dataSize());
+		}
+	}
+
+	return false;
+}
+
+void InstanceBuffer::bind()
+{
+	if (m_linkedResource)
+	{
+		m_linkedResource->bind();
+	}
+}
+
+void InstanceBuffer::unbind()
+{
+	if (m_linkedResource)
+	{
+		m_linkedResource->unbind();
+	}
+}
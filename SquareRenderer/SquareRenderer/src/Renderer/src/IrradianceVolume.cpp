@@ -0,0 +1,141 @@
+#include "Renderer/IrradianceVolume.h"
+#include "Texture/FloatPacking.h"
+#include "Texture/Texture3D.h"
+
+#include <algorithm>
+#include <cmath>
+
+IrradianceVolume::IrradianceVolume(const BoundingBox& bounds, const glm::ivec3& resolution)
+	: m_bounds(bounds)
+	, m_resolution(glm::max(resolution, glm::ivec3(2)))
+{
+	SphericalHarmonics::Coefficients black;
+	black.fill(glm::vec3(0.f));
+	reset(black);
+
+	TextureSampler sampler;
+	sampler.filter = TextureFilter::Linear;
+	sampler.wrap = TextureWrap::ClampToEdge;
+	sampler.mipmapping = false;
+
+	m_texture = std::make_shared<Texture3D>(m_resolution.x, m_resolution.y, 
+		m_resolution.z * SphericalHarmonics::COEFFICIENT_COUNT, TextureFormat::RGBHalf, sampler);
+}
+
+glm::ivec3 IrradianceVolume::resolutionFor(const BoundingBox& bounds, int maxProbes)
+{
+	const glm::vec3 size = bounds.size();
+	const float longest = std::max({ size.x, size.y, size.z });
+	if (longest <= 0.f)
+	{
+		return glm::ivec3(2);
+	}
+
+	glm::ivec3 result;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const int count = static_cast<int>(std::ceil(size[axis] / longest * (maxProbes - 1))) + 1;
+		result[axis] = std::clamp(count, 2, std::max(2, maxProbes));
+	}
+	return result;
+}
+
+const BoundingBox& IrradianceVolume::bounds() const
+{
+	return m_bounds;
+}
+
+const glm::ivec3& IrradianceVolume::resolution() const
+{
+	return m_resolution;
+}
+
+int IrradianceVolume::probeCount() const
+{
+	return m_resolution.x * m_resolution.y * m_resolution.z;
+}
+
+glm::vec3 IrradianceVolume::probePosition(int index) const
+{
+	const glm::ivec3 cell(
+		index % m_resolution.x,
+		(index / m_resolution.x) % m_resolution.y,
+		index / (m_resolution.x * m_resolution.y));
+
+	const glm::vec3 t = glm::vec3(cell) / glm::vec3(m_resolution - 1);
+	return m_bounds.min() + t * m_bounds.size();
+}
+
+const SphericalHarmonics::Coefficients& IrradianceVolume::probe(int index) const
+{
+	return m_probes[index];
+}
+
+void IrradianceVolume::setProbe(int index, const SphericalHarmonics::Coefficients& coefficients)
+{
+	m_probes[index] = coefficients;
+	m_baked[index] = 1;
+	m_dirty = true;
+}
+
+void IrradianceVolume::reset(const SphericalHarmonics::Coefficients& fallback)
+{
+	m_probes.assign(probeCount(), fallback);
+	m_baked.assign(probeCount(), 0);
+	m_dirty = true;
+}
+
+bool IrradianceVolume::isBaked(int index) const
+{
+	return m_baked[index] != 0;
+}
+
+int IrradianceVolume::bakedCount() const
+{
+	return static_cast<int>(std::count(m_baked.begin(), m_baked.end(), 1));
+}
+
+bool IrradianceVolume::isComplete() const
+{
+	return nextUnbaked() < 0;
+}
+
+int IrradianceVolume::nextUnbaked() const
+{
+	const auto found = std::find(m_baked.begin(), m_baked.end(), 0);
+	return found != m_baked.end() ? static_cast<int>(found - m_baked.begin()) : -1;
+}
+
+Texture3DSPtr IrradianceVolume::texture() const
+{
+	return m_texture;
+}
+
+void IrradianceVolume::updateTexture()
+{
+	if (!m_dirty || m_texture->handle() == SharedResource::INVALID_HANDLE)
+	{
+		return;
+	}
+
+	// texel (x, y, z + c * depth) holds coefficient c of probe (x, y, z)
+	const size_t count = m_probes.size();
+	std::vector<float> texels(count * SphericalHarmonics::COEFFICIENT_COUNT * 3);
+	for (size_t probe = 0; probe < count; ++probe)
+	{
+		for (int c = 0; c < SphericalHarmonics::COEFFICIENT_COUNT; ++c)
+		{
+			float* texel = &texels[(c * count + probe) * 3];
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				texel[channel] = m_probes[probe][c][channel];
+			}
+		}
+	}
+
+	std::vector<uint16_t> halfs(texels.size());
+	FloatPacking::toHalf(texels.data(), halfs.data(), texels.size());
+	m_texture->update(halfs.data());
+
+	m_dirty = false;
+}
@@ -1,17 +1,29 @@
 #include "Renderer/RenderEngine.h"
 #include "API/GraphicsAPI.h"
+#include "Common/Hash.h"
+#include "Common/ImportanceSampling.h"
 #include "Common/Logger.h"
+#include "Common/MappedFile.h"
 #include "Material/MaterialLibrary.h"
+#include "Preprocessor/IBLBaker.h"
+#include "Preprocessor/IBLCache.h"
+#include "Preprocessor/IrradianceVolumeCache.h"
+#include "Preprocessor/TextureCache.h"
 #include "Renderer/BloomRenderPass.h"
 #include "Renderer/Camera.h"
 #include "Renderer/DepthBuffer.h"
 #include "Renderer/GeometryRenderPass.h"
 #include "Renderer/GizmoHelper.h"
+#include "Renderer/InstanceBatch.h"
+#include "Renderer/IrradianceVolume.h"
+#include "Renderer/PerspectiveCamera.h"
 #include "Renderer/Primitive.h"
 #include "Renderer/RenderTarget.h"
 #include "Renderer/ResourceManager.h"
 #include "Renderer/ShadowMappingRenderPass.h"
 #include "Renderer/SSAORenderPass.h"
+#include "Renderer/TextureFeedbackRenderPass.h"
+#include "Renderer/TextureResidencyManager.h"
 #include "Renderer/TonemappingRenderPass.h"
 #include "Scene/DirectionalLight.h"
 #include "Scene/MeshBuilder.h"
@@ -20,18 +32,51 @@
 #include "Scene/Scene.h"
 #include "Scene/SceneNode.h"
 #include "Texture/Cubemap.h"
+#include "Texture/FloatPacking.h"
+#include "Texture/MipChain.h"
 #include "Texture/Texture2D.h"
+#include "Texture/Texture3D.h"
 #include "UniformBlockDataStructs.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <set>
 
+// shared with the offline baker, so its caches are picked up
+static constexpr IBLBaker::Settings IBL_SETTINGS = IBLBaker::Settings();
+static_assert(IBL_SETTINGS.specularMaxSamples <= MAX_PREFILTER_SAMPLES, "Prefilter samples exceed the uniform block");
+
+static constexpr int IBL_BRDF_RES = 512;
+static constexpr int IBL_BRDF_SAMPLES = 1024;
+
+// probes along the longest axis of the scene bounds
+static constexpr int PROBE_GRID_MAX = 8;
+static constexpr int PROBE_CAPTURE_RES = 32;
+static constexpr float PROBE_CAPTURE_NEAR = .05f;
+static constexpr int PROBES_PER_FRAME = 2;
+
+// baked asset, only regenerated if missing or outdated
+static const std::string IBL_BRDF_PATH = "Resources/Textures/IntegratedBRDF.srtex";
+
+static const glm::vec3 CUBE_FACE_DIR[] = {
+	glm::vec3( 1, 0, 0), glm::vec3(-1, 0, 0),
+	glm::vec3( 0, 1, 0), glm::vec3( 0,-1, 0),
+	glm::vec3( 0, 0, 1), glm::vec3( 0, 0,-1)
+};
+static const glm::vec3 CUBE_FACE_UP[] = {
+	glm::vec3( 0,-1, 0), glm::vec3( 0,-1, 0),
+	glm::vec3( 0, 0, 1), glm::vec3( 0, 0,-1),
+	glm::vec3( 0,-1, 0), glm::vec3( 0,-1, 0)
+};
+
 static const glm::mat4 CUBE_P = glm::perspective(glm::radians(90.f), 1.f, .1f, 10.f);
 static const glm::mat4 CUBE_FACE_VP[] = {
-	CUBE_P * glm::lookAt(glm::vec3(0,0,0), glm::vec3(1, 0, 0), glm::vec3(0,-1, 0)),
-	CUBE_P * glm::lookAt(glm::vec3(0,0,0), glm::vec3(-1, 0, 0), glm::vec3(0,-1, 0)),
-	CUBE_P * glm::lookAt(glm::vec3(0,0,0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1)),
-	CUBE_P * glm::lookAt(glm::vec3(0,0,0), glm::vec3(0,-1, 0), glm::vec3(0, 0,-1)),
-	CUBE_P * glm::lookAt(glm::vec3(0,0,0), glm::vec3(0, 0, 1), glm::vec3(0,-1, 0)),
-	CUBE_P * glm::lookAt(glm::vec3(0,0,0), glm::vec3(0, 0,-1), glm::vec3(0,-1, 0))
+	CUBE_P * glm::lookAt(glm::vec3(0), CUBE_FACE_DIR[0], CUBE_FACE_UP[0]),
+	CUBE_P * glm::lookAt(glm::vec3(0), CUBE_FACE_DIR[1], CUBE_FACE_UP[1]),
+	CUBE_P * glm::lookAt(glm::vec3(0), CUBE_FACE_DIR[2], CUBE_FACE_UP[2]),
+	CUBE_P * glm::lookAt(glm::vec3(0), CUBE_FACE_DIR[3], CUBE_FACE_UP[3]),
+	CUBE_P * glm::lookAt(glm::vec3(0), CUBE_FACE_DIR[4], CUBE_FACE_UP[4]),
+	CUBE_P * glm::lookAt(glm::vec3(0), CUBE_FACE_DIR[5], CUBE_FACE_UP[5])
 };
 
 RenderEngine::RenderEngine(GraphicsAPISPtr api, MaterialLibrarySPtr matlib)
@@ -41,9 +86,15 @@ RenderEngine::RenderEngine(GraphicsAPISPtr api, MaterialLibrarySPtr matlib)
 	, m_resources(new ResourceManager(api))
 	, m_cameraUniformBlock(new UniformBlockData<CameraUniformBlock>(0))
 	, m_lightsUniformBlock(new UniformBlockData<LightsUniformBlock>(1))
+	, m_environmentUniformBlock(new UniformBlockData<EnvironmentUniformBlock>(2))
+	, m_prefilterUniformBlock(new UniformBlockData<PrefilterUniformBlock>(3))
 {
 	api->allocate(m_cameraUniformBlock);
 	api->allocate(m_lightsUniformBlock);
+	api->allocate(m_environmentUniformBlock);
+	api->allocate(m_prefilterUniformBlock);
+
+	m_vertexLayerOutput = api->supportsVertexLayer();
 
 	for (auto& [name, program] : m_matlib->programs())
 	{
@@ -59,14 +110,17 @@ RenderEngine::RenderEngine(GraphicsAPISPtr api, MaterialLibrarySPtr matlib)
 		// bind uniform blocks to all programs who need it
 		program->bindUniformBlock("CameraUBO", m_cameraUniformBlock->bindingPoint());
 		program->bindUniformBlock("LightsUBO", m_lightsUniformBlock->bindingPoint());
+		program->bindUniformBlock("EnvironmentUBO", m_environmentUniformBlock->bindingPoint());
+		program->bindUniformBlock("PrefilterUBO", m_prefilterUniformBlock->bindingPoint());
 	}
 }
 
 RenderEngine::~RenderEngine()
 {
+	writeIrradianceVolumeCache();
 }
 
-void RenderEngine::setScene(SceneSPtr scene)
+void RenderEngine::setScene(SceneSPtr scene, const std::string& sourcePath)
 {
 	m_scene = scene;
 
@@ -76,6 +130,10 @@ void RenderEngine::setScene(SceneSPtr scene)
 		m_ibl = generateIBL(std::static_pointer_cast<Cubemap>(m_scene->sky()));
 	}
 
+	setupIrradianceVolume(sourcePath);
+
+	updateEnvironmentUniformData();
+
 	rebuildCommandList();
 }
 
@@ -99,6 +157,12 @@ void RenderEngine::render()
 	{
 		pass->render(*m_renderer);
 	}
+
+	// after the frame, the captures reuse its shadow maps
+	if (m_irradianceVolume && !m_irradianceVolume->isComplete())
+	{
+		bakeIrradianceProbes(PROBES_PER_FRAME);
+	}
 }
 
 void RenderEngine::update(double deltaTime)
@@ -121,6 +185,11 @@ void RenderEngine::update(double deltaTime)
 		pass->update(deltaTime);
 	}
 
+	if (m_textureResidency)
+	{
+		m_textureResidency->update();
+	}
+
 	updateLightsUniformData();
 	updateCameraUniformData(m_mainCamera);
 }
@@ -168,34 +237,57 @@ void RenderEngine::rebuildCommandList()
 		std::vector<IDrawableSPtr> transparentGeometry;
 
 		std::set<ShaderProgramSPtr> usedPrograms;
-		auto t = m_scene->traverser();
-		while (t.hasNext())
+		for (IDrawableSPtr drawable : m_scene->drawables())
 		{
-			IDrawableSPtr drawable = t.next();
-			if (drawable->geometry() && drawable->material())
+			if (drawable->material()->layer() == Material::Layer::Transparent)
 			{
-				if (drawable->material()->layer() == Material::Layer::Transparent)
-				{
-					transparentGeometry.push_back(drawable);
-				}
-				else
-				{
-					opaqueGeometry.push_back(drawable);
-				}
-
-				usedPrograms.insert(drawable->material()->program());
+				transparentGeometry.push_back(drawable);
+			}
+			else
+			{
+				opaqueGeometry.push_back(drawable);
 			}
+
+			usedPrograms.insert(drawable->material()->program());
 		}
 
+		// draw repeated geometry with a shared material in a single call,
+		// transparent geometry stays unbatched
+		opaqueGeometry = InstanceBatch::build(opaqueGeometry, m_resources);
+
 		for (ShaderProgramSPtr program : usedPrograms)
 		{
 			// set IBL
-			if (m_ibl.brdf && m_ibl.specular && m_ibl.diffuse)
+			if (m_ibl.brdf && m_ibl.specular)
 			{
 				program->setUniformDefault("brdfLUT", m_ibl.brdf);
 				program->setUniformDefault("prefilterMap", m_ibl.specular);
+			}
+			if (m_ibl.diffuse)
+			{
 				program->setUniformDefault("irradianceMap", m_ibl.diffuse);
 			}
+			if (m_irradianceVolume)
+			{
+				program->setUniformDefault("irradianceVolume", m_irradianceVolume->texture());
+			}
+		}
+
+		/*
+		 * PROBE CAPTURE
+		 */
+		m_probeCapturePasses.clear();
+		if (m_probeTarget)
+		{
+			GeometryRenderPass::Data captureData;
+			captureData.name = "Probe Capture";
+			captureData.target = m_probeTarget;
+			captureData.state.clearColor = true;
+			captureData.state.color = glm::vec4_black;
+			captureData.drawables = opaqueGeometry;
+
+			m_probeCapturePasses.emplace_back(
+				new GeometryRenderPass(m_resources, m_matlib, captureData));
 		}
 
 		/*
@@ -219,6 +311,21 @@ void RenderEngine::rebuildCommandList()
 				new GeometryRenderPass(m_resources, m_matlib, preDepthPassData));
 		}
 
+		/*
+		 * TEXTURE FEEDBACK
+		 */
+		if (m_textureResidency)
+		{
+			std::vector<IDrawableSPtr> feedbackGeometry = opaqueGeometry;
+			feedbackGeometry.insert(feedbackGeometry.end(), 
+				transparentGeometry.begin(), transparentGeometry.end());
+
+			TextureFeedbackRenderPassSPtr feedbackPass = std::make_shared<TextureFeedbackRenderPass>(
+				m_resources, m_matlib, m_textureResidency);
+			feedbackPass->setup(m_colorBuffer, feedbackGeometry);
+			m_renderPassList.push_back(feedbackPass);
+		}
+
 		/*
 		 * SHADOW MAPPING
 		 */
@@ -270,6 +377,15 @@ void RenderEngine::rebuildCommandList()
 
 				m_renderPassList.emplace_back(
 					new GeometryRenderPass(m_resources, m_matlib, cmd2));
+
+				if (m_probeTarget)
+				{
+					cmd2.name = "Probe Capture Skybox";
+					cmd2.target = m_probeTarget;
+
+					m_probeCapturePasses.emplace_back(
+						new GeometryRenderPass(m_resources, m_matlib, cmd2));
+				}
 			}			
 		}
 
@@ -370,6 +486,13 @@ void RenderEngine::setupGizmos(const std::string& programName)
 	rebuildCommandList();
 }
 
+void RenderEngine::setTextureResidency(TextureResidencyManagerSPtr residency)
+{
+	m_textureResidency = residency;
+
+	rebuildCommandList();
+}
+
 void RenderEngine::setupPostProcessing()
 {
 	if (!m_colorBuffer)
@@ -412,6 +535,11 @@ const std::vector<IRenderPassSPtr>& RenderEngine::renderPasses() const
 	return m_renderPassList;
 }
 
+IrradianceVolumeSPtr RenderEngine::irradianceVolume() const
+{
+	return m_irradianceVolume;
+}
+
 void RenderEngine::updateCameraUniformData(CameraSPtr camera)
 {
 	if (!camera)
@@ -488,6 +616,294 @@ void RenderEngine::updateLightsUniformData()
 	m_lightsUniformBlock->update(data);
 }
 
+void RenderEngine::updateEnvironmentUniformData(bool sampleIrradianceVolume)
+{
+	EnvironmentUniformBlock data = EnvironmentUniformBlock();
+	for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; ++i)
+	{
+		data.irradianceSH[i] = m_scene && m_scene->sky() ? 
+			glm::vec4(m_ibl.irradianceSH[i], 0) : glm::vec4(0);
+	}
+
+	if (m_irradianceVolume)
+	{
+		const BoundingBox& bounds = m_irradianceVolume->bounds();
+		data.volumeMin = glm::vec4(bounds.min(), sampleIrradianceVolume ? 1 : 0);
+		data.volumeMax = glm::vec4(bounds.max(), 0);
+		data.volumeResolution = glm::vec4(glm::vec3(m_irradianceVolume->resolution()), 0);
+	}
+
+	m_environmentUniformBlock->update(data);
+}
+
+void RenderEngine::setupIrradianceVolume(const std::string& scenePath)
+{
+	// progress of the previous scene
+	writeIrradianceVolumeCache();
+
+	m_irradianceVolume.reset();
+	m_irradianceVolumeCachePath.clear();
+	m_irradianceVolumeCachedCount = 0;
+	m_probeCapture.reset();
+	m_probeTarget.reset();
+	m_probeCamera.reset();
+	m_probeCapturePasses.clear();
+
+	// only baked while a program samples it
+	const auto& programs = m_matlib->programs();
+	const bool sampleVolume = std::any_of(programs.begin(), programs.end(), [](const auto& entry) {
+		return entry.second->hasUniform("irradianceVolume");
+	});
+
+	const BoundingBox bounds = m_scene->sceneBounds();
+	if (!sampleVolume || bounds.empty())
+	{
+		return;
+	}
+
+	IrradianceVolumeSPtr volume = std::make_shared<IrradianceVolume>(
+		bounds, IrradianceVolume::resolutionFor(bounds, PROBE_GRID_MAX));
+
+	// unbaked probes fall back to the sky
+	SphericalHarmonics::Coefficients fallback;
+	fallback.fill(glm::vec3(0.f));
+	if (m_scene->sky())
+	{
+		fallback = m_ibl.irradianceSH;
+	}
+	volume->reset(fallback);
+
+	if (!m_api->allocate(volume->texture()))
+	{
+		return;
+	}
+
+	// the captures also see the sky
+	uint64_t key = m_scene->contentHash();
+	key = Hash::combine(key, volume->resolution());
+	key = Hash::combine(key, PROBE_CAPTURE_RES);
+	key = Hash::combine(key, fallback);
+
+	if (!scenePath.empty())
+	{
+		m_irradianceVolumeCachePath = IrradianceVolumeCache::cachePath(scenePath);
+		if (IrradianceVolumeCache::read(m_irradianceVolumeCachePath, key, *volume))
+		{
+			Logger::Info("Loaded %i of %i irradiance probes from cache: %s",
+				volume->bakedCount(), volume->probeCount(), m_irradianceVolumeCachePath.c_str());
+		}
+		else
+		{
+			volume->reset(fallback);
+		}
+	}
+
+	m_irradianceVolume = volume;
+	m_irradianceVolumeKey = key;
+	m_irradianceVolumeCachedCount = volume->bakedCount();
+	m_irradianceVolume->updateTexture();
+
+	if (m_irradianceVolume->isComplete())
+	{
+		return;
+	}
+
+	// the scene is rendered into one face at a time
+	TextureSampler sampler;
+	sampler.wrap = TextureWrap::ClampToEdge;
+	sampler.mipmapping = false;
+	m_probeCapture = std::make_shared<Cubemap>(PROBE_CAPTURE_RES, TextureFormat::RGBHalf, sampler);
+
+	m_probeTarget = std::make_shared<RenderTarget>(m_probeCapture, DepthBufferFormat::Depth24);
+	m_probeTarget->setLayer(0);
+	if (!m_api->allocate(m_probeTarget))
+	{
+		m_probeTarget.reset();
+		return;
+	}
+
+	const float far = glm::length(bounds.size()) * 2.f;
+	m_probeCamera = std::make_shared<PerspectiveCamera>(PROBE_CAPTURE_RES, PROBE_CAPTURE_RES, 
+		90.f, PROBE_CAPTURE_NEAR, std::max(far, PROBE_CAPTURE_NEAR * 2.f));
+}
+
+void RenderEngine::bakeIrradianceProbes(int count)
+{
+	if (!m_irradianceVolume || m_probeCapturePasses.empty())
+	{
+		return;
+	}
+
+	// captures only see direct and sky lighting, independent of the bake order
+	updateEnvironmentUniformData(false);
+
+	bool failed = false;
+	for (int i = 0; i < count; ++i)
+	{
+		const int index = m_irradianceVolume->nextUnbaked();
+		if (index < 0)
+		{
+			break;
+		}
+
+		SphericalHarmonics::Coefficients coefficients;
+		if (!captureProbe(m_irradianceVolume->probePosition(index), coefficients))
+		{
+			Logger::Warning("Could not capture irradiance probe %i.", index);
+			failed = true;
+			break;
+		}
+		m_irradianceVolume->setProbe(index, coefficients);
+	}
+
+	m_irradianceVolume->updateTexture();
+
+	updateEnvironmentUniformData();
+	updateCameraUniformData(m_mainCamera);
+
+	if (m_irradianceVolume->isComplete() || failed)
+	{
+		if (!failed)
+		{
+			Logger::Info("Baked %i irradiance probes.", m_irradianceVolume->probeCount());
+		}
+
+		writeIrradianceVolumeCache();
+
+		m_probeCapturePasses.clear();
+		m_probeTarget.reset();
+		m_probeCapture.reset();
+		m_probeCamera.reset();
+	}
+}
+
+bool RenderEngine::captureProbe(const glm::vec3& position, SphericalHarmonics::Coefficients& outCoefficients)
+{
+	for (int face = 0; face < 6; ++face)
+	{
+		m_probeCamera->lookAt(position, position + CUBE_FACE_DIR[face], CUBE_FACE_UP[face]);
+		updateCameraUniformData(m_probeCamera);
+
+		m_probeTarget->setLayer(face);
+		for (const auto& pass : m_probeCapturePasses)
+		{
+			pass->render(*m_renderer);
+		}
+	}
+
+	std::vector<uint8_t> pixels;
+	if (!m_api->download(m_probeCapture, 0, pixels))
+	{
+		return false;
+	}
+
+	std::vector<float> faces(pixels.size() / sizeof(uint16_t));
+	FloatPacking::fromHalf(reinterpret_cast<const uint16_t*>(pixels.data()), faces.data(), faces.size());
+
+	outCoefficients = SphericalHarmonics::convolveIrradiance(
+		SphericalHarmonics::projectCubemap(faces.data(), m_probeCapture->width()));
+
+	return true;
+}
+
+void RenderEngine::writeIrradianceVolumeCache()
+{
+	if (!m_irradianceVolume || m_irradianceVolumeCachePath.empty())
+	{
+		return;
+	}
+
+	const int bakedCount = m_irradianceVolume->bakedCount();
+	if (bakedCount != m_irradianceVolumeCachedCount &&
+		IrradianceVolumeCache::write(m_irradianceVolumeCachePath, m_irradianceVolumeKey, *m_irradianceVolume))
+	{
+		m_irradianceVolumeCachedCount = bakedCount;
+	}
+}
+
+static bool uploadLevels(GraphicsAPI& api, CubemapSPtr cubemap, const IBLCache::CubemapLevels& levels)
+{
+	if (levels.format != cubemap->format() ||
+		levels.width != cubemap->width() ||
+		levels.levelCount != cubemap->levelCount() ||
+		!api.allocate(cubemap))
+	{
+		return false;
+	}
+
+	for (int level = 0; level < levels.levelCount; ++level)
+	{
+		cubemap->updateLevel(level, levels.pixels.data() + levels.offset(level));
+	}
+
+	return true;
+}
+
+static bool downloadLevels(GraphicsAPI& api, CubemapSPtr cubemap, IBLCache::CubemapLevels& outLevels)
+{
+	outLevels.format = cubemap->format();
+	outLevels.width = cubemap->width();
+	outLevels.levelCount = cubemap->levelCount();
+	outLevels.pixels.clear();
+
+	std::vector<uint8_t> pixels;
+	for (int level = 0; level < outLevels.levelCount; ++level)
+	{
+		if (!api.download(cubemap, level, pixels))
+		{
+			return false;
+		}
+		outLevels.pixels.insert(outLevels.pixels.end(), pixels.begin(), pixels.end());
+	}
+
+	return true;
+}
+
+// tightly packed RGB floats of half or float pixels
+static bool toFloatPixels(TextureFormat format, const std::vector<uint8_t>& pixels, std::vector<float>& outPixels)
+{
+	switch (format)
+	{
+	case TextureFormat::RGBHalf:
+		outPixels.resize(pixels.size() / sizeof(uint16_t));
+		FloatPacking::fromHalf(reinterpret_cast<const uint16_t*>(pixels.data()), outPixels.data(), outPixels.size());
+		return true;
+	case TextureFormat::RGBFloat:
+		outPixels.resize(pixels.size() / sizeof(float));
+		std::memcpy(outPixels.data(), pixels.data(), outPixels.size() * sizeof(float));
+		return true;
+	default:
+		return false;
+	}
+}
+
+void RenderEngine::setCPUPrecomputation(bool enabled)
+{
+	m_cpuPrecomputation = enabled;
+}
+
+MaterialSPtr RenderEngine::instanciateCubemapMaterial(const std::string& programName) const
+{
+	if (m_vertexLayerOutput)
+	{
+		MaterialSPtr layered = m_matlib->instanciate(programName + ".Layered");
+		if (layered && layered->program()->hasUniform("_layerCount"))
+		{
+			return layered;
+		}
+	}
+
+	return m_matlib->instanciate(programName);
+}
+
+void RenderEngine::renderCubemapFaces(IGeometrySPtr geometry, MaterialSPtr material)
+{
+	// the geometry shader variant amplifies to six layers itself
+	const unsigned int layerCount = material->program()->hasUniform("_layerCount") ? 6 : 1;
+
+	m_renderer->render(geometry, material, 1, layerCount);
+}
+
 void RenderEngine::projectEquirectangularToCubemap(Texture2DSPtr source, CubemapSPtr target)
 {
 	if (source->width() != source->height() * 2)
@@ -495,6 +911,21 @@ void RenderEngine::projectEquirectangularToCubemap(Texture2DSPtr source, Cubemap
 		throw std::invalid_argument("Invalid texture dimension for LongLat map.");
 	}
 
+	if (m_cpuPrecomputation)
+	{
+		std::vector<uint8_t> pixels;
+		std::vector<float> image;
+		if (m_api->download(source, 0, pixels) &&
+			toFloatPixels(source->format(), pixels, image) &&
+			uploadLevels(*m_api, target, IBLBaker::projectEquirectangular(image.data(), 
+				source->width(), source->height(), target->width(), target->levelCount(), target->format())))
+		{
+			return;
+		}
+
+		Logger::Warning("Unsupported format for the CPU projection, rendered instead.");
+	}
+
 	RenderTargetSPtr rt = std::make_shared<RenderTarget>(target);
 	if (!m_api->allocate(rt))
 	{
@@ -508,7 +939,7 @@ void RenderEngine::projectEquirectangularToCubemap(Texture2DSPtr source, Cubemap
 		return;
 	}
 
-	MaterialSPtr projectionMat = m_matlib->instanciate("Util.ProjectEqr2Cube");
+	MaterialSPtr projectionMat = instanciateCubemapMaterial("Util.ProjectEqr2Cube");
 	if (!projectionMat)
 	{
 		return;
@@ -533,36 +964,240 @@ void RenderEngine::projectEquirectangularToCubemap(Texture2DSPtr source, Cubemap
 
 	m_renderer->setTarget(rt);
 	m_renderer->applyState(state);
-	m_renderer->render(cubeGeom, projectionMat);
+	renderCubemapFaces(cubeGeom, projectionMat);
 	m_renderer->regenerateMipmaps(target);
 }
 
-IBLData RenderEngine::generateIBL(CubemapSPtr hdri)
+IBLData RenderEngine::generateIBL(CubemapSPtr hdri, const std::string& sourcePath)
 {
-	const int diffuseRes = 32;
-	const int specularRes = 128;
-	const int brdfRes = 512;
+	const auto& found = m_iblCache.find(hdri);
+	if (found != m_iblCache.end())
+	{
+		return found->second;
+	}
 
 	IBLData ibl;
 
 	TextureSampler sampler;
 	sampler.wrap = TextureWrap::ClampToEdge;
 	sampler.mipmapping = true;
-	ibl.specular = std::make_shared<Cubemap>(specularRes, TextureFormat::RGBHalf, sampler);
+	ibl.specular = std::make_shared<Cubemap>(IBL_SETTINGS.specularWidth, TextureFormat::RGBHalf, sampler);
 
 	sampler.mipmapping = false;
-	ibl.diffuse = std::make_shared<Cubemap>(diffuseRes, TextureFormat::RGBHalf, sampler);
-	ibl.brdf = std::make_shared<Texture2D>(brdfRes, brdfRes, TextureFormat::RGHalf, sampler);
 
-	hdriToDiffuseIrradiance(hdri, ibl.diffuse);
-	hdriToSpecularIrradiance(hdri, ibl.specular);
-	generateIntegratedBRDF(ibl.brdf);
+	// the cubemap is only convolved while a program still samples it,
+	// the spherical harmonics replace it otherwise
+	const auto& programs = m_matlib->programs();
+	const bool sampleDiffuse = std::any_of(programs.begin(), programs.end(), [](const auto& entry) {
+		return entry.second->hasUniform("irradianceMap");
+	});
+	if (sampleDiffuse)
+	{
+		ibl.diffuse = std::make_shared<Cubemap>(IBL_SETTINGS.diffuseWidth, TextureFormat::RGBHalf, sampler);
+	}
+
+	// independent of the environment, shared by all of them
+	if (!m_integratedBRDF)
+	{
+		m_integratedBRDF = std::make_shared<Texture2D>(
+			IBL_BRDF_RES, IBL_BRDF_RES, TextureFormat::RGHalf, sampler);
+		loadIntegratedBRDF(m_integratedBRDF);
+	}
+	ibl.brdf = m_integratedBRDF;
+
+	// keyed by the image content and everything the precomputation depends on
+	uint64_t key = 0;
+	if (!sourcePath.empty())
+	{
+		const MappedFile source(sourcePath);
+		if (source.isValid())
+		{
+			key = IBLBaker::cacheKey(Hash::content(source.data(), source.size()), 
+				hdri->width(), IBL_SETTINGS);
+		}
+	}
+
+	const std::string cachePath = IBLCache::cachePath(sourcePath);
+
+	IBLCache::CubemapLevels diffuse;
+	IBLCache::CubemapLevels specular;
+	if (key != 0 && 
+		IBLCache::read(cachePath, key, diffuse, specular, ibl.irradianceSH) &&
+		(!ibl.diffuse || uploadLevels(*m_api, ibl.diffuse, diffuse)) &&
+		uploadLevels(*m_api, ibl.specular, specular))
+	{
+		Logger::Info("Loaded image based lighting from cache: %s", cachePath.c_str());
+	}
+	else
+	{
+		ibl.irradianceSH = hdriToIrradianceSH(hdri);
+		if (ibl.diffuse)
+		{
+			hdriToDiffuseIrradiance(hdri, ibl.diffuse);
+		}
+		hdriToSpecularIrradiance(hdri, ibl.specular);
+
+		diffuse = IBLCache::CubemapLevels();
+		if (key != 0 &&
+			(!ibl.diffuse || downloadLevels(*m_api, ibl.diffuse, diffuse)) &&
+			downloadLevels(*m_api, ibl.specular, specular))
+		{
+			IBLCache::write(cachePath, key, diffuse, specular, ibl.irradianceSH);
+		}
+	}
+
+	m_iblCache[hdri] = ibl;
 
 	return ibl;
 }
 
+// sum of the absolute differences relative to the sum of the reference
+static float relativeError(const float* values, const float* reference, size_t count)
+{
+	double difference = 0.0;
+	double magnitude = 0.0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		difference += std::abs(values[i] - reference[i]);
+		magnitude += std::abs(reference[i]);
+	}
+	return magnitude > 0.0 ? static_cast<float>(difference / magnitude) : static_cast<float>(difference);
+}
+
+static bool compareLevels(const std::string& name, const IBLCache::CubemapLevels& gpu, 
+	const IBLCache::CubemapLevels& cpu, float tolerance)
+{
+	const std::vector<float> gpuPixels = IBLBaker::toFloat(gpu);
+	const std::vector<float> cpuPixels = IBLBaker::toFloat(cpu);
+	if (gpuPixels.empty() || gpuPixels.size() != cpuPixels.size())
+	{
+		Logger::Error("IBL check %s: layouts differ", name.c_str());
+		return false;
+	}
+
+	bool matching = true;
+	size_t offset = 0;
+	for (int level = 0; level < gpu.levelCount; ++level)
+	{
+		const size_t count = gpu.levelSize(level) / (gpu.format == TextureFormat::RGBHalf ? sizeof(uint16_t) : sizeof(float));
+		const float error = relativeError(cpuPixels.data() + offset, gpuPixels.data() + offset, count);
+		offset += count;
+
+		if (error > tolerance)
+		{
+			Logger::Warning("IBL check %s level %i: %.4f mean relative error", name.c_str(), level, error);
+			matching = false;
+		}
+		else
+		{
+			Logger::Info("IBL check %s level %i: %.4f mean relative error", name.c_str(), level, error);
+		}
+	}
+	return matching;
+}
+
+bool RenderEngine::verifyCPUPrecomputation(Texture2DSPtr equirectangular, float tolerance)
+{
+	std::vector<uint8_t> pixels;
+	std::vector<float> image;
+	if (!m_api->download(equirectangular, 0, pixels) ||
+		!toFloatPixels(equirectangular->format(), pixels, image))
+	{
+		Logger::Error("IBL check: unsupported environment map format");
+		return false;
+	}
+
+	const IBLBaker::Result cpu = IBLBaker::bake(image.data(), 
+		equirectangular->width(), equirectangular->height(), IBL_SETTINGS);
+
+	// rendered like the sky of the SceneImporter, without the disk cache
+	const bool cpuPrecomputation = m_cpuPrecomputation;
+	m_cpuPrecomputation = false;
+
+	TextureSampler sampler = { TextureFilter::Linear, TextureWrap::ClampToEdge, true, glm::vec4(0,0,0,0) };
+	CubemapSPtr environment = std::make_shared<Cubemap>(
+		equirectangular->height() / 2, TextureFormat::RGBHalf, sampler);
+	projectEquirectangularToCubemap(equirectangular, environment);
+	const IBLData gpu = generateIBL(environment);
+
+	m_cpuPrecomputation = cpuPrecomputation;
+
+	IBLCache::CubemapLevels gpuDiffuse;
+	IBLCache::CubemapLevels gpuSpecular;
+	bool matching = downloadLevels(*m_api, gpu.specular, gpuSpecular) &&
+		compareLevels("specular", gpuSpecular, cpu.specular, tolerance);
+
+	// only generated while a program samples it
+	if (gpu.diffuse)
+	{
+		matching = downloadLevels(*m_api, gpu.diffuse, gpuDiffuse) &&
+			compareLevels("diffuse", gpuDiffuse, cpu.diffuse, tolerance) && matching;
+	}
+
+	std::vector<float> cpuSH;
+	std::vector<float> gpuSH;
+	for (int c = 0; c < SphericalHarmonics::COEFFICIENT_COUNT; ++c)
+	{
+		cpuSH.insert(cpuSH.end(), { cpu.irradianceSH[c].x, cpu.irradianceSH[c].y, cpu.irradianceSH[c].z });
+		gpuSH.insert(gpuSH.end(), { gpu.irradianceSH[c].x, gpu.irradianceSH[c].y, gpu.irradianceSH[c].z });
+	}
+	const float shError = relativeError(cpuSH.data(), gpuSH.data(), cpuSH.size());
+	if (shError > tolerance)
+	{
+		Logger::Warning("IBL check spherical harmonics: %.4f mean relative error", shError);
+		return false;
+	}
+
+	Logger::Info("IBL check spherical harmonics: %.4f mean relative error", shError);
+	return matching;
+}
+
+void RenderEngine::loadIntegratedBRDF(Texture2DSPtr integratedBRDF)
+{
+	const uint64_t key = Hash::combine(Hash::combine(Hash::FNV_OFFSET, IBL_BRDF_RES), IBL_BRDF_SAMPLES);
+
+	MipChainUPtr baked = TextureCache::read(IBL_BRDF_PATH, key, 0);
+	if (baked && 
+		baked->format() == integratedBRDF->format() &&
+		baked->width() == integratedBRDF->width() &&
+		baked->height() == integratedBRDF->height())
+	{
+		// read in place from the mapping
+		const MipChain& levels = *baked;
+		if (m_api->allocate(integratedBRDF, levels.data(0)))
+		{
+			return;
+		}
+	}
+
+	Logger::Info("Generate integrated BRDF: %s", IBL_BRDF_PATH.c_str());
+
+	generateIntegratedBRDF(integratedBRDF);
+
+	std::vector<uint8_t> pixels;
+	if (m_api->download(integratedBRDF, 0, pixels))
+	{
+		MipChain levels(integratedBRDF->format(), integratedBRDF->width(), integratedBRDF->height(), false);
+		std::copy(pixels.begin(), pixels.end(), levels.data());
+		TextureCache::write(IBL_BRDF_PATH, key, 0, levels);
+	}
+}
+
 void RenderEngine::hdriToDiffuseIrradiance(CubemapSPtr hdri, CubemapSPtr diffIrradiance)
 {
+	if (m_cpuPrecomputation)
+	{
+		IBLCache::CubemapLevels source;
+		if (downloadLevels(*m_api, hdri, source) &&
+			uploadLevels(*m_api, diffIrradiance, IBLBaker::diffuseIrradiance(source, 
+				diffIrradiance->width(), IBL_SETTINGS.diffuseSampleDelta, diffIrradiance->format())))
+		{
+			return;
+		}
+
+		Logger::Warning("Unsupported format for the CPU diffuse convolution, rendered instead.");
+	}
+
 	RenderTargetSPtr rt = std::make_shared<RenderTarget>(diffIrradiance);
 	if (!m_api->allocate(rt))
 	{
@@ -576,36 +1211,88 @@ void RenderEngine::hdriToDiffuseIrradiance(CubemapSPtr hdri, CubemapSPtr diffIrr
 		return;
 	}
 
-	MaterialSPtr mat = m_matlib->instanciate("Util.IBLDiffuse");
+	MaterialSPtr mat = instanciateCubemapMaterial("Util.IBLDiffuse");
 	if (!mat)
 	{
 		return;
 	}
 
 	mat->setUniform("hdri", hdri);
+	mat->setUniform("sampleDelta", IBL_SETTINGS.diffuseSampleDelta);
 
 	for (int i = 0; i < 6; ++i)
 	{
 		mat->setUniform("VP", CUBE_FACE_VP[i], i);
 	}
 
-	GeometryRenderPass::Data cmd;
-	cmd.name = "HDRI2DiffuseIrradiance";
-	cmd.target = rt;
-	cmd.drawables.emplace_back(new Primitive(cubeGeom, mat));
+	RendererState state;
+	state.cullingMode = Culling::Front;
+	state.depthTestMode = DepthTest::None;
+	state.writeDepth = false;
+	state.clearDepth = false;
+	state.seamlessCubemapFiltering = true;
 
-	cmd.state.cullingMode = Culling::Front;
-	cmd.state.depthTestMode = DepthTest::None;
-	cmd.state.writeDepth = false;
-	cmd.state.clearDepth = false;
-	cmd.state.seamlessCubemapFiltering = true;
+	m_renderer->setTarget(rt);
+	m_renderer->applyState(state);
+	renderCubemapFaces(cubeGeom, mat);
+}
+
+SphericalHarmonics::Coefficients RenderEngine::hdriToIrradianceSH(CubemapSPtr hdri)
+{
+	SphericalHarmonics::Coefficients result;
+	result.fill(glm::vec3(0.f));
+
+	// projected from the read back cubemap of the equirectangular 
+	// projection, not from the HDRI itself, so that GPU pass remains
+	// L2 only holds low frequencies, a downsampled level is enough
+	int level = 0;
+	while ((hdri->width() >> level) > IBL_SETTINGS.shWidth && level + 1 < hdri->levelCount())
+	{
+		++level;
+	}
 
-	const auto pass = GeometryRenderPass(m_resources, m_matlib, cmd);
-	pass.render(*m_renderer);
+	std::vector<uint8_t> pixels;
+	if (!m_api->download(hdri, level, pixels))
+	{
+		Logger::Warning("Could not read back the environment map.");
+		return result;
+	}
+
+	const int width = std::max(1, hdri->width() >> level);
+	std::vector<float> faces(static_cast<size_t>(width) * width * 6 * 3);
+	switch (hdri->format())
+	{
+	case TextureFormat::RGBHalf:
+		FloatPacking::fromHalf(reinterpret_cast<const uint16_t*>(pixels.data()), faces.data(), faces.size());
+		break;
+	case TextureFormat::RGBFloat:
+		std::memcpy(faces.data(), pixels.data(), faces.size() * sizeof(float));
+		break;
+	default:
+		Logger::Warning("Unsupported environment map format for spherical harmonics.");
+		return result;
+	}
+
+	return SphericalHarmonics::convolveIrradiance(
+		SphericalHarmonics::projectCubemap(faces.data(), width));
 }
 
 void RenderEngine::hdriToSpecularIrradiance(CubemapSPtr hdri, CubemapSPtr specIrradiance)
 {
+	if (m_cpuPrecomputation)
+	{
+		IBLCache::CubemapLevels source;
+		if (downloadLevels(*m_api, hdri, source) &&
+			uploadLevels(*m_api, specIrradiance, IBLBaker::specularIrradiance(source, 
+				specIrradiance->width(), specIrradiance->levelCount(), 
+				IBL_SETTINGS.specularMinSamples, IBL_SETTINGS.specularMaxSamples, specIrradiance->format())))
+		{
+			return;
+		}
+
+		Logger::Warning("Unsupported format for the CPU specular prefilter, rendered instead.");
+	}
+
 	IGeometrySPtr cubeGeom = MeshBuilder::cube();
 	if (!m_api->allocate(cubeGeom))
 	{
@@ -613,14 +1300,13 @@ void RenderEngine::hdriToSpecularIrradiance(CubemapSPtr hdri, CubemapSPtr specIr
 		return;
 	}
 
-	MaterialSPtr mat = m_matlib->instanciate("Util.IBLSpecular");
+	MaterialSPtr mat = instanciateCubemapMaterial("Util.IBLSpecular");
 	if (!mat)
 	{
 		return;
 	}
 
 	mat->setUniform("hdri", hdri);
-	mat->setUniform("resolution", static_cast<float>(hdri->width()));
 
 	for (int i = 0; i < 6; ++i)
 	{
@@ -635,70 +1321,63 @@ void RenderEngine::hdriToSpecularIrradiance(CubemapSPtr hdri, CubemapSPtr specIr
 	state.seamlessCubemapFiltering = true;
 	m_renderer->applyState(state);
 
+	// one framebuffer, reattached per level
+	RenderTargetSPtr rt = std::make_shared<RenderTarget>(specIrradiance);
+	if (!m_api->allocate(rt))
+	{
+		return;
+	}
+
 	// --- render ----
-	const unsigned int resolution = specIrradiance->width();
-	unsigned int maxMipLevels = static_cast<unsigned int>(std::ceil(std::log2(specIrradiance->width())));
-	for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
+	// same roughness and sample counts as the CPU prefilter
+	for (int mip = 0; mip < specIrradiance->levelCount(); ++mip)
 	{	
-		float roughness = static_cast<float>(mip) / static_cast<float>(maxMipLevels - 1);
-		mat->setUniform("roughness", roughness);
+		const auto samples = ImportanceSampling::prefilterSamples(
+			IBLBaker::specularRoughness(mip, specIrradiance->width()),
+			IBLBaker::specularSampleCount(mip, IBL_SETTINGS.specularMinSamples, IBL_SETTINGS.specularMaxSamples),
+			hdri->width(), hdri->levelCount());
 
-		RenderTargetSPtr rt = std::make_shared<RenderTarget>(specIrradiance, nullptr, mip);
-		if (!m_api->allocate(rt))
-		{
-			return;
-		}
+		PrefilterUniformBlock data = PrefilterUniformBlock();
+		data.sampleCount = static_cast<int>(std::min(samples.size(), static_cast<size_t>(MAX_PREFILTER_SAMPLES)));
+		std::copy_n(samples.begin(), data.sampleCount, data.samples);
+		m_prefilterUniformBlock->update(data);
+
+		rt->setLevel(mip);
 		
 		m_renderer->setTarget(rt);
-		m_renderer->render(cubeGeom, mat);
+		renderCubemapFaces(cubeGeom, mat);
 	}
 }
 
 void RenderEngine::generateIntegratedBRDF(Texture2DSPtr integratedBRDF)
 {
-	RenderTargetSPtr rt = std::make_shared<RenderTarget>(integratedBRDF);
-	if (!m_api->allocate(rt))
+	if (m_cpuPrecomputation)
 	{
-		return;
-	}
+		MipChainUPtr lut = IBLBaker::integrateBRDF(
+			integratedBRDF->width(), IBL_BRDF_SAMPLES, integratedBRDF->format());
+		if (lut && m_api->allocate(integratedBRDF, lut->data()))
+		{
+			return;
+		}
 
-	MaterialSPtr brdfMat = m_matlib->instanciate("Util.IntegratedBRDF");
-	if (!brdfMat)
-	{
-		return;
+		Logger::Warning("Unsupported format for the CPU BRDF integration, rendered instead.");
 	}
 
-	m_renderer->setTarget(rt);
-	m_renderer->applyState(RendererState::Blit());
-	m_renderer->render(m_resources->fullscreenGeometry(), brdfMat);
-}
-
-void RenderEngine::packTextures(
-	Texture2DSPtr target, 
-	Texture2DSPtr sourceRed, 
-	Texture2DSPtr sourceGreen, 
-	Texture2DSPtr sourceBlue, 
-	Texture2DSPtr sourceAlpha)
-{
-	RenderTargetSPtr rt = std::make_shared<RenderTarget>(target);
+	RenderTargetSPtr rt = std::make_shared<RenderTarget>(integratedBRDF);
 	if (!m_api->allocate(rt))
 	{
 		return;
 	}
 
-	MaterialSPtr mat = m_matlib->instanciate("Util.CombineChannels");
-	if (!mat)
+	MaterialSPtr brdfMat = m_matlib->instanciate("Util.IntegratedBRDF");
+	if (!brdfMat)
 	{
 		return;
 	}
 
-	mat->setUniform("redChannel", sourceRed);
-	mat->setUniform("greenChannel", sourceGreen);
-	mat->setUniform("blueChannel", sourceBlue);
-	mat->setUniform("alphaChannel", sourceAlpha);
+	brdfMat->setUniform("sampleCount", IBL_BRDF_SAMPLES);
 
 	m_renderer->setTarget(rt);
 	m_renderer->applyState(RendererState::Blit());
-	m_renderer->render(m_resources->fullscreenGeometry(), mat);
-	m_renderer->regenerateMipmaps(target);
+	m_renderer->render(m_resources->fullscreenGeometry(), brdfMat);
 }
@@ -77,6 +77,29 @@ int RenderTarget::level() const
 	return m_level;
 }
 
+void RenderTarget::setLevel(int level)
+{
+	if (m_linkedResource && m_level != level)
+	{
+		m_linkedResource->setLevel(level);
+	}
+	m_level = level;
+}
+
+int RenderTarget::layer() const
+{
+	return m_layer;
+}
+
+void RenderTarget::setLayer(int layer)
+{
+	if (m_linkedResource && m_layer != layer)
+	{
+		m_linkedResource->setLayer(layer);
+	}
+	m_layer = layer;
+}
+
 SharedResource::Handle RenderTarget::handle() const
 {
 	if (m_linkedResource)
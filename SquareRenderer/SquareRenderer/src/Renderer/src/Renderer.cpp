@@ -100,9 +100,10 @@ inline GLenum translate(DrawBuffer drawBuffer)
     }
 }
 
-void RenderVisitor::prepare(const Material& mat)
+void RenderVisitor::prepare(const Material& mat, unsigned int instanceCount)
 { 
     m_tesselate = mat.program()->supportsTesselation();
+    m_instanceCount = instanceCount;
 }
 
 void RenderVisitor::visit(Mesh& mesh)
@@ -111,25 +112,45 @@ void RenderVisitor::visit(Mesh& mesh)
 
     const GLenum mode = m_tesselate ? GL_PATCHES : GL_TRIANGLES;
 
-    glDrawElements(mode, indexCount, GL_UNSIGNED_INT, 0);
+    if (m_instanceCount > 1)
+    {
+        glDrawElementsInstanced(mode, indexCount, GL_UNSIGNED_INT, 0, 
+            static_cast<GLsizei>(m_instanceCount));
+    }
+    else
+    {
+        glDrawElements(mode, indexCount, GL_UNSIGNED_INT, 0);
+    }
 
-    m_primitiveCount += static_cast<size_t>(indexCount / 3);
+    m_primitiveCount += static_cast<size_t>(indexCount / 3) * m_instanceCount;
+    ++m_drawCallCount;
 }
 
 void RenderVisitor::visit(PrimitiveSet& primitiveSet)
 {
     const GLenum type = translate(primitiveSet.type());
     const GLsizei vertexCount = static_cast<GLsizei>(primitiveSet.vertexCount());
-    glDrawArrays(type, 0, vertexCount);
+
+    if (m_instanceCount > 1)
+    {
+        glDrawArraysInstanced(type, 0, vertexCount, 
+            static_cast<GLsizei>(m_instanceCount));
+    }
+    else
+    {
+        glDrawArrays(type, 0, vertexCount);
+    }
 
     size_t primitiveCount = static_cast<size_t>(vertexCount);
     primitiveCount /= (type == GL_POINTS) ? 1 : (type == GL_LINES) ? 2 : 3;
-    m_primitiveCount += primitiveCount;
+    m_primitiveCount += primitiveCount * m_instanceCount;
+    ++m_drawCallCount;
 }
 
 void RenderVisitor::resetPrimitiveCount()
 {
     m_primitiveCount = 0;
+    m_drawCallCount = 0;
 }
 
 size_t RenderVisitor::primitiveCount() const
@@ -137,6 +158,11 @@ size_t RenderVisitor::primitiveCount() const
     return m_primitiveCount;
 }
 
+size_t RenderVisitor::drawCallCount() const
+{
+    return m_drawCallCount;
+}
+
 Renderer::Renderer()
     : m_geometryPainter(new RenderVisitor())
 {
@@ -147,16 +173,35 @@ Renderer::Renderer()
     glPatchParameteri(GL_PATCH_VERTICES, 3);
 }
 
-void Renderer::render(IGeometrySPtr geo, MaterialSPtr mat)
+void Renderer::render(IGeometrySPtr geo, MaterialSPtr mat, unsigned int instanceCount, unsigned int layerCount)
 {
     mat->bind();
     bindTextures(mat);
     geo->bind();
 
-    m_geometryPainter->prepare(*mat);
+    // instanced draws fetch their transforms from the bound instance buffer
+    if (instanceCount > 1)
+    {
+        mat->setUniform("_instanced", 1);
+    }
+    if (layerCount > 1)
+    {
+        mat->setUniform("_layerCount", static_cast<int>(layerCount));
+    }
+
+    m_geometryPainter->prepare(*mat, instanceCount * layerCount);
 
     geo->accept(*m_geometryPainter);
 
+    if (instanceCount > 1)
+    {
+        mat->setUniform("_instanced", 0);
+    }
+    if (layerCount > 1)
+    {
+        mat->setUniform("_layerCount", 1);
+    }
+
     geo->unbind();
     unbindTextures();
     mat->unbind();
@@ -167,6 +212,11 @@ size_t Renderer::primitiveCounter() const
     return m_geometryPainter->primitiveCount();
 }
 
+size_t Renderer::drawCallCounter() const
+{
+    return m_geometryPainter->drawCallCount();
+}
+
 void Renderer::resetPrimitiveCounter()
 {
     m_geometryPainter->resetPrimitiveCount();
@@ -197,14 +247,18 @@ void Renderer::blit(IRenderTargetSPtr source, IRenderTargetSPtr target, TextureF
 
 void Renderer::setTarget(IRenderTargetSPtr target)
 {
-    if (target && target != m_currentRenderTarget)
+    if (target)
     {
+        // the level of a bound target may have changed
         glViewport(
             0,0,
             target->width(),
             target->height()
         );
+    }
 
+    if (target && target != m_currentRenderTarget)
+    {
         GLuint fbo = target->handle();
         
         glBindFramebuffer(GL_FRAMEBUFFER, fbo);
@@ -387,50 +441,42 @@ void Renderer::applyState(const RendererState& state, bool force)
 
 void Renderer::regenerateMipmaps(ITextureSPtr tex)
 {
-    switch (tex->layout())
+    if (tex->handle() != SharedResource::INVALID_HANDLE)
     {
-    case TextureLayout::Texture2D:
-        glBindTexture(GL_TEXTURE_2D, tex->handle());
-        glGenerateMipmap(GL_TEXTURE_2D);
-        break;
-    case TextureLayout::Cubemap:
-        glBindTexture(GL_TEXTURE_CUBE_MAP, tex->handle());
-        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-        break;
+        glGenerateTextureMipmap(tex->handle());
     }
-
-    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void Renderer::bindTextures(MaterialSPtr mat)
 {
+    const auto& defaultTextures = mat->program()->defaultTextures();
+
     //TODO optimize!! don't use strings here if possible!
     auto textures = mat->uniformTextures();
     textures.insert(
-        mat->program()->defaultTextures().begin(),
-        mat->program()->defaultTextures().end());
+        defaultTextures.begin(),
+        defaultTextures.end());
 
     m_boundTextures.reserve(textures.size());
 
     int activeTextureUnit = 0;
-    for (const auto& [name, texture] : textures)
+    for (auto [name, texture] : textures)
     {
-        GLenum target;
-        switch (texture->layout())
+        // streamed textures are not resident before their upload
+        if (texture->handle() == SharedResource::INVALID_HANDLE)
         {
-        case TextureLayout::Texture2D:
-            target = GL_TEXTURE_2D;
-            break;
-        case TextureLayout::Cubemap:
-            target = GL_TEXTURE_CUBE_MAP;
-            break;
-        default:
-            throw std::exception("Try to bind unsupported texture layout.");
+            const auto& found = defaultTextures.find(name);
+            if (found != defaultTextures.end())
+            {
+                texture = found->second;
+            }
         }
 
+        const bool resident = texture->handle() != SharedResource::INVALID_HANDLE;
+
         mat->setUniform(name, activeTextureUnit);
-        glActiveTexture(GL_TEXTURE0 + activeTextureUnit);
-        glBindTexture(target, texture->handle());
+        glBindTextureUnit(activeTextureUnit, resident ? texture->handle() : 0);
+        glBindSampler(activeTextureUnit, resident ? texture->samplerHandle() : 0);
 
         m_boundTextures.push_back(texture);
 
@@ -444,8 +490,8 @@ void Renderer::unbindTextures()
 {
     for (size_t i = 0; i < m_boundTextures.size(); ++i)
     {
-        glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + i));
-        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTextureUnit(static_cast<GLuint>(i), 0);
+        glBindSampler(static_cast<GLuint>(i), 0);
     }
     m_boundTextures.clear();
 }
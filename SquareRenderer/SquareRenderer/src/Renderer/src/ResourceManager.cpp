@@ -1,6 +1,7 @@
 #include "Renderer/ResourceManager.h"
 #include "API/GraphicsAPI.h"
 #include "Common/Logger.h"
+#include "Renderer/InstanceBuffer.h"
 #include "Renderer/IRenderTarget.h"
 #include "Renderer/RenderTarget.h"
 #include "Scene/IGeometry.h"
@@ -31,6 +32,11 @@ bool ResourceManager::allocateRenderTarget(RenderTargetSPtr rt)
 	return m_api->allocate(rt);
 }
 
+bool ResourceManager::allocateInstanceBuffer(InstanceBufferSPtr instanceBuffer)
+{
+	return m_api->allocate(instanceBuffer);
+}
+
 RenderTargetSPtr ResourceManager::createSimpleColorTarget(IRenderTargetSPtr source, float scale, TextureFormat format, TextureSampler sampler)
 {
 	return createSimpleColorTarget(static_cast<int>(source->width() * scale), static_cast<int>(source->height() * scale), format, sampler);
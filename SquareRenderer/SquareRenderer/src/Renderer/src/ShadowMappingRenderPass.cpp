@@ -4,6 +4,7 @@
 #include "Material/MaterialLibrary.h"
 #include "Renderer/DepthBuffer.h"
 #include "Renderer/IDrawable.h"
+#include "Renderer/InstanceBatch.h"
 #include "Renderer/Renderer.h"
 #include "Renderer/RenderTarget.h"
 #include "Renderer/ResourceManager.h"
@@ -108,20 +109,17 @@ void ShadowMappingRenderPass::setup(SceneSPtr scene)
 
 	std::set<ShaderProgramSPtr> usedPrograms;
 
-	auto t = m_scene->traverser();
-	while (t.hasNext())
+	for (IDrawableSPtr drawable : m_scene->drawables())
 	{
-		IDrawableSPtr drawable = t.next();
-		if (drawable->geometry() && drawable->material())
+		if (drawable->material()->layer() == Material::Layer::Opaque)
 		{
-			if (drawable->material()->layer() == Material::Layer::Opaque)
-			{
-				m_geometry.push_back(drawable);
-				usedPrograms.insert(drawable->material()->program());
-			}
+			m_geometry.push_back(drawable);
+			usedPrograms.insert(drawable->material()->program());
 		}
 	}
 
+	m_geometry = InstanceBatch::build(m_geometry, m_resources);
+
 	for (ShaderProgramSPtr program : usedPrograms)
 	{
 		//TODO check if shadows are supported?
@@ -0,0 +1,143 @@
+#include "Renderer/TextureFeedbackRenderPass.h"
+#include "API/GraphicsAPI.h"
+#include "Common/Logger.h"
+#include "Material/Material.h"
+#include "Material/MaterialLibrary.h"
+#include "Renderer/DepthBuffer.h"
+#include "Renderer/IDrawable.h"
+#include "Renderer/Renderer.h"
+#include "Renderer/RenderTarget.h"
+#include "Renderer/ResourceManager.h"
+#include "Renderer/TextureResidencyManager.h"
+#include "Texture/Texture2D.h"
+#include "Texture/TextureDefines.h"
+
+#include <cmath>
+#include <unordered_map>
+
+// every feedback pixel covers a tile of this extent on screen
+constexpr int FEEDBACK_TILE_SIZE = 8;
+
+// frames between two feedback renderings
+constexpr int FEEDBACK_INTERVAL = 4;
+
+TextureFeedbackRenderPass::TextureFeedbackRenderPass(ResourceManagerSPtr resources, MaterialLibrarySPtr matlib, TextureResidencyManagerSPtr residency)
+	: BaseGeometryRenderPass("Texture Feedback", resources, matlib)
+	, m_residency(residency)
+	, m_readback(new GPUReadback())
+{
+}
+
+TextureFeedbackRenderPass::~TextureFeedbackRenderPass()
+{
+}
+
+void TextureFeedbackRenderPass::setup(IRenderTargetSPtr source, const std::vector<IDrawableSPtr>& drawables)
+{
+	TextureSampler sampler;
+	sampler.filter = TextureFilter::Nearest;
+	sampler.mipmapping = false;
+
+	Texture2DSPtr feedbackTexture = std::make_shared<Texture2D>(
+		std::max(1, source->width() / FEEDBACK_TILE_SIZE),
+		std::max(1, source->height() / FEEDBACK_TILE_SIZE),
+		TextureFormat::RGBAFloat, 
+		sampler);
+
+	m_feedbackBuffer = std::make_shared<RenderTarget>(feedbackTexture, DepthBufferFormat::Depth24);
+	if (!m_resources->allocateRenderTarget(m_feedbackBuffer))
+	{
+		Logger::Error("Invalid texture feedback framebuffer.");
+		m_feedbackBuffer.reset();
+	}
+
+	BaseRenderPass::setup(m_feedbackBuffer);
+
+	m_feedbackMaterial = m_matlib->instanciate("Util.TextureFeedback");
+	m_drawables = drawables;
+}
+
+void TextureFeedbackRenderPass::renderInternal(Renderer& renderer) const
+{
+	if (!m_feedbackBuffer || !m_feedbackMaterial || m_frame++ % FEEDBACK_INTERVAL != 0)
+	{
+		return;
+	}
+
+	RendererState state;
+	state.clearColor = true;
+	state.color = glm::vec4_black;
+
+	renderer.setTarget(m_feedbackBuffer);
+	renderer.applyState(state);
+
+	for (size_t i = 0; i < m_drawables.size(); ++i)
+	{
+		const IDrawableSPtr& elem = m_drawables[i];
+
+		// 0 is the cleared background
+		m_feedbackMaterial->setUniform("feedbackId", static_cast<float>(i + 1));
+
+		elem->preRender(m_feedbackMaterial);
+		renderer.render(elem->geometry(), m_feedbackMaterial, elem->instanceCount());
+		elem->postRender();
+	}
+
+	// skipped while the previous readback is in flight
+	m_readback->request(m_feedbackBuffer);
+}
+
+void TextureFeedbackRenderPass::updateInternal(double /*deltaTime*/)
+{
+	int width = 0;
+	int height = 0;
+	if (!m_readback->fetch(m_pixels, width, height))
+	{
+		return;
+	}
+
+	// finest uv footprint per drawable, the feedback buffer is
+	// coarser than the screen by the tile size
+	const float tileBias = std::log2(static_cast<float>(FEEDBACK_TILE_SIZE));
+
+	std::unordered_map<size_t, float> footprints;
+	for (size_t i = 0; i + 3 < m_pixels.size(); i += 4)
+	{
+		const size_t id = static_cast<size_t>(m_pixels[i]);
+		if (id == 0 || id > m_drawables.size())
+		{
+			continue;
+		}
+
+		const float footprint = m_pixels[i + 1] - tileBias;
+
+		const auto [found, inserted] = footprints.emplace(id - 1, footprint);
+		if (!inserted)
+		{
+			found->second = std::min(found->second, footprint);
+		}
+	}
+
+	m_residency->beginFeedback();
+
+	for (const auto& [index, footprint] : footprints)
+	{
+		for (const auto& [name, texture] : m_drawables[index]->material()->uniformTextures())
+		{
+			if (!texture || texture->layout() != TextureLayout::Texture2D)
+			{
+				continue;
+			}
+
+			Texture2DSPtr texture2D = std::static_pointer_cast<Texture2D>(texture);
+
+			// level at which one texel covers one screen pixel
+			const float lod = footprint + std::log2(static_cast<float>(
+				std::max(texture2D->width(), texture2D->height())));
+
+			m_residency->request(texture2D, std::max(0, static_cast<int>(std::floor(lod))));
+		}
+	}
+
+	m_residency->endFeedback();
+}
@@ -0,0 +1,246 @@
+#include "Renderer/TextureResidencyManager.h"
+#include "API/GraphicsAPI.h"
+#include "Common/Logger.h"
+#include "Common/Timer.h"
+#include "Texture/MipChain.h"
+#include "Texture/Texture2D.h"
+
+#include <algorithm>
+#include <numeric>
+
+// time spent on streaming levels in per update
+constexpr double UPLOAD_BUDGET_MS = 1.0;
+
+TextureResidencyManager::TextureResidencyManager(GraphicsAPISPtr api, size_t budget)
+	: m_api(api)
+	, m_budget(budget)
+{
+}
+
+TextureResidencyManager::~TextureResidencyManager()
+{
+}
+
+void TextureResidencyManager::setBudget(size_t budget)
+{
+	m_budget = budget;
+}
+
+size_t TextureResidencyManager::budget() const
+{
+	return m_budget;
+}
+
+void TextureResidencyManager::track(const std::string& name, Texture2DSPtr texture, MipChainSPtr mips)
+{
+	if (!texture || !mips || mips->levelCount() != texture->levelCount())
+	{
+		Logger::Warning("Texture '%s' cannot be streamed, mip chain does not match", name.c_str());
+		return;
+	}
+
+	Entry entry;
+	entry.name = name;
+	entry.texture = texture;
+	entry.mips = mips;
+	entry.floorLevel = texture->storageLevel();
+	entry.requestedLevel = entry.floorLevel;
+	entry.lastUsed = 0;
+
+	const auto found = m_lookup.find(texture.get());
+	if (found != m_lookup.end())
+	{
+		m_entries[found->second] = std::move(entry);
+		return;
+	}
+
+	m_lookup[texture.get()] = m_entries.size();
+	m_entries.push_back(std::move(entry));
+}
+
+void TextureResidencyManager::beginFeedback()
+{
+	m_requests.clear();
+}
+
+void TextureResidencyManager::request(const Texture2DSPtr& texture, int level)
+{
+	const auto found = m_lookup.find(texture.get());
+	if (found == m_lookup.end())
+	{
+		return;
+	}
+
+	const auto [request, inserted] = m_requests.emplace(found->second, level);
+	if (!inserted)
+	{
+		request->second = std::min(request->second, level);
+	}
+}
+
+void TextureResidencyManager::endFeedback()
+{
+	++m_feedbackCycle;
+
+	for (const auto& [index, level] : m_requests)
+	{
+		Entry& entry = m_entries[index];
+		entry.requestedLevel = std::clamp(level, 0, entry.floorLevel);
+		entry.lastUsed = m_feedbackCycle;
+	}
+
+	m_requests.clear();
+}
+
+void TextureResidencyManager::update()
+{
+	const Timer timer;
+
+	size_t resident = residentBytes();
+
+	evict(resident);
+
+	bool progress = true;
+	while (progress && timer.elapsedMs() < UPLOAD_BUDGET_MS)
+	{
+		progress = streamIn(resident);
+	}
+}
+
+void TextureResidencyManager::evict(size_t& resident)
+{
+	if (resident <= m_budget)
+	{
+		return;
+	}
+
+	std::vector<size_t> order(m_entries.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return m_entries[a].lastUsed < m_entries[b].lastUsed;
+	});
+
+	// levels not requested go first, visible textures fall back
+	// to their floor only if that is not enough
+	for (const bool keepRequested : { true, false })
+	{
+		for (size_t index : order)
+		{
+			if (resident <= m_budget)
+			{
+				return;
+			}
+
+			Entry& entry = m_entries[index];
+
+			const bool visible = entry.lastUsed == m_feedbackCycle;
+			const int target = keepRequested && visible ? entry.requestedLevel : entry.floorLevel;
+			if (entry.texture->storageLevel() >= target)
+			{
+				continue;
+			}
+
+			const size_t before = residentBytes(entry);
+			if (m_api->reallocate(entry.texture, target))
+			{
+				resident -= before - residentBytes(entry);
+			}
+		}
+	}
+}
+
+bool TextureResidencyManager::streamIn(size_t& resident)
+{
+	bool progress = false;
+
+	for (Entry& entry : m_entries)
+	{
+		const int level = entry.texture->baseLevel() - 1;
+		if (entry.lastUsed != m_feedbackCycle || level < entry.requestedLevel)
+		{
+			continue;
+		}
+
+		const MipChain& mips = *entry.mips;
+		const size_t size = mips.level(level).size;
+
+		// storage grows one level at a time
+		if (entry.texture->storageLevel() > level)
+		{
+			if (resident + size > m_budget || !m_api->reallocate(entry.texture, level))
+			{
+				continue;
+			}
+			resident += size;
+		}
+
+		const GraphicsAPI::UploadStatus status = m_api->upload(
+			entry.texture, level, mips.data(level), size);
+
+		if (status == GraphicsAPI::UploadStatus::Deferred)
+		{
+			return false;
+		}
+
+		if (status == GraphicsAPI::UploadStatus::Complete)
+		{
+			entry.texture->setBaseLevel(level);
+			progress = true;
+		}
+		else
+		{
+			Logger::Error("Could not stream level %d of texture '%s'", level, entry.name.c_str());
+
+			// not retried before the next feedback
+			entry.requestedLevel = entry.texture->baseLevel();
+		}
+	}
+
+	return progress;
+}
+
+const std::vector<TextureResidencyManager::Entry>& TextureResidencyManager::entries() const
+{
+	return m_entries;
+}
+
+size_t TextureResidencyManager::levelBytes(const Entry& entry, int finestLevel) const
+{
+	size_t size = 0;
+	for (int level = finestLevel; level < entry.mips->levelCount(); ++level)
+	{
+		size += entry.mips->level(level).size;
+	}
+	return size;
+}
+
+size_t TextureResidencyManager::residentBytes(const Entry& entry) const
+{
+	return levelBytes(entry, entry.texture->storageLevel());
+}
+
+size_t TextureResidencyManager::requestedBytes(const Entry& entry) const
+{
+	const bool visible = entry.lastUsed == m_feedbackCycle;
+	return levelBytes(entry, visible ? entry.requestedLevel : entry.floorLevel);
+}
+
+size_t TextureResidencyManager::residentBytes() const
+{
+	size_t size = 0;
+	for (const Entry& entry : m_entries)
+	{
+		size += residentBytes(entry);
+	}
+	return size;
+}
+
+size_t TextureResidencyManager::requestedBytes() const
+{
+	size_t size = 0;
+	for (const Entry& entry : m_entries)
+	{
+		size += requestedBytes(entry);
+	}
+	return size;
+}
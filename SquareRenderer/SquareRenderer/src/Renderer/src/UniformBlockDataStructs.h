@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Common/Math3D.h"
+#include "Common/SphericalHarmonics.h"
 
 struct CameraUniformBlock
 {
@@ -30,8 +31,29 @@ struct LightsUniformBlock
 	alignas(16) glm::vec4 shadowMapIndex[MAX_LIGHT_COUNT]; // TODO check, using scalar does not work as expected!
 };
 
+// has to match the array size in Util/IBLSpecular.frag
+constexpr auto MAX_PREFILTER_SAMPLES = 512;
+struct PrefilterUniformBlock
+{
+	alignas(4) int sampleCount;
+
+	// light directions around the normal, source mip in w
+	alignas(16) glm::vec4 samples[MAX_PREFILTER_SAMPLES];
+};
+
 #pragma warning( pop )
 
+struct EnvironmentUniformBlock
+{
+	// L2 diffuse irradiance divided by pi, rgb
+	alignas(16) glm::vec4 irradianceSH[SphericalHarmonics::COEFFICIENT_COUNT];
+
+	// irradiance volume bounds, w of the minimum is 1 if it is sampled
+	alignas(16) glm::vec4 volumeMin;
+	alignas(16) glm::vec4 volumeMax;
+	alignas(16) glm::vec4 volumeResolution; // probes per axis
+};
+
 bool operator==(const CameraUniformBlock& l, const CameraUniformBlock& r)
 {
 	return l.P == r.P && l.invP == r.invP &&
@@ -70,4 +92,28 @@ bool operator==(const LightsUniformBlock& l, const LightsUniformBlock& r)
 bool operator!=(const LightsUniformBlock& l, const LightsUniformBlock& r)
 {
 	return !(l == r);
-}
\ No newline at end of file
+}
+
+bool operator==(const PrefilterUniformBlock& l, const PrefilterUniformBlock& r)
+{
+	return l.sampleCount == r.sampleCount &&
+		cmpArray(l.samples, r.samples, static_cast<size_t>(l.sampleCount));
+}
+
+bool operator!=(const PrefilterUniformBlock& l, const PrefilterUniformBlock& r)
+{
+	return !(l == r);
+}
+
+bool operator==(const EnvironmentUniformBlock& l, const EnvironmentUniformBlock& r)
+{
+	return cmpArray(l.irradianceSH, r.irradianceSH, SphericalHarmonics::COEFFICIENT_COUNT) &&
+		l.volumeMin == r.volumeMin &&
+		l.volumeMax == r.volumeMax &&
+		l.volumeResolution == r.volumeResolution;
+}
+
+bool operator!=(const EnvironmentUniformBlock& l, const EnvironmentUniformBlock& r)
+{
+	return !(l == r);
+}
@@ -20,13 +20,21 @@ struct Vertex
     constexpr static unsigned char DATA_FULL        = DATA_UV | DATA_NORMAL | DATA_TANGENT;
 };
 
+// CPU side geometry data kept after the upload to the GPU
+enum class GeometryResidency
+{
+    KeepAll,        // full vertex and index data
+    PositionsOnly,  // compact positions and indices, e.g. for picking
+    Release         // only counts and bounds remain
+};
+
 DECLARE_PTRS(IGeometry);
 
 class IGeometry
 {
 public:
 
-    virtual ~IGeometry() = 0 {};
+    virtual ~IGeometry() = 0;
 
     virtual void accept(IGeometryVisitor& visitor) = 0;
 
@@ -35,4 +43,6 @@ public:
     virtual void unbind() = 0;
 
     virtual unsigned char dataFieldFlags() const = 0;
-};
\ No newline at end of file
+};
+
+inline IGeometry::~IGeometry() {}
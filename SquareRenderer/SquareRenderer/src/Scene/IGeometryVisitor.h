@@ -12,10 +12,12 @@ class IGeometryVisitor
 {
 public:
 
-	virtual ~IGeometryVisitor() = 0 {};
+	virtual ~IGeometryVisitor() = 0;
 
 	virtual void visit(Mesh& mesh) = 0;
 
 	virtual void visit(PrimitiveSet& primitiveSet) = 0;
 
-};
\ No newline at end of file
+};
+
+inline IGeometryVisitor::~IGeometryVisitor() {}
@@ -2,6 +2,7 @@
 
 #include "Common/Macros.h"
 #include "Scene/IGeometry.h"
+#include "Scene/BoundingBox.h"
 #include "API/SharedResource.h"
 
 #include <vector>
@@ -22,6 +23,13 @@ public:
         unsigned char dataFieldFlags = Vertex::DATA_FULL
     );
 
+    // bounds are trusted, e.g. when restored from a cache
+    Mesh(std::vector<Vertex>&& vertices,
+         std::vector<uint32_t>&& indices,
+         const BoundingBox& bounds,
+        unsigned char dataFieldFlags = Vertex::DATA_FULL
+    );
+
     virtual ~Mesh();
 
     virtual void accept(IGeometryVisitor& visitor) override;
@@ -46,15 +54,44 @@ public:
 
     virtual size_t indexBufferSize() const;
 
+    // empty unless the residency keeps all data
     virtual const std::vector<Vertex>& vertices() const;
 
+    // empty if the residency released all data
     virtual const std::vector<uint32_t>& indices() const;
 
+    // empty unless the residency keeps positions only
+    virtual const std::vector<glm::vec3>& positions() const;
+
+    virtual const BoundingBox& bounds() const;
+
+    // policy is applied as soon as the mesh is linked
+    virtual void setResidency(GeometryResidency residency);
+
+    virtual GeometryResidency residency() const;
+
+    virtual bool hasClientData() const;
+
+    // bytes currently held in system memory
+    virtual size_t clientMemoryUsage() const;
+
 protected:
 
-    const std::vector<Vertex> m_vertices;
+    void applyResidency();
+
+    std::vector<Vertex> m_vertices;
+
+    std::vector<uint32_t> m_indices;
+
+    std::vector<glm::vec3> m_positions;
+
+    size_t m_vertexCount;
+
+    size_t m_indexCount;
+
+    BoundingBox m_bounds;
 
-    const std::vector<uint32_t> m_indices;
+    GeometryResidency m_residency = GeometryResidency::KeepAll;
 
     IGeometryResourceUPtr m_linkedResource;
 
@@ -2,6 +2,7 @@
 
 #include "Common/Macros.h"
 #include "Scene/IGeometry.h"
+#include "Scene/BoundingBox.h"
 
 #include "API/SharedResource.h"
 
@@ -46,14 +47,40 @@ public:
 
 	virtual size_t vertexBufferSize() const;
 
+	// empty unless the residency keeps all data
 	virtual const std::vector<Vertex>& vertices() const;
 
+	// empty unless the residency keeps positions only
+	virtual const std::vector<glm::vec3>& positions() const;
+
+	virtual const BoundingBox& bounds() const;
+
+	// policy is applied as soon as a static set is linked
+	virtual void setResidency(GeometryResidency residency);
+
+	virtual GeometryResidency residency() const;
+
+	virtual bool hasClientData() const;
+
+	// bytes currently held in system memory
+	virtual size_t clientMemoryUsage() const;
+
 protected:
 
+	void applyResidency();
+
 	PrimitiveType m_type;
 
 	std::vector<Vertex> m_vertices;
 
+	std::vector<glm::vec3> m_positions;
+
+	size_t m_vertexCount;
+
+	BoundingBox m_bounds;
+
+	GeometryResidency m_residency = GeometryResidency::KeepAll;
+
 	IGeometryResourceUPtr m_linkedResource;
 
 	bool m_isBound = false;
@@ -2,6 +2,7 @@
 
 #include "Common/Macros.h"
 
+#include <cstdint>
 #include <vector>
 #include <stack>
 
@@ -9,6 +10,7 @@ DECLARE_PTRS(SceneNode);
 DECLARE_PTRS(Scene);
 DECLARE_PTRS(ILightsource);
 DECLARE_PTRS(Cubemap);
+DECLARE_PTRS(IDrawable);
 class BoundingBox;
 
 class Scene
@@ -32,8 +34,20 @@ public:
 
     unsigned int nodeNum() const;
 
+    void addStaticBatch(SceneNodeSPtr batch);
+
+    const std::vector<SceneNodeSPtr>& staticBatches() const;
+
+    // all renderable nodes, nodes merged into static batches are 
+    // replaced by their batches
+    std::vector<IDrawableSPtr> drawables() const;
+
     Traverser traverser() const;
 
+    // of everything baked lighting depends on: node names, transforms 
+    // and materials as well as the light sources, not the sky
+    uint64_t contentHash() const;
+
     class Traverser
     {
     public:
@@ -56,5 +70,7 @@ protected:
     CubemapSPtr m_sky;
 
     std::vector<ILightsourceSPtr> m_lights;
+
+    std::vector<SceneNodeSPtr> m_staticBatches;
 };
 
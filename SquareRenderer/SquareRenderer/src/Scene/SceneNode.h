@@ -18,6 +18,9 @@ public:
 
 	explicit SceneNode(const std::string& name);
 
+	// copies the node hierarchy, geometry and materials are shared
+	SceneNodeSPtr clone() const;
+
 	const std::string& name() const;
 
 	void setParent(SceneNodeSPtr node);
@@ -36,6 +39,8 @@ public:
 
 	glm::mat4 worldTransform() const;
 
+	glm::mat4 normalTransform() const;
+
 	void setMaterial(MaterialSPtr material);
 
 	virtual MaterialSPtr material() const override;
@@ -44,10 +49,18 @@ public:
 
 	virtual IGeometrySPtr geometry() const override;
 
+	virtual unsigned int instanceCount() const override;
+
 	virtual void preRender(MaterialSPtr material) override;
 
 	virtual void postRender() override;
 
+	// batched nodes keep their geometry for picking and bounds, 
+	// but are rendered through a static batch
+	void setBatched(bool batched);
+
+	bool isBatched() const;
+
 	void setBounds(const BoundingBox& bounds);
 
 	const BoundingBox& bounds() const;
@@ -73,4 +86,6 @@ private:
 	mutable glm::mat4 m_cachedWorldTransform;
 
 	mutable bool m_dirtyTransform = false;
+
+	bool m_isBatched = false;
 };
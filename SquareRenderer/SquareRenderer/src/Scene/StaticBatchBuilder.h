@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Common/Macros.h"
+
+#include <vector>
+
+DECLARE_PTRS(SceneNode);
+
+class StaticBatchBuilder
+{
+public:
+
+	// chunkSize <= 0 disables the spatial subdivision
+	explicit StaticBatchBuilder(float chunkSize = 0.f, size_t maxVertexCount = 1 << 20);
+
+	// registers all nodes of the hierarchy as static geometry
+	void add(SceneNodeSPtr root);
+
+	// merges the registered geometry per material and chunk into world space
+	// meshes, source nodes are flagged as batched
+	std::vector<SceneNodeSPtr> build();
+
+private:
+
+	float m_chunkSize;
+
+	size_t m_maxVertexCount;
+
+	std::vector<SceneNodeSPtr> m_nodes;
+};
@@ -7,15 +7,40 @@ Mesh::Mesh(const std::vector<Vertex>& vertices,
            unsigned char dataFieldFlags)
     : m_vertices(vertices)
     , m_indices(indices)
+    , m_vertexCount(m_vertices.size())
+    , m_indexCount(m_indices.size())
     , m_dataFieldFlags(dataFieldFlags)
 {
+    for (const Vertex& v : m_vertices)
+    {
+        m_bounds.insert(v.position);
+    }
 }
 
 Mesh::Mesh(std::vector<Vertex>&& vertices,
            std::vector<uint32_t>&& indices,
            unsigned char dataFieldFlags)
-    : m_vertices(vertices)
-    , m_indices(indices)
+    : m_vertices(std::move(vertices))
+    , m_indices(std::move(indices))
+    , m_vertexCount(m_vertices.size())
+    , m_indexCount(m_indices.size())
+    , m_dataFieldFlags(dataFieldFlags)
+{
+    for (const Vertex& v : m_vertices)
+    {
+        m_bounds.insert(v.position);
+    }
+}
+
+Mesh::Mesh(std::vector<Vertex>&& vertices,
+           std::vector<uint32_t>&& indices,
+           const BoundingBox& bounds,
+           unsigned char dataFieldFlags)
+    : m_vertices(std::move(vertices))
+    , m_indices(std::move(indices))
+    , m_vertexCount(m_vertices.size())
+    , m_indexCount(m_indices.size())
+    , m_bounds(bounds)
     , m_dataFieldFlags(dataFieldFlags)
 {
 }
@@ -50,6 +75,8 @@ void Mesh::unbind()
 void Mesh::link(IGeometryResourceUPtr resource)
 {
     m_linkedResource = std::move(resource);
+
+    applyResidency();
 }
 
 bool Mesh::linked() const
@@ -65,17 +92,17 @@ bool Mesh::isBound() const
 
 size_t Mesh::vertexCount() const
 {
-    return m_vertices.size();
+    return m_vertexCount;
 }
 
 size_t Mesh::vertexBufferSize() const
 {
-    return sizeof(Vertex) * m_vertices.size();
+    return sizeof(Vertex) * m_vertexCount;
 }
 
 size_t Mesh::indexCount() const
 {
-    return m_indices.size();
+    return m_indexCount;
 }
 
 const std::vector<Vertex>& Mesh::vertices() const
@@ -85,7 +112,7 @@ const std::vector<Vertex>& Mesh::vertices() const
 
 size_t Mesh::indexBufferSize() const
 {
-    return sizeof(uint32_t) * m_indices.size();
+    return sizeof(uint32_t) * m_indexCount;
 }
 
 const std::vector<uint32_t>& Mesh::indices() const
@@ -97,3 +124,63 @@ unsigned char Mesh::dataFieldFlags() const
 {
     return m_dataFieldFlags;
 }
+
+const std::vector<glm::vec3>& Mesh::positions() const
+{
+    return m_positions;
+}
+
+const BoundingBox& Mesh::bounds() const
+{
+    return m_bounds;
+}
+
+void Mesh::setResidency(GeometryResidency residency)
+{
+    m_residency = residency;
+
+    applyResidency();
+}
+
+GeometryResidency Mesh::residency() const
+{
+    return m_residency;
+}
+
+bool Mesh::hasClientData() const
+{
+    return m_vertices.size() == m_vertexCount
+        && m_indices.size() == m_indexCount;
+}
+
+size_t Mesh::clientMemoryUsage() const
+{
+    return sizeof(Vertex) * m_vertices.size()
+        + sizeof(uint32_t) * m_indices.size()
+        + sizeof(glm::vec3) * m_positions.size();
+}
+
+void Mesh::applyResidency()
+{
+    // the GPU copy is the only one left after releasing
+    if (!linked() || m_residency == GeometryResidency::KeepAll)
+    {
+        return;
+    }
+
+    if (m_residency == GeometryResidency::PositionsOnly && m_positions.empty())
+    {
+        m_positions.reserve(m_vertices.size());
+        for (const Vertex& v : m_vertices)
+        {
+            m_positions.push_back(v.position);
+        }
+    }
+    else if (m_residency == GeometryResidency::Release)
+    {
+        std::vector<glm::vec3>().swap(m_positions);
+        std::vector<uint32_t>().swap(m_indices);
+    }
+
+    std::vector<Vertex>().swap(m_vertices);
+}
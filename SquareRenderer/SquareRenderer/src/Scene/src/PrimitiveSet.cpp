@@ -6,9 +6,14 @@ PrimitiveSet::PrimitiveSet(
 	std::vector<Vertex>&& vertices, 
 	unsigned char dataFieldFlags)
 	: m_type(type)
-	, m_vertices(vertices)
+	, m_vertices(std::move(vertices))
+	, m_vertexCount(m_vertices.size())
 	, m_dataFieldFlags(dataFieldFlags)
 {
+	for (const Vertex& v : m_vertices)
+	{
+		m_bounds.insert(v.position);
+	}
 }
 
 PrimitiveSet::~PrimitiveSet()
@@ -46,6 +51,8 @@ unsigned char PrimitiveSet::dataFieldFlags() const
 void PrimitiveSet::link(IGeometryResourceUPtr resource)
 {
 	m_linkedResource = std::move(resource);
+
+	applyResidency();
 }
 
 bool PrimitiveSet::linked() const
@@ -71,15 +78,72 @@ PrimitiveType PrimitiveSet::type() const
 
 size_t PrimitiveSet::vertexCount() const
 {
-	return m_vertices.size();
+	return m_vertexCount;
 }
 
 size_t PrimitiveSet::vertexBufferSize() const
 {
-	return sizeof(Vertex) * m_vertices.size();
+	return sizeof(Vertex) * m_vertexCount;
 }
 
 const std::vector<Vertex>& PrimitiveSet::vertices() const
 {
 	return m_vertices;
 }
+
+const std::vector<glm::vec3>& PrimitiveSet::positions() const
+{
+	return m_positions;
+}
+
+const BoundingBox& PrimitiveSet::bounds() const
+{
+	return m_bounds;
+}
+
+void PrimitiveSet::setResidency(GeometryResidency residency)
+{
+	m_residency = residency;
+
+	applyResidency();
+}
+
+GeometryResidency PrimitiveSet::residency() const
+{
+	return m_residency;
+}
+
+bool PrimitiveSet::hasClientData() const
+{
+	return m_vertices.size() == m_vertexCount;
+}
+
+size_t PrimitiveSet::clientMemoryUsage() const
+{
+	return sizeof(Vertex) * m_vertices.size()
+		+ sizeof(glm::vec3) * m_positions.size();
+}
+
+void PrimitiveSet::applyResidency()
+{
+	// dynamic sets are re-uploaded from the client copy
+	if (!linked() || !isStatic() || m_residency == GeometryResidency::KeepAll)
+	{
+		return;
+	}
+
+	if (m_residency == GeometryResidency::PositionsOnly && m_positions.empty())
+	{
+		m_positions.reserve(m_vertices.size());
+		for (const Vertex& v : m_vertices)
+		{
+			m_positions.push_back(v.position);
+		}
+	}
+	else if (m_residency == GeometryResidency::Release)
+	{
+		std::vector<glm::vec3>().swap(m_positions);
+	}
+
+	std::vector<Vertex>().swap(m_vertices);
+}
@@ -1,7 +1,11 @@
 #include "Scene/Scene.h"
+#include "Common/Hash.h"
+#include "Material/Material.h"
 #include "Scene/SceneNode.h"
 #include "Scene/BoundingBox.h"
+#include "Scene/DirectionalLight.h"
 #include "Scene/ILightsource.h"
+#include "Scene/PointLight.h"
 #include "Texture/Cubemap.h"
 
 Scene::Scene(SceneNodeSPtr root)
@@ -44,11 +48,78 @@ unsigned int Scene::nodeNum() const
 	return m_root->count();
 }
 
+void Scene::addStaticBatch(SceneNodeSPtr batch)
+{
+	m_staticBatches.push_back(batch);
+}
+
+const std::vector<SceneNodeSPtr>& Scene::staticBatches() const
+{
+	return m_staticBatches;
+}
+
+std::vector<IDrawableSPtr> Scene::drawables() const
+{
+	std::vector<IDrawableSPtr> result;
+	result.reserve(nodeNum() + m_staticBatches.size());
+
+	auto t = traverser();
+	while (t.hasNext())
+	{
+		SceneNodeSPtr node = t.next();
+		if (node->geometry() && node->material() && !node->isBatched())
+		{
+			result.push_back(node);
+		}
+	}
+
+	result.insert(result.end(), m_staticBatches.begin(), m_staticBatches.end());
+
+	return result;
+}
+
 Scene::Traverser Scene::traverser() const
 {
 	return Traverser(m_root);
 }
 
+uint64_t Scene::contentHash() const
+{
+	uint64_t hash = Hash::FNV_OFFSET;
+
+	auto t = traverser();
+	while (t.hasNext())
+	{
+		SceneNodeSPtr node = t.next();
+		hash = Hash::fnv1a(node->name(), hash);
+		hash = Hash::combine(hash, node->worldTransform());
+		if (node->material())
+		{
+			hash = Hash::fnv1a(node->material()->name(), hash);
+		}
+	}
+
+	for (ILightsourceSPtr light : m_lights)
+	{
+		hash = Hash::combine(hash, light->type());
+		hash = Hash::combine(hash, light->color());
+		hash = Hash::combine(hash, light->intensity());
+		hash = Hash::combine(hash, light->isShadowCaster());
+
+		switch (light->type())
+		{
+		case LightsourceType::Directional:
+			hash = Hash::combine(hash, std::static_pointer_cast<DirectionalLight>(light)->direction());
+			break;
+		case LightsourceType::Point:
+			hash = Hash::combine(hash, std::static_pointer_cast<PointLight>(light)->position());
+			break;
+		}
+	}
+
+	return hash;
+}
+
 Scene::Traverser::Traverser(SceneNodeSPtr node)
 	: m_node(node)
 {
@@ -8,6 +8,24 @@ SceneNode::SceneNode(const std::string& name)
 {
 }
 
+SceneNodeSPtr SceneNode::clone() const
+{
+    SceneNodeSPtr copy = std::make_shared<SceneNode>(m_name);
+    copy->setLocalTransform(m_transform);
+    copy->setMaterial(m_material);
+    copy->setGeometry(m_geometry);
+    copy->setBounds(m_bounds);
+
+    for (SceneNodeSPtr child : m_children)
+    {
+        SceneNodeSPtr childCopy = child->clone();
+        copy->addChild(childCopy);
+        childCopy->setParent(copy);
+    }
+
+    return copy;
+}
+
 const std::string& SceneNode::name() const
 {
     return m_name;
@@ -73,6 +91,20 @@ glm::mat4 SceneNode::worldTransform() const
     }
 }
 
+glm::mat4 SceneNode::normalTransform() const
+{
+    if (!m_parent.expired())
+    {
+        // refreshes the cached normal matrix if necessary
+        worldTransform();
+        return m_cachedNormalToWorld;
+    }
+    else
+    {
+        return glm::transpose(glm::inverse(localTransform()));
+    }
+}
+
 void SceneNode::setMaterial(MaterialSPtr material)
 {
     m_material = material;
@@ -93,12 +125,17 @@ IGeometrySPtr SceneNode::geometry() const
     return m_geometry;
 }
 
+unsigned int SceneNode::instanceCount() const
+{
+    return 1;
+}
+
 void SceneNode::preRender(MaterialSPtr material)
 {
     const glm::mat4 modelToWorld = worldTransform();
 
     material->setUniform("modelToWorld", modelToWorld);
-    material->setUniform("normalToWorld", m_cachedNormalToWorld);// glm::transpose(glm::inverse(modelToWorld)));
+    material->setUniform("normalToWorld", normalTransform());
 }
 
 void SceneNode::postRender()
@@ -106,6 +143,16 @@ void SceneNode::postRender()
 
 }
 
+void SceneNode::setBatched(bool batched)
+{
+    m_isBatched = batched;
+}
+
+bool SceneNode::isBatched() const
+{
+    return m_isBatched;
+}
+
 void SceneNode::setBounds(const BoundingBox& bounds)
 {
     m_bounds = bounds;
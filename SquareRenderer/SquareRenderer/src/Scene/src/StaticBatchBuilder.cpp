@@ -0,0 +1,167 @@
+#include "Scene/StaticBatchBuilder.h"
+#include "Common/Logger.h"
+#include "Common/Math3D.h"
+#include "Material/Material.h"
+#include "Scene/BoundingBox.h"
+#include "Scene/Mesh.h"
+#include "Scene/SceneNode.h"
+
+#include <map>
+#include <tuple>
+
+struct BatchData
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<SceneNodeSPtr> sources;
+	BoundingBox bounds;
+};
+
+StaticBatchBuilder::StaticBatchBuilder(float chunkSize, size_t maxVertexCount)
+	: m_chunkSize(chunkSize)
+	, m_maxVertexCount(maxVertexCount)
+{
+}
+
+void StaticBatchBuilder::add(SceneNodeSPtr root)
+{
+	if (!root)
+	{
+		return;
+	}
+
+	m_nodes.push_back(root);
+
+	for (SceneNodeSPtr child : root->children())
+	{
+		add(child);
+	}
+}
+
+void appendTransformed(BatchData& batch, SceneNodeSPtr node, const Mesh& mesh)
+{
+	const glm::mat4 M = node->worldTransform();
+	const glm::mat3 N = glm::mat3(node->normalTransform());
+	const glm::mat3 T = glm::mat3(M);
+
+	const uint32_t indexOffset = static_cast<uint32_t>(batch.vertices.size());
+
+	batch.vertices.reserve(batch.vertices.size() + mesh.vertexCount());
+	for (const Vertex& v : mesh.vertices())
+	{
+		Vertex transformed = v;
+		transformed.position = glm::vec3(M * glm::vec4(v.position, 1.f));
+		transformed.normal = glm::normalize(N * v.normal);
+		transformed.tangent = glm::normalize(T * v.tangent);
+
+		batch.bounds.insert(transformed.position);
+		batch.vertices.push_back(transformed);
+	}
+
+	batch.indices.reserve(batch.indices.size() + mesh.indexCount());
+	for (uint32_t index : mesh.indices())
+	{
+		batch.indices.push_back(index + indexOffset);
+	}
+
+	batch.sources.push_back(node);
+}
+
+std::vector<SceneNodeSPtr> StaticBatchBuilder::build()
+{
+	// material, vertex layout and chunk coordinate
+	typedef std::tuple<Material*, unsigned char, int, int, int> BatchKey;
+
+	std::map<BatchKey, MaterialSPtr> materials;
+	std::map<BatchKey, std::vector<BatchData>> batches;
+
+	size_t releasedCount = 0;
+
+	for (SceneNodeSPtr node : m_nodes)
+	{
+		MeshSPtr mesh = std::dynamic_pointer_cast<Mesh>(node->geometry());
+		MaterialSPtr material = node->material();
+
+		// the residency of an earlier non static import released the vertices
+		if (mesh && !mesh->hasClientData())
+		{
+			++releasedCount;
+			continue;
+		}
+
+		// transparent geometry has to stay sortable
+		if (!mesh || !material || node->isBatched() ||
+			material->layer() == Material::Layer::Transparent ||
+			mesh->vertexCount() > m_maxVertexCount)
+		{
+			continue;
+		}
+
+		glm::ivec3 chunk(0);
+		if (m_chunkSize > 0.f && !node->bounds().empty())
+		{
+			const BoundingBox worldBounds = node->worldTransform() * node->bounds();
+			chunk = glm::ivec3(glm::floor(worldBounds.center() / m_chunkSize));
+		}
+
+		const BatchKey key = { material.get(), mesh->dataFieldFlags(), chunk.x, chunk.y, chunk.z };
+		materials[key] = material;
+
+		std::vector<BatchData>& chunkBatches = batches[key];
+		if (chunkBatches.empty() ||
+			chunkBatches.back().vertices.size() + mesh->vertexCount() > m_maxVertexCount)
+		{
+			chunkBatches.emplace_back();
+		}
+
+		appendTransformed(chunkBatches.back(), node, *mesh);
+	}
+
+	std::vector<SceneNodeSPtr> result;
+	size_t sourceCount = 0;
+
+	for (auto& [key, chunkBatches] : batches)
+	{
+		MaterialSPtr material = materials[key];
+
+		for (BatchData& batch : chunkBatches)
+		{
+			// merging a single node only duplicates its geometry
+			if (batch.sources.size() < 2)
+			{
+				continue;
+			}
+
+			const std::string name = "StaticBatch." + material->name() + "." + std::to_string(result.size());
+
+			SceneNodeSPtr batchNode = std::make_shared<SceneNode>(name);
+			batchNode->setGeometry(std::make_shared<Mesh>(
+				std::move(batch.vertices),
+				std::move(batch.indices),
+				std::get<1>(key)));
+			batchNode->setMaterial(material);
+			batchNode->setBounds(batch.bounds);
+
+			for (SceneNodeSPtr source : batch.sources)
+			{
+				source->setBatched(true);
+			}
+
+			sourceCount += batch.sources.size();
+			result.push_back(batchNode);
+		}
+	}
+
+	Logger::Info("Static batching: %i nodes merged into %i batches.",
+		static_cast<int>(sourceCount), static_cast<int>(result.size()));
+
+	if (releasedCount > 0)
+	{
+		Logger::Warning("Static batching: %i nodes skipped, their meshes have no client data left.",
+			static_cast<int>(releasedCount));
+	}
+
+	m_nodes.clear();
+
+	return result;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Texture/TextureDefines.h"
+
+#include <cstdint>
+
+DECLARE_PTRS(MipChain);
+
+namespace BlockCompression
+{
+	// encodes all levels of an 8 bit chain, or a half float one for BC6H,
+	// the blocks of a level are spread over the job system,
+	// nullptr for unsupported formats
+	MipChainUPtr compress(const MipChain& source, TextureFormat target);
+
+	// single blocks of 4x4 RGBA pixels, row major
+
+	void encodeBC1(const uint8_t* rgba, uint8_t* out);
+
+	void encodeBC3(const uint8_t* rgba, uint8_t* out);
+
+	// red channel only
+	void encodeBC4(const uint8_t* rgba, uint8_t* out);
+
+	// red and green channel
+	void encodeBC5(const uint8_t* rgba, uint8_t* out);
+
+	// mode 6 only, single subset with 7.7.7.7 endpoints
+	void encodeBC7(const uint8_t* rgba, uint8_t* out);
+
+	// unsigned half floats, alpha is ignored,
+	// mode 11 only with 10 bit endpoints
+	void encodeBC6H(const uint16_t* rgba, uint8_t* out);
+}
@@ -29,8 +29,16 @@ public:
 
 	virtual SharedResource::Handle handle() const override;
 
+	virtual SharedResource::Handle samplerHandle() const override;
+
 	void link(ITextureResourceUPtr resource);
 
+	// full chain length, 1 without mipmapping
+	int levelCount() const;
+
+	// all six faces of the level one after another, requires a linked resource
+	void updateLevel(int level, const void* data);
+
 protected:
 
 	int m_width;
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Texture/TextureDefines.h"
+
+#include <cstddef>
+#include <cstdint>
+
+DECLARE_PTRS(MipChain);
+
+namespace FloatPacking
+{
+	// IEEE half precision, rounded to nearest even
+	uint16_t toHalf(float value);
+
+	float fromHalf(uint16_t value);
+
+	// uses F16C eight values at a time if the build targets it
+	void toHalf(const float* source, uint16_t* target, size_t count);
+
+	void fromHalf(const uint16_t* source, float* target, size_t count);
+
+	// three 9 bit mantissas with a shared 5 bit exponent,
+	// negative components are clamped to zero
+	uint32_t toRGB9E5(const float* rgb);
+
+	// converts all levels of a float or half chain to a half or RGB9E5
+	// format, rows are spread over the job system, nullptr if unsupported
+	MipChainUPtr pack(const MipChain& source, TextureFormat target);
+}
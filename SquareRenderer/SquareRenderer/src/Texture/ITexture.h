@@ -20,4 +20,6 @@ public:
     virtual int layers() const = 0;
 
     virtual SharedResource::Handle handle() const = 0;
+
+    virtual SharedResource::Handle samplerHandle() const = 0;
 };
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Common/Macros.h"
+#include "Texture/TextureDefines.h"
+
+#include <cstdint>
+#include <vector>
+
+DECLARE_PTRS(MappedFile);
+DECLARE_PTRS(MipChain);
+
+// tightly packed pixels of all mip levels of a texture, level 0 first
+class MipChain
+{
+public:
+
+	struct Level
+	{
+		int width;
+		int height;
+		size_t offset;
+		size_t size;
+	};
+
+	// allocates the levels down to 1x1 if mipmapped, level 0 only otherwise
+	MipChain(TextureFormat format, int width, int height, bool mipmapped);
+
+	// levels read in place from a file mapping starting at the offset,
+	// the mapping has to hold all levels
+	MipChain(TextureFormat format, int width, int height, bool mipmapped, 
+		MappedFileSPtr mapping, size_t mappingOffset);
+
+	TextureFormat format() const;
+
+	int width() const;
+
+	int height() const;
+
+	int levelCount() const;
+
+	const Level& level(int index) const;
+
+	// copies the levels of a mapped chain to owned memory first
+	uint8_t* data(int level = 0);
+
+	const uint8_t* data(int level = 0) const;
+
+	bool isMapped() const;
+
+	// of all levels in bytes
+	size_t size() const;
+
+	// finest level not exceeding the extent in both dimensions
+	int levelForExtent(int maxExtent) const;
+
+	static int maxLevelCount(int width, int height);
+
+	static size_t pixelSize(TextureFormat format);
+
+	static bool isCompressed(TextureFormat format);
+
+	// bytes per 4x4 block of a compressed format
+	static size_t blockSize(TextureFormat format);
+
+	// tightly packed pixels or blocks of a single level
+	static size_t levelSize(TextureFormat format, int width, int height);
+
+	static size_t storageSize(TextureFormat format, int width, int height, bool mipmapped);
+
+private:
+
+	TextureFormat m_format;
+
+	std::vector<Level> m_levels;
+
+	std::vector<uint8_t> m_data;
+
+	MappedFileSPtr m_mapping;
+
+	size_t m_mappingOffset = 0;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+class MipChain;
+
+namespace MipmapGenerator
+{
+	struct Settings
+	{
+		// tiling textures wrap at the borders, all others clamp
+		bool wrap = true;
+
+		// renormalizes the tangent space normal of every level
+		bool normalMap = false;
+
+		// alpha test threshold whose coverage every level keeps, 0 disables
+		float alphaCutoff = 0.f;
+	};
+
+	// fills all levels from level 0 with a Kaiser windowed sinc filter
+	// in linear space, rows are spread over the job system,
+	// false for formats other than 8 bit, half and float
+	bool generate(MipChain& mips, const Settings& settings);
+}
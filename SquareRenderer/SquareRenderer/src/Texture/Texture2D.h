@@ -27,6 +27,8 @@ public:
 
 	virtual SharedResource::Handle handle() const override;
 
+	virtual SharedResource::Handle samplerHandle() const override;
+
 	virtual TextureFormat format() const;
 
 	const TextureSampler& sampler() const;
@@ -35,6 +37,29 @@ public:
 
 	virtual void update(int width, int height, TextureFormat format);
 
+	// requires a linked resource, see GraphicsAPI::upload
+	void updateLevel(int level, const void* data);
+
+	void generateMipmaps();
+
+	// full chain length, 1 without mipmapping
+	int levelCount() const;
+
+	// finest level which may be sampled, levels above are not resident
+	int baseLevel() const;
+
+	void setBaseLevel(int level);
+
+	// finest level backed by GPU memory, applied by the next allocation,
+	// see GraphicsAPI::reallocate for linked textures
+	int storageLevel() const;
+
+	void setStorageLevel(int level);
+
+	// samples the storage of a texture with identical content instead of 
+	// its own, used for deduplicated imports handed out before their decode
+	void share(Texture2DSPtr source);
+
 private:
 
 	int m_width;
@@ -45,6 +70,12 @@ private:
 
 	TextureSampler m_sampler;
 
+	int m_baseLevel = 0;
+
+	int m_storageLevel = 0;
+
 	ITextureResourceUPtr m_linkedResource;
+
+	Texture2DSPtr m_sharedTexture;
 };
 
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Texture/ITexture.h"
+
+#include "Common/Macros.h"
+
+DECLARE_PTRS(Texture3D);
+
+// volume texture without mipmaps, the depth is reported as layers
+class Texture3D : public ITexture
+{
+public:
+
+	Texture3D(int width, int height, int depth, TextureFormat format,
+		TextureSampler sampler = TextureSampler());
+
+	virtual ~Texture3D();
+
+	TextureFormat format() const;
+
+	const TextureSampler& sampler() const;
+
+	virtual TextureLayout layout() const override;
+
+	virtual int width() const override;
+
+	virtual int height() const override;
+
+	virtual int layers() const override;
+
+	virtual SharedResource::Handle handle() const override;
+
+	virtual SharedResource::Handle samplerHandle() const override;
+
+	void link(ITextureResourceUPtr resource);
+
+	// all slices one after another, requires a linked resource
+	void update(const void* data);
+
+protected:
+
+	int m_width;
+
+	int m_height;
+
+	int m_depth;
+
+	TextureFormat m_format;
+
+	TextureSampler m_sampler;
+
+	ITextureResourceUPtr m_linkedResource;
+};
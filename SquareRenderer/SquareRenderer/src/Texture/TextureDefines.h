@@ -6,7 +6,8 @@ enum class TextureLayout
 {
     Image,
     Texture2D,
-    Cubemap
+    Cubemap,
+    Texture3D
 };
 
 enum class TextureAccess
@@ -37,7 +38,21 @@ enum class TextureFormat
     RGBFloat,
     RGBAFloat,
     DepthFloat,
-    ShadowMapFloat
+    ShadowMapFloat,
+
+    // block compressed, 4x4 pixels per block
+    BC1,
+    BC1SRGB,
+    BC3,
+    BC3SRGB,
+    BC4,
+    BC5,
+    BC7,
+    BC7SRGB,
+    BC6H,
+
+    // three 9 bit mantissas sharing a 5 bit exponent
+    RGB9E5
 };
 
 enum class TextureFilter
@@ -0,0 +1,726 @@
+#include "Texture/BlockCompression.h"
+#include "Common/JobSystem.h"
+#include "Texture/MipChain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	constexpr int BLOCK_PIXELS = 16;
+
+	// BC7 interpolation weights of 4 bit indices, in 1/64
+	constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	typedef float BlockColors[BLOCK_PIXELS][4];
+
+	void toFloat(const uint8_t* rgba, BlockColors& colors)
+	{
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				colors[p][c] = rgba[p * 4 + c];
+			}
+		}
+	}
+
+	float squaredError(const float* a, const float* b, int channels)
+	{
+		float error = 0;
+		for (int c = 0; c < channels; ++c)
+		{
+			error += (a[c] - b[c]) * (a[c] - b[c]);
+		}
+		return error;
+	}
+
+	// endpoints of the principal axis through the block colors
+	void fitEndpoints(const BlockColors& colors, int channels, float* e0, float* e1, float maxValue = 255.f)
+	{
+		float mean[4] = {};
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			for (int c = 0; c < channels; ++c)
+			{
+				mean[c] += colors[p][c] / BLOCK_PIXELS;
+			}
+		}
+
+		float covariance[4][4] = {};
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			for (int i = 0; i < channels; ++i)
+			{
+				for (int j = 0; j < channels; ++j)
+				{
+					covariance[i][j] += (colors[p][i] - mean[i]) * (colors[p][j] - mean[j]);
+				}
+			}
+		}
+
+		// power iteration, seeded with the channel of the largest variance
+		int seed = 0;
+		for (int c = 1; c < channels; ++c)
+		{
+			if (covariance[c][c] > covariance[seed][seed])
+			{
+				seed = c;
+			}
+		}
+
+		float axis[4] = {};
+		for (int c = 0; c < channels; ++c)
+		{
+			axis[c] = covariance[seed][c];
+		}
+
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0;
+			for (int i = 0; i < channels; ++i)
+			{
+				for (int j = 0; j < channels; ++j)
+				{
+					next[i] += covariance[i][j] * axis[j];
+				}
+				length = std::max(length, std::abs(next[i]));
+			}
+
+			if (length < 1e-6f)
+			{
+				break;
+			}
+
+			for (int c = 0; c < channels; ++c)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float lengthSq = 0;
+		for (int c = 0; c < channels; ++c)
+		{
+			lengthSq += axis[c] * axis[c];
+		}
+
+		// uniform block
+		if (lengthSq < 1e-12f)
+		{
+			std::copy(mean, mean + 4, e0);
+			std::copy(mean, mean + 4, e1);
+			return;
+		}
+
+		float minT = std::numeric_limits<float>::max();
+		float maxT = std::numeric_limits<float>::lowest();
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			float t = 0;
+			for (int c = 0; c < channels; ++c)
+			{
+				t += (colors[p][c] - mean[c]) * axis[c];
+			}
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		const float invLength = 1.f / lengthSq;
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] = std::clamp(mean[c] + axis[c] * minT * invLength, 0.f, maxValue);
+			e1[c] = std::clamp(mean[c] + axis[c] * maxT * invLength, 0.f, maxValue);
+		}
+	}
+
+	// least squares endpoints for fixed interpolation weights of e1,
+	// false if the weights do not separate the endpoints
+	bool refineEndpoints(const BlockColors& colors, int channels, const float* weights, float* e0, float* e1, float maxValue = 255.f)
+	{
+		float aa = 0;
+		float ab = 0;
+		float bb = 0;
+		float x0[4] = {};
+		float x1[4] = {};
+
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			const float b = weights[p];
+			const float a = 1.f - b;
+
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+
+			for (int c = 0; c < channels; ++c)
+			{
+				x0[c] += a * colors[p][c];
+				x1[c] += b * colors[p][c];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		for (int c = 0; c < channels; ++c)
+		{
+			e0[c] = std::clamp((bb * x0[c] - ab * x1[c]) / determinant, 0.f, maxValue);
+			e1[c] = std::clamp((aa * x1[c] - ab * x0[c]) / determinant, 0.f, maxValue);
+		}
+
+		return true;
+	}
+
+	uint16_t packRGB565(const float* color)
+	{
+		const int r = std::clamp(static_cast<int>(color[0] * 31.f / 255.f + .5f), 0, 31);
+		const int g = std::clamp(static_cast<int>(color[1] * 63.f / 255.f + .5f), 0, 63);
+		const int b = std::clamp(static_cast<int>(color[2] * 31.f / 255.f + .5f), 0, 31);
+
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRGB565(uint16_t packed, float* color)
+	{
+		const int r = (packed >> 11) & 31;
+		const int g = (packed >> 5) & 63;
+		const int b = packed & 31;
+
+		color[0] = static_cast<float>((r << 3) | (r >> 2));
+		color[1] = static_cast<float>((g << 2) | (g >> 4));
+		color[2] = static_cast<float>((b << 3) | (b >> 2));
+	}
+
+	// four color block, returns the error and the weight of
+	// the second stored endpoint per pixel
+	float encodeColorBlock(const BlockColors& colors, const float* e0, const float* e1, uint8_t* out, float* weights)
+	{
+		constexpr float INDEX_WEIGHTS[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+
+		uint16_t c0 = packRGB565(e0);
+		uint16_t c1 = packRGB565(e1);
+
+		// c0 > c1 selects the four color mode in BC1
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+		}
+
+		float palette[4][3];
+		unpackRGB565(c0, palette[0]);
+		unpackRGB565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2.f * palette[0][c] + palette[1][c]) / 3.f;
+			palette[3][c] = (palette[0][c] + 2.f * palette[1][c]) / 3.f;
+		}
+
+		uint32_t indices = 0;
+		float error = 0;
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			int best = 0;
+			float bestError = squaredError(colors[p], palette[0], 3);
+
+			// equal endpoints leave all indices at 0
+			for (int i = 1; i < 4 && c0 != c1; ++i)
+			{
+				const float candidate = squaredError(colors[p], palette[i], 3);
+				if (candidate < bestError)
+				{
+					best = i;
+					bestError = candidate;
+				}
+			}
+
+			indices |= static_cast<uint32_t>(best) << (2 * p);
+			weights[p] = INDEX_WEIGHTS[best];
+			error += bestError;
+		}
+
+		out[0] = static_cast<uint8_t>(c0 & 0xff);
+		out[1] = static_cast<uint8_t>(c0 >> 8);
+		out[2] = static_cast<uint8_t>(c1 & 0xff);
+		out[3] = static_cast<uint8_t>(c1 >> 8);
+		for (int i = 0; i < 4; ++i)
+		{
+			out[4 + i] = static_cast<uint8_t>((indices >> (8 * i)) & 0xff);
+		}
+
+		return error;
+	}
+
+	void encodeColor(const BlockColors& colors, uint8_t* out)
+	{
+		float e0[4];
+		float e1[4];
+		fitEndpoints(colors, 3, e0, e1);
+
+		float weights[BLOCK_PIXELS];
+		const float error = encodeColorBlock(colors, e0, e1, out, weights);
+
+		// one least squares pass on the chosen indices
+		uint8_t refined[8];
+		float refinedWeights[BLOCK_PIXELS];
+		if (refineEndpoints(colors, 3, weights, e0, e1) &&
+			encodeColorBlock(colors, e0, e1, refined, refinedWeights) < error)
+		{
+			std::memcpy(out, refined, sizeof(refined));
+		}
+	}
+
+	// eight value mode of BC4, also the alpha block of BC3
+	void encodeChannel(const uint8_t* rgba, int channel, uint8_t* out)
+	{
+		int minValue = 255;
+		int maxValue = 0;
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			minValue = std::min<int>(minValue, rgba[p * 4 + channel]);
+			maxValue = std::max<int>(maxValue, rgba[p * 4 + channel]);
+		}
+
+		std::memset(out, 0, 8);
+		out[0] = static_cast<uint8_t>(maxValue);
+		out[1] = static_cast<uint8_t>(minValue);
+
+		if (maxValue == minValue)
+		{
+			return;
+		}
+
+		int palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int i = 2; i < 8; ++i)
+		{
+			palette[i] = ((8 - i) * maxValue + (i - 1) * minValue + 3) / 7;
+		}
+
+		uint64_t indices = 0;
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			const int value = rgba[p * 4 + channel];
+
+			int best = 0;
+			for (int i = 1; i < 8; ++i)
+			{
+				if (std::abs(palette[i] - value) < std::abs(palette[best] - value))
+				{
+					best = i;
+				}
+			}
+
+			indices |= static_cast<uint64_t>(best) << (3 * p);
+		}
+
+		for (int i = 0; i < 6; ++i)
+		{
+			out[2 + i] = static_cast<uint8_t>((indices >> (8 * i)) & 0xff);
+		}
+	}
+
+	struct BitWriter
+	{
+		uint8_t* out;
+		int position;
+
+		// least significant bit first
+		void write(uint32_t value, int bits)
+		{
+			for (int b = 0; b < bits; ++b, ++position)
+			{
+				if ((value >> b) & 1)
+				{
+					out[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+				}
+			}
+		}
+	};
+
+	// 7 bit endpoint with the shared lsb chosen by the error
+	void quantizeEndpoint(const float* endpoint, int* quantized, int& pbit)
+	{
+		float bestError = std::numeric_limits<float>::max();
+		for (int p = 0; p < 2; ++p)
+		{
+			int candidate[4];
+			float error = 0;
+			for (int c = 0; c < 4; ++c)
+			{
+				candidate[c] = std::clamp(static_cast<int>(std::floor((endpoint[c] - p) * .5f + .5f)), 0, 127);
+
+				const float reconstructed = static_cast<float>((candidate[c] << 1) | p);
+				error += (reconstructed - endpoint[c]) * (reconstructed - endpoint[c]);
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				std::copy(candidate, candidate + 4, quantized);
+				pbit = p;
+			}
+		}
+	}
+
+	float encodeMode6(const BlockColors& colors, const float* e0, const float* e1, uint8_t* out, float* weights)
+	{
+		int q0[4];
+		int q1[4];
+		int p0 = 0;
+		int p1 = 0;
+		quantizeEndpoint(e0, q0, p0);
+		quantizeEndpoint(e1, q1, p1);
+
+		float palette[16][4];
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				const int a = (q0[c] << 1) | p0;
+				const int b = (q1[c] << 1) | p1;
+				palette[i][c] = static_cast<float>(((64 - BC7_WEIGHTS[i]) * a + BC7_WEIGHTS[i] * b + 32) >> 6);
+			}
+		}
+
+		int indices[BLOCK_PIXELS];
+		float error = 0;
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			indices[p] = 0;
+			float bestError = squaredError(colors[p], palette[0], 4);
+			for (int i = 1; i < 16; ++i)
+			{
+				const float candidate = squaredError(colors[p], palette[i], 4);
+				if (candidate < bestError)
+				{
+					indices[p] = i;
+					bestError = candidate;
+				}
+			}
+			error += bestError;
+		}
+
+		// the msb of the first index is implicitly zero
+		if (indices[0] & 8)
+		{
+			std::swap(q0, q1);
+			std::swap(p0, p1);
+			for (int& index : indices)
+			{
+				index = 15 - index;
+			}
+		}
+
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			weights[p] = BC7_WEIGHTS[indices[p]] / 64.f;
+		}
+
+		std::memset(out, 0, 16);
+		BitWriter writer = { out, 0 };
+		writer.write(1 << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.write(q0[c], 7);
+			writer.write(q1[c], 7);
+		}
+		writer.write(p0, 1);
+		writer.write(p1, 1);
+
+		writer.write(indices[0], 3);
+		for (int p = 1; p < BLOCK_PIXELS; ++p)
+		{
+			writer.write(indices[p], 4);
+		}
+
+		return error;
+	}
+
+	// largest finite unsigned half, BC6H interpolates the half bit patterns
+	constexpr float BC6H_MAX = 31743.f;
+
+	// 10 bit endpoint whose unquantized value ends up as q * 31 + 15
+	int quantizeBC6H(float value)
+	{
+		return std::clamp(static_cast<int>((value - 15.f) / 31.f + .5f), 0, 1023);
+	}
+
+	int unquantizeBC6H(int quantized)
+	{
+		if (quantized == 0)
+		{
+			return 0;
+		}
+		if (quantized == 1023)
+		{
+			return 0xffff;
+		}
+		return ((quantized << 16) + 0x8000) >> 10;
+	}
+
+	// single region with 10.10.10 endpoints and 4 bit indices,
+	// returns the error and the weight of e1 per pixel
+	float encodeMode11(const BlockColors& colors, const float* e0, const float* e1, uint8_t* out, float* weights)
+	{
+		int q0[3];
+		int q1[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			q0[c] = quantizeBC6H(e0[c]);
+			q1[c] = quantizeBC6H(e1[c]);
+		}
+
+		float palette[16][4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				const int a = unquantizeBC6H(q0[c]);
+				const int b = unquantizeBC6H(q1[c]);
+				const int interpolated = ((64 - BC7_WEIGHTS[i]) * a + BC7_WEIGHTS[i] * b + 32) >> 6;
+				palette[i][c] = static_cast<float>((interpolated * 31) >> 6);
+			}
+		}
+
+		int indices[BLOCK_PIXELS];
+		float error = 0;
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			indices[p] = 0;
+			float bestError = squaredError(colors[p], palette[0], 3);
+			for (int i = 1; i < 16; ++i)
+			{
+				const float candidate = squaredError(colors[p], palette[i], 3);
+				if (candidate < bestError)
+				{
+					indices[p] = i;
+					bestError = candidate;
+				}
+			}
+			error += bestError;
+		}
+
+		// the msb of the first index is implicitly zero
+		if (indices[0] & 8)
+		{
+			std::swap(q0, q1);
+			for (int& index : indices)
+			{
+				index = 15 - index;
+			}
+		}
+
+		for (int p = 0; p < BLOCK_PIXELS; ++p)
+		{
+			weights[p] = BC7_WEIGHTS[indices[p]] / 64.f;
+		}
+
+		std::memset(out, 0, 16);
+		BitWriter writer = { out, 0 };
+		writer.write(0x03, 5);
+		for (int c = 0; c < 3; ++c)
+		{
+			writer.write(q0[c], 10);
+		}
+		for (int c = 0; c < 3; ++c)
+		{
+			writer.write(q1[c], 10);
+		}
+
+		writer.write(indices[0], 3);
+		for (int p = 1; p < BLOCK_PIXELS; ++p)
+		{
+			writer.write(indices[p], 4);
+		}
+
+		return error;
+	}
+
+	// gathers 4x4 blocks of four components from every level, missing
+	// components are filled with the defaults, block rows are spread over the job system
+	template<typename Component>
+	MipChainUPtr encodeLevels(const MipChain& source, TextureFormat target, int channels,
+		const Component* defaults, void (*encode)(const Component*, uint8_t*))
+	{
+		MipChainUPtr result = std::make_unique<MipChain>(
+			target, source.width(), source.height(), source.levelCount() > 1);
+
+		const size_t blockSize = MipChain::blockSize(target);
+
+		for (int level = 0; level < source.levelCount(); ++level)
+		{
+			const int width = source.level(level).width;
+			const int height = source.level(level).height;
+			const int blocksX = (width + 3) / 4;
+			const int blocksY = (height + 3) / 4;
+
+			const Component* pixels = reinterpret_cast<const Component*>(source.data(level));
+			uint8_t* blocks = result->data(level);
+
+			JobSystem::instance().parallelFor(static_cast<size_t>(blocksY), [&](size_t by) {
+				Component rgba[BLOCK_PIXELS * 4];
+
+				for (int bx = 0; bx < blocksX; ++bx)
+				{
+					// partial blocks repeat the last row and column
+					for (int y = 0; y < 4; ++y)
+					{
+						const int sy = std::min(static_cast<int>(by) * 4 + y, height - 1);
+						for (int x = 0; x < 4; ++x)
+						{
+							const int sx = std::min(bx * 4 + x, width - 1);
+
+							const Component* pixel = pixels + (static_cast<size_t>(sy) * width + sx) * channels;
+							Component* texel = rgba + (y * 4 + x) * 4;
+
+							for (int c = 0; c < 4; ++c)
+							{
+								texel[c] = c < channels ? pixel[c] : defaults[c];
+							}
+						}
+					}
+
+					encode(rgba, blocks + (by * blocksX + bx) * blockSize);
+				}
+			});
+		}
+
+		return result;
+	}
+}
+
+void BlockCompression::encodeBC1(const uint8_t* rgba, uint8_t* out)
+{
+	BlockColors colors;
+	toFloat(rgba, colors);
+
+	encodeColor(colors, out);
+}
+
+void BlockCompression::encodeBC3(const uint8_t* rgba, uint8_t* out)
+{
+	BlockColors colors;
+	toFloat(rgba, colors);
+
+	encodeChannel(rgba, 3, out);
+	encodeColor(colors, out + 8);
+}
+
+void BlockCompression::encodeBC4(const uint8_t* rgba, uint8_t* out)
+{
+	encodeChannel(rgba, 0, out);
+}
+
+void BlockCompression::encodeBC5(const uint8_t* rgba, uint8_t* out)
+{
+	encodeChannel(rgba, 0, out);
+	encodeChannel(rgba, 1, out + 8);
+}
+
+void BlockCompression::encodeBC7(const uint8_t* rgba, uint8_t* out)
+{
+	BlockColors colors;
+	toFloat(rgba, colors);
+
+	float e0[4];
+	float e1[4];
+	fitEndpoints(colors, 4, e0, e1);
+
+	float weights[BLOCK_PIXELS];
+	const float error = encodeMode6(colors, e0, e1, out, weights);
+
+	uint8_t refined[16];
+	float refinedWeights[BLOCK_PIXELS];
+	if (refineEndpoints(colors, 4, weights, e0, e1) &&
+		encodeMode6(colors, e0, e1, refined, refinedWeights) < error)
+	{
+		std::memcpy(out, refined, sizeof(refined));
+	}
+}
+
+void BlockCompression::encodeBC6H(const uint16_t* rgba, uint8_t* out)
+{
+	// negative values are not representable, infinity and NaN are clamped
+	BlockColors colors;
+	for (int p = 0; p < BLOCK_PIXELS; ++p)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			const uint16_t half = rgba[p * 4 + c];
+			colors[p][c] = (half & 0x8000) ? 0.f : std::min(static_cast<float>(half), BC6H_MAX);
+		}
+		colors[p][3] = 0;
+	}
+
+	float e0[4];
+	float e1[4];
+	fitEndpoints(colors, 3, e0, e1, BC6H_MAX);
+
+	float weights[BLOCK_PIXELS];
+	const float error = encodeMode11(colors, e0, e1, out, weights);
+
+	uint8_t refined[16];
+	float refinedWeights[BLOCK_PIXELS];
+	if (refineEndpoints(colors, 3, weights, e0, e1, BC6H_MAX) &&
+		encodeMode11(colors, e0, e1, refined, refinedWeights) < error)
+	{
+		std::memcpy(out, refined, sizeof(refined));
+	}
+}
+
+MipChainUPtr BlockCompression::compress(const MipChain& source, TextureFormat target)
+{
+	// BC6H encodes half float sources, all other formats 8 bit ones
+	if (target == TextureFormat::BC6H)
+	{
+		int channels = 0;
+		switch (source.format())
+		{
+		case TextureFormat::RGBHalf:	channels = 3; break;
+		case TextureFormat::RGBAHalf:	channels = 4; break;
+		default:
+			return nullptr;
+		}
+
+		const uint16_t opaque[4] = { 0, 0, 0, 0x3c00 };
+		return encodeLevels(source, target, channels, opaque, &encodeBC6H);
+	}
+
+	int channels = 0;
+	switch (source.format())
+	{
+	case TextureFormat::R:		channels = 1; break;
+	case TextureFormat::RG:		channels = 2; break;
+	case TextureFormat::RGB:
+	case TextureFormat::SRGB:	channels = 3; break;
+	case TextureFormat::RGBA:
+	case TextureFormat::SRGBA:	channels = 4; break;
+	default:
+		return nullptr;
+	}
+
+	void (*encode)(const uint8_t*, uint8_t*) = nullptr;
+	switch (target)
+	{
+	case TextureFormat::BC1:
+	case TextureFormat::BC1SRGB:	encode = &encodeBC1; break;
+	case TextureFormat::BC3:
+	case TextureFormat::BC3SRGB:	encode = &encodeBC3; break;
+	case TextureFormat::BC4:		encode = &encodeBC4; break;
+	case TextureFormat::BC5:		encode = &encodeBC5; break;
+	case TextureFormat::BC7:
+	case TextureFormat::BC7SRGB:	encode = &encodeBC7; break;
+	default:
+		return nullptr;
+	}
+
+	const uint8_t opaque[4] = { 0, 0, 0, 255 };
+	return encodeLevels(source, target, channels, opaque, encode);
+}
@@ -1,4 +1,7 @@
 #include "Texture/Cubemap.h"
+#include "Texture/MipChain.h"
+
+#include <algorithm>
 
 Cubemap::Cubemap(int width, TextureFormat format, TextureSampler sampler)
     : m_width(width)
@@ -53,7 +56,33 @@ SharedResource::Handle Cubemap::handle() const
     }
 }
 
+SharedResource::Handle Cubemap::samplerHandle() const
+{
+    if (m_linkedResource)
+    {
+        return m_linkedResource->sampler();
+    }
+    else
+    {
+        return SharedResource::INVALID_HANDLE;
+    }
+}
+
 void Cubemap::link(ITextureResourceUPtr resource)
 {
     m_linkedResource = std::move(resource);
 }
+
+int Cubemap::levelCount() const
+{
+    return m_sampler.mipmapping ? MipChain::maxLevelCount(m_width, m_width) : 1;
+}
+
+void Cubemap::updateLevel(int level, const void* data)
+{
+    if (m_linkedResource)
+    {
+        const int width = std::max(1, m_width >> level);
+        m_linkedResource->updateLevel(level, width, width, data);
+    }
+}
@@ -0,0 +1,226 @@
+#include "Texture/FloatPacking.h"
+#include "Common/JobSystem.h"
+#include "Texture/MipChain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// MSVC only defines __AVX2__, every AVX2 target supports F16C
+#if defined(__F16C__) || defined(__AVX2__)
+#define FLOAT_PACKING_F16C
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// rows per job
+	constexpr size_t ROW_GRAIN = 16;
+
+	// largest value of the shared exponent format, (2^9 - 1) / 2^9 * 2^16
+	constexpr float RGB9E5_MAX = 65408.f;
+
+	int floatComponents(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::RFloat:		return 1;
+		case TextureFormat::RGFloat:	return 2;
+		case TextureFormat::RGBFloat:	return 3;
+		case TextureFormat::RGBAFloat:	return 4;
+		default:						return 0;
+		}
+	}
+
+	int halfComponents(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::RHalf:		return 1;
+		case TextureFormat::RGHalf:		return 2;
+		case TextureFormat::RGBHalf:	return 3;
+		case TextureFormat::RGBAHalf:	return 4;
+		default:						return 0;
+		}
+	}
+}
+
+uint16_t FloatPacking::toHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	bits &= 0x7fffffff;
+
+	// infinity and NaN
+	if (bits >= 0x7f800000)
+	{
+		return sign | 0x7c00 | (bits > 0x7f800000 ? 0x200 : 0);
+	}
+
+	// rounds to infinity from 65520 on
+	if (bits >= 0x477ff000)
+	{
+		return sign | 0x7c00;
+	}
+
+	// denormals are multiples of 2^-24
+	if (bits < 0x38800000)
+	{
+		return sign | static_cast<uint16_t>(std::nearbyint(std::abs(value) * 16777216.f));
+	}
+
+	// rebias the exponent from 127 to 15 and round the dropped 13 bits
+	bits += 0xc8000000;
+	bits += 0xfff + ((bits >> 13) & 1);
+
+	return sign | static_cast<uint16_t>(bits >> 13);
+}
+
+float FloatPacking::fromHalf(uint16_t value)
+{
+	const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1f;
+	const uint32_t mantissa = value & 0x3ff;
+
+	if (exponent == 0)
+	{
+		const float denormal = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign ? -denormal : denormal;
+	}
+
+	const uint32_t bits = exponent == 31 ?
+		sign | 0x7f800000 | (mantissa << 13) :
+		sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void FloatPacking::toHalf(const float* source, uint16_t* target, size_t count)
+{
+	size_t i = 0;
+
+#ifdef FLOAT_PACKING_F16C
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 values = _mm256_loadu_ps(source + i);
+		const __m128i halfs = _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), halfs);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		target[i] = toHalf(source[i]);
+	}
+}
+
+void FloatPacking::fromHalf(const uint16_t* source, float* target, size_t count)
+{
+	size_t i = 0;
+
+#ifdef FLOAT_PACKING_F16C
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m128i halfs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+		_mm256_storeu_ps(target + i, _mm256_cvtph_ps(halfs));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		target[i] = fromHalf(source[i]);
+	}
+}
+
+uint32_t FloatPacking::toRGB9E5(const float* rgb)
+{
+	// see EXT_texture_shared_exponent, NaN ends up as zero
+	float clamped[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		clamped[c] = rgb[c] > 0.f ? std::min(rgb[c], RGB9E5_MAX) : 0.f;
+	}
+
+	const float maxComponent = std::max({ clamped[0], clamped[1], clamped[2] });
+	if (maxComponent <= 0.f)
+	{
+		return 0;
+	}
+
+	// floor(log2(max)) is one below the exponent of frexp
+	int exponent = 0;
+	std::frexp(maxComponent, &exponent);
+	int sharedExponent = std::max(-16, exponent - 1) + 16;
+
+	if (std::floor(std::ldexp(maxComponent, 24 - sharedExponent) + .5f) >= 512.f)
+	{
+		++sharedExponent;
+	}
+
+	uint32_t packed = static_cast<uint32_t>(sharedExponent) << 27;
+	for (int c = 0; c < 3; ++c)
+	{
+		const uint32_t mantissa = std::min(511u,
+			static_cast<uint32_t>(std::floor(std::ldexp(clamped[c], 24 - sharedExponent) + .5f)));
+		packed |= mantissa << (9 * c);
+	}
+
+	return packed;
+}
+
+MipChainUPtr FloatPacking::pack(const MipChain& source, TextureFormat target)
+{
+	const bool isHalfSource = halfComponents(source.format()) > 0;
+	const int channels = isHalfSource ? halfComponents(source.format()) : floatComponents(source.format());
+
+	const bool isShared = target == TextureFormat::RGB9E5;
+	if (channels == 0 || (isShared ? channels < 3 : halfComponents(target) != channels))
+	{
+		return nullptr;
+	}
+
+	MipChainUPtr result = std::make_unique<MipChain>(
+		target, source.width(), source.height(), source.levelCount() > 1);
+
+	for (int level = 0; level < source.levelCount(); ++level)
+	{
+		const int width = source.level(level).width;
+		const int height = source.level(level).height;
+		const size_t rowCount = static_cast<size_t>(width) * channels;
+
+		const uint8_t* pixels = source.data(level);
+		uint8_t* packed = result->data(level);
+
+		JobSystem::instance().parallelFor(static_cast<size_t>(height), [&](size_t y) {
+			std::vector<float> row(rowCount);
+			if (isHalfSource)
+			{
+				fromHalf(reinterpret_cast<const uint16_t*>(pixels) + y * rowCount, row.data(), rowCount);
+			}
+			else
+			{
+				std::memcpy(row.data(), reinterpret_cast<const float*>(pixels) + y * rowCount, rowCount * sizeof(float));
+			}
+
+			if (isShared)
+			{
+				uint32_t* targetRow = reinterpret_cast<uint32_t*>(packed) + y * width;
+				for (int x = 0; x < width; ++x)
+				{
+					targetRow[x] = toRGB9E5(row.data() + static_cast<size_t>(x) * channels);
+				}
+			}
+			else
+			{
+				toHalf(row.data(), reinterpret_cast<uint16_t*>(packed) + y * rowCount, rowCount);
+			}
+		}, ROW_GRAIN);
+	}
+
+	return result;
+}
@@ -0,0 +1,183 @@
+#include "Texture/MipChain.h"
+#include "Common/MappedFile.h"
+
+#include <algorithm>
+
+MipChain::MipChain(TextureFormat format, int width, int height, bool mipmapped)
+	: MipChain(format, width, height, mipmapped, nullptr, 0)
+{
+}
+
+MipChain::MipChain(TextureFormat format, int width, int height, bool mipmapped, 
+	MappedFileSPtr mapping, size_t mappingOffset)
+	: m_format(format)
+	, m_mapping(mapping)
+	, m_mappingOffset(mappingOffset)
+{
+	const int count = mipmapped ? maxLevelCount(width, height) : 1;
+
+	size_t offset = 0;
+	m_levels.reserve(count);
+	for (int i = 0; i < count; ++i)
+	{
+		Level level;
+		level.width = std::max(1, width >> i);
+		level.height = std::max(1, height >> i);
+		level.offset = offset;
+		level.size = levelSize(format, level.width, level.height);
+
+		m_levels.push_back(level);
+		offset += level.size;
+	}
+
+	if (!m_mapping)
+	{
+		m_data.resize(offset);
+	}
+}
+
+TextureFormat MipChain::format() const
+{
+	return m_format;
+}
+
+int MipChain::width() const
+{
+	return m_levels.front().width;
+}
+
+int MipChain::height() const
+{
+	return m_levels.front().height;
+}
+
+int MipChain::levelCount() const
+{
+	return static_cast<int>(m_levels.size());
+}
+
+const MipChain::Level& MipChain::level(int index) const
+{
+	return m_levels[index];
+}
+
+uint8_t* MipChain::data(int level)
+{
+	// the mapping is read only
+	if (m_mapping)
+	{
+		const uint8_t* mapped = m_mapping->data() + m_mappingOffset;
+		m_data.assign(mapped, mapped + size());
+		m_mapping.reset();
+	}
+
+	return m_data.data() + m_levels[level].offset;
+}
+
+const uint8_t* MipChain::data(int level) const
+{
+	const uint8_t* base = m_mapping ? m_mapping->data() + m_mappingOffset : m_data.data();
+	return base + m_levels[level].offset;
+}
+
+bool MipChain::isMapped() const
+{
+	return m_mapping != nullptr;
+}
+
+size_t MipChain::size() const
+{
+	return m_levels.back().offset + m_levels.back().size;
+}
+
+int MipChain::levelForExtent(int maxExtent) const
+{
+	for (int i = 0; i < levelCount(); ++i)
+	{
+		if (std::max(m_levels[i].width, m_levels[i].height) <= maxExtent)
+		{
+			return i;
+		}
+	}
+	return levelCount() - 1;
+}
+
+int MipChain::maxLevelCount(int width, int height)
+{
+	int count = 1;
+	for (int extent = std::max(width, height); extent > 1; extent >>= 1)
+	{
+		++count;
+	}
+	return count;
+}
+
+size_t MipChain::pixelSize(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::R:			return 1;
+	case TextureFormat::RG:			return 2;
+	case TextureFormat::RGB:
+	case TextureFormat::SRGB:		return 3;
+	case TextureFormat::RGBA:
+	case TextureFormat::SRGBA:		return 4;
+	case TextureFormat::RHalf:		return 2;
+	case TextureFormat::RGHalf:		return 4;
+	case TextureFormat::RGBHalf:	return 6;
+	case TextureFormat::RGBAHalf:	return 8;
+	case TextureFormat::RFloat:		return 4;
+	case TextureFormat::RGFloat:	return 8;
+	case TextureFormat::RGBFloat:	return 12;
+	case TextureFormat::RGBAFloat:	return 16;
+	case TextureFormat::RGB9E5:		return 4;
+	default:						return 4;
+	}
+}
+
+bool MipChain::isCompressed(TextureFormat format)
+{
+	return blockSize(format) > 0;
+}
+
+size_t MipChain::blockSize(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+	case TextureFormat::BC1SRGB:
+	case TextureFormat::BC4:		return 8;
+	case TextureFormat::BC3:
+	case TextureFormat::BC3SRGB:
+	case TextureFormat::BC5:
+	case TextureFormat::BC7:
+	case TextureFormat::BC7SRGB:
+	case TextureFormat::BC6H:		return 16;
+	default:						return 0;
+	}
+}
+
+size_t MipChain::levelSize(TextureFormat format, int width, int height)
+{
+	const size_t block = blockSize(format);
+	if (block > 0)
+	{
+		// partial blocks at the border are padded
+		return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * block;
+	}
+
+	return static_cast<size_t>(width) * height * pixelSize(format);
+}
+
+size_t MipChain::storageSize(TextureFormat format, int width, int height, bool mipmapped)
+{
+	const int count = mipmapped ? maxLevelCount(width, height) : 1;
+
+	size_t size = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		size += levelSize(format, std::max(1, width >> i), std::max(1, height >> i));
+	}
+
+	return size;
+}
@@ -0,0 +1,347 @@
+#include "Texture/MipmapGenerator.h"
+#include "Common/JobSystem.h"
+#include "Texture/FloatPacking.h"
+#include "Texture/MipChain.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// half width of the filter in target pixels
+	constexpr float FILTER_RADIUS = 1.5f;
+
+	constexpr float KAISER_ALPHA = 4.f;
+
+	constexpr float PI = 3.14159265358979f;
+
+	// rows per job
+	constexpr size_t ROW_GRAIN = 16;
+
+	// (source index, weight) pairs of every target pixel along one axis
+	typedef std::vector<std::vector<std::pair<int, float>>> FilterTaps;
+
+	float besselI0(float x)
+	{
+		float sum = 1.f;
+		float term = 1.f;
+		for (int k = 1; k < 20; ++k)
+		{
+			term *= (x * .5f / k) * (x * .5f / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	float kaiserSinc(float t)
+	{
+		const float ratio = t / FILTER_RADIUS;
+		if (std::abs(ratio) >= 1.f)
+		{
+			return 0.f;
+		}
+
+		const float sinc = t == 0.f ? 1.f : std::sin(PI * t) / (PI * t);
+		const float window = besselI0(KAISER_ALPHA * std::sqrt(1.f - ratio * ratio)) / besselI0(KAISER_ALPHA);
+
+		return sinc * window;
+	}
+
+	FilterTaps computeTaps(int sourceSize, int targetSize, bool wrap)
+	{
+		const float scale = static_cast<float>(sourceSize) / targetSize;
+		const float support = FILTER_RADIUS * scale;
+
+		FilterTaps taps(targetSize);
+		for (int x = 0; x < targetSize; ++x)
+		{
+			const float center = (x + .5f) * scale;
+			const int first = static_cast<int>(std::floor(center - support));
+			const int last = static_cast<int>(std::ceil(center + support));
+
+			float sum = 0.f;
+			for (int j = first; j <= last; ++j)
+			{
+				const float weight = kaiserSinc(((j + .5f) - center) / scale);
+				if (weight == 0.f)
+				{
+					continue;
+				}
+
+				const int index = wrap ? 
+					((j % sourceSize) + sourceSize) % sourceSize : 
+					std::clamp(j, 0, sourceSize - 1);
+
+				taps[x].emplace_back(index, weight);
+				sum += weight;
+			}
+
+			for (auto& tap : taps[x])
+			{
+				tap.second /= sum;
+			}
+		}
+
+		return taps;
+	}
+
+	int componentCount(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::R:
+		case TextureFormat::RHalf:
+		case TextureFormat::RFloat:		return 1;
+		case TextureFormat::RG:
+		case TextureFormat::RGHalf:
+		case TextureFormat::RGFloat:	return 2;
+		case TextureFormat::RGB:
+		case TextureFormat::SRGB:
+		case TextureFormat::RGBHalf:
+		case TextureFormat::RGBFloat:	return 3;
+		case TextureFormat::RGBA:
+		case TextureFormat::SRGBA:
+		case TextureFormat::RGBAHalf:
+		case TextureFormat::RGBAFloat:	return 4;
+		default:						return 0;
+		}
+	}
+
+	bool isFloatFormat(TextureFormat format)
+	{
+		return format == TextureFormat::RFloat || format == TextureFormat::RGFloat ||
+			format == TextureFormat::RGBFloat || format == TextureFormat::RGBAFloat;
+	}
+
+	bool isHalfFormat(TextureFormat format)
+	{
+		return format == TextureFormat::RHalf || format == TextureFormat::RGHalf ||
+			format == TextureFormat::RGBHalf || format == TextureFormat::RGBAHalf;
+	}
+
+	float srgbToLinear(float value)
+	{
+		return value <= .04045f ? value / 12.92f : std::pow((value + .055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float value)
+	{
+		return value <= .0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - .055f;
+	}
+
+	// fraction of pixels passing the alpha test with scaled alpha
+	float alphaCoverage(const std::vector<float>& pixels, float cutoff, float scale)
+	{
+		size_t passed = 0;
+		for (size_t i = 3; i < pixels.size(); i += 4)
+		{
+			if (pixels[i] * scale > cutoff)
+			{
+				++passed;
+			}
+		}
+		return static_cast<float>(passed) / (pixels.size() / 4);
+	}
+
+	void renormalize(std::vector<float>& pixels, int channels)
+	{
+		for (size_t i = 0; i < pixels.size(); i += channels)
+		{
+			float* texel = &pixels[i];
+			if (channels == 2)
+			{
+				// z is reconstructed on sampling, xy must stay inside the unit circle
+				const float x = texel[0] * 2.f - 1.f;
+				const float y = texel[1] * 2.f - 1.f;
+				const float length = std::sqrt(x * x + y * y);
+				if (length > 1.f)
+				{
+					texel[0] = (x / length) * .5f + .5f;
+					texel[1] = (y / length) * .5f + .5f;
+				}
+				continue;
+			}
+
+			float n[3] = { texel[0] * 2.f - 1.f, texel[1] * 2.f - 1.f, texel[2] * 2.f - 1.f };
+			const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length < 1e-6f)
+			{
+				n[0] = 0.f;
+				n[1] = 0.f;
+				n[2] = 1.f;
+			}
+			else
+			{
+				for (float& c : n)
+				{
+					c /= length;
+				}
+			}
+
+			for (int c = 0; c < 3; ++c)
+			{
+				texel[c] = n[c] * .5f + .5f;
+			}
+		}
+	}
+}
+
+bool MipmapGenerator::generate(MipChain& mips, const Settings& settings)
+{
+	const TextureFormat format = mips.format();
+	const int channels = componentCount(format);
+	if (channels == 0)
+	{
+		return false;
+	}
+
+	const bool isFloat = isFloatFormat(format);
+	const bool isHalf = isHalfFormat(format);
+	const bool sRGB = format == TextureFormat::SRGB || format == TextureFormat::SRGBA;
+	const bool hasAlpha = channels == 4 && settings.alphaCutoff > 0.f;
+
+	// color channels of sRGB images are filtered in linear space
+	std::array<float, 256> unormToFloat;
+	std::array<float, 256> srgbToFloat;
+	for (int i = 0; i < 256; ++i)
+	{
+		unormToFloat[i] = i / 255.f;
+		srgbToFloat[i] = srgbToLinear(i / 255.f);
+	}
+
+	std::vector<float> source(static_cast<size_t>(mips.width()) * mips.height() * channels);
+	if (isFloat)
+	{
+		std::copy_n(reinterpret_cast<const float*>(mips.data(0)), source.size(), source.begin());
+	}
+	else if (isHalf)
+	{
+		FloatPacking::fromHalf(reinterpret_cast<const uint16_t*>(mips.data(0)), source.data(), source.size());
+	}
+	else
+	{
+		const uint8_t* bytes = mips.data(0);
+		for (size_t i = 0; i < source.size(); ++i)
+		{
+			const bool color = sRGB && static_cast<int>(i % channels) < 3;
+			source[i] = color ? srgbToFloat[bytes[i]] : unormToFloat[bytes[i]];
+		}
+	}
+
+	const float targetCoverage = hasAlpha ? alphaCoverage(source, settings.alphaCutoff, 1.f) : 0.f;
+
+	std::vector<float> filtered;
+	std::vector<float> output;
+
+	for (int level = 1; level < mips.levelCount(); ++level)
+	{
+		const int sourceWidth = mips.level(level - 1).width;
+		const int sourceHeight = mips.level(level - 1).height;
+		const int width = mips.level(level).width;
+		const int height = mips.level(level).height;
+
+		const FilterTaps horizontalTaps = computeTaps(sourceWidth, width, settings.wrap);
+		const FilterTaps verticalTaps = computeTaps(sourceHeight, height, settings.wrap);
+
+		// separable, horizontal into the intermediate then vertical
+		std::vector<float> intermediate(static_cast<size_t>(sourceHeight) * width * channels);
+		JobSystem::instance().parallelFor(static_cast<size_t>(sourceHeight), [&](size_t y) {
+			const float* sourceRow = source.data() + y * sourceWidth * channels;
+			float* targetRow = intermediate.data() + y * width * channels;
+
+			for (int x = 0; x < width; ++x)
+			{
+				float* texel = targetRow + x * channels;
+				std::fill_n(texel, channels, 0.f);
+				for (const auto& [index, weight] : horizontalTaps[x])
+				{
+					const float* sample = sourceRow + index * channels;
+					for (int c = 0; c < channels; ++c)
+					{
+						texel[c] += sample[c] * weight;
+					}
+				}
+			}
+		}, ROW_GRAIN);
+
+		filtered.assign(static_cast<size_t>(height) * width * channels, 0.f);
+		JobSystem::instance().parallelFor(static_cast<size_t>(height), [&](size_t y) {
+			float* targetRow = filtered.data() + y * width * channels;
+
+			for (const auto& [index, weight] : verticalTaps[y])
+			{
+				const float* sourceRow = intermediate.data() + static_cast<size_t>(index) * width * channels;
+				for (int i = 0; i < width * channels; ++i)
+				{
+					targetRow[i] += sourceRow[i] * weight;
+				}
+			}
+		}, ROW_GRAIN);
+
+		// negative lobes may ring below zero
+		output = filtered;
+		for (float& value : output)
+		{
+			value = std::max(value, 0.f);
+		}
+
+		if (settings.normalMap && channels >= 2)
+		{
+			renormalize(output, channels);
+		}
+
+		// scales alpha until the level passes the test as often as level 0
+		if (hasAlpha)
+		{
+			float low = 0.f;
+			float high = 4.f;
+			for (int i = 0; i < 16; ++i)
+			{
+				const float scale = (low + high) * .5f;
+				if (alphaCoverage(output, settings.alphaCutoff, scale) < targetCoverage)
+				{
+					low = scale;
+				}
+				else
+				{
+					high = scale;
+				}
+			}
+
+			for (size_t i = 3; i < output.size(); i += 4)
+			{
+				output[i] = std::min(output[i] * high, 1.f);
+			}
+		}
+
+		if (isFloat)
+		{
+			std::copy(output.begin(), output.end(), reinterpret_cast<float*>(mips.data(level)));
+		}
+		else if (isHalf)
+		{
+			FloatPacking::toHalf(output.data(), reinterpret_cast<uint16_t*>(mips.data(level)), output.size());
+		}
+		else
+		{
+			uint8_t* bytes = mips.data(level);
+			for (size_t i = 0; i < output.size(); ++i)
+			{
+				float value = std::min(output[i], 1.f);
+				if (sRGB && static_cast<int>(i % channels) < 3)
+				{
+					value = linearToSrgb(value);
+				}
+				bytes[i] = static_cast<uint8_t>(value * 255.f + .5f);
+			}
+		}
+
+		// the unscaled, unclamped level feeds the next one
+		source.swap(filtered);
+	}
+
+	return true;
+}
@@ -1,4 +1,7 @@
 #include "Texture/Texture2D.h"
+#include "Texture/MipChain.h"
+
+#include <algorithm>
 
 Texture2D::Texture2D(int width, int height, TextureFormat format,
 	TextureSampler sampler)
@@ -24,10 +27,8 @@ void Texture2D::resize(int width, int height)
 	m_width = width;
 	m_height = height;
 
-	if (m_linkedResource)
-	{
-		m_linkedResource->update(m_width, m_height, nullptr);
-	}
+	// the storage is immutable, the next allocation matches the new size
+	m_linkedResource.reset();
 }
 
 TextureLayout Texture2D::layout() const
@@ -37,12 +38,12 @@ TextureLayout Texture2D::layout() const
 
 int Texture2D::width() const
 {
-	return m_width;
+	return m_sharedTexture ? m_sharedTexture->width() : m_width;
 }
 
 int Texture2D::height() const
 {
-	return m_height;
+	return m_sharedTexture ? m_sharedTexture->height() : m_height;
 }
 
 int Texture2D::layers() const
@@ -52,7 +53,7 @@ int Texture2D::layers() const
 
 TextureFormat Texture2D::format() const
 {
-	return m_format;
+	return m_sharedTexture ? m_sharedTexture->format() : m_format;
 }
 
 const TextureSampler& Texture2D::sampler() const
@@ -63,6 +64,13 @@ const TextureSampler& Texture2D::sampler() const
 void Texture2D::link(ITextureResourceUPtr resource)
 {
 	m_linkedResource = std::move(resource);
+
+	// the resource counts its levels from the storage level
+	const int base = std::max(m_baseLevel, m_storageLevel) - m_storageLevel;
+	if (m_linkedResource && base != 0)
+	{
+		m_linkedResource->setBaseLevel(base);
+	}
 }
 
 void Texture2D::update(int width, int height, TextureFormat format)
@@ -70,13 +78,75 @@ void Texture2D::update(int width, int height, TextureFormat format)
 	m_width = width;
 	m_height = height;
 	m_format = format;
+	m_baseLevel = 0;
+	m_storageLevel = 0;
 
 	m_linkedResource.reset();
 }
 
+void Texture2D::updateLevel(int level, const void* data)
+{
+	if (m_linkedResource && level >= m_storageLevel)
+	{
+		m_linkedResource->updateLevel(level - m_storageLevel, 
+			std::max(1, m_width >> level), 
+			std::max(1, m_height >> level), 
+			data);
+	}
+}
+
+void Texture2D::generateMipmaps()
+{
+	if (m_linkedResource && m_sampler.mipmapping)
+	{
+		m_linkedResource->generateMipmaps();
+	}
+}
+
+int Texture2D::levelCount() const
+{
+	return m_sampler.mipmapping ? MipChain::maxLevelCount(width(), height()) : 1;
+}
+
+int Texture2D::baseLevel() const
+{
+	return m_baseLevel;
+}
+
+void Texture2D::setBaseLevel(int level)
+{
+	if (m_linkedResource && m_baseLevel != level)
+	{
+		m_linkedResource->setBaseLevel(std::max(level, m_storageLevel) - m_storageLevel);
+	}
+	m_baseLevel = level;
+}
+
+int Texture2D::storageLevel() const
+{
+	return m_storageLevel;
+}
+
+void Texture2D::setStorageLevel(int level)
+{
+	m_storageLevel = level;
+}
+
+void Texture2D::share(Texture2DSPtr source)
+{
+	// the source is streamed and reallocated on its own,
+	// its current storage is looked up on every access
+	m_sharedTexture = source;
+	m_linkedResource.reset();
+}
+
 SharedResource::Handle Texture2D::handle() const
 {
-	if (m_linkedResource)
+	if (m_sharedTexture)
+	{
+		return m_sharedTexture->handle();
+	}
+	else if (m_linkedResource)
 	{
 		return m_linkedResource->handle();
 	}
@@ -85,3 +155,19 @@ SharedResource::Handle Texture2D::handle() const
 		return SharedResource::INVALID_HANDLE;
 	}
 }
+
+SharedResource::Handle Texture2D::samplerHandle() const
+{
+	if (m_sharedTexture)
+	{
+		return m_sharedTexture->samplerHandle();
+	}
+	else if (m_linkedResource)
+	{
+		return m_linkedResource->sampler();
+	}
+	else
+	{
+		return SharedResource::INVALID_HANDLE;
+	}
+}
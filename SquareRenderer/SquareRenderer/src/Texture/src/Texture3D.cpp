@@ -0,0 +1,82 @@
+#include "Texture/Texture3D.h"
+
+Texture3D::Texture3D(int width, int height, int depth, TextureFormat format, TextureSampler sampler)
+	: m_width(width)
+	, m_height(height)
+	, m_depth(depth)
+	, m_format(format)
+	, m_sampler(sampler)
+{
+	m_sampler.mipmapping = false;
+}
+
+Texture3D::~Texture3D()
+{
+}
+
+TextureFormat Texture3D::format() const
+{
+	return m_format;
+}
+
+const TextureSampler& Texture3D::sampler() const
+{
+	return m_sampler;
+}
+
+TextureLayout Texture3D::layout() const
+{
+	return TextureLayout::Texture3D;
+}
+
+int Texture3D::width() const
+{
+	return m_width;
+}
+
+int Texture3D::height() const
+{
+	return m_height;
+}
+
+int Texture3D::layers() const
+{
+	return m_depth;
+}
+
+SharedResource::Handle Texture3D::handle() const
+{
+	if (m_linkedResource)
+	{
+		return m_linkedResource->handle();
+	}
+	else
+	{
+		return SharedResource::INVALID_HANDLE;
+	}
+}
+
+SharedResource::Handle Texture3D::samplerHandle() const
+{
+	if (m_linkedResource)
+	{
+		return m_linkedResource->sampler();
+	}
+	else
+	{
+		return SharedResource::INVALID_HANDLE;
+	}
+}
+
+void Texture3D::link(ITextureResourceUPtr resource)
+{
+	m_linkedResource = std::move(resource);
+}
+
+void Texture3D::update(const void* data)
+{
+	if (m_linkedResource)
+	{
+		m_linkedResource->updateLevel(0, m_width, m_height, data);
+	}
+}
@@ -1,3 +1,4 @@
+#include "Common/JobSystem.h"
 #include "Common/Logger.h"
 #include "Common/Timer.h"
 #include "Common/Math3D.h"
@@ -11,7 +12,9 @@
 #include "GUI/StatisticsWidget.h"
 #include "GUI/RenderPassListWidget.h"
 #include "GUI/LightingWidget.h"
+#include "GUI/TextureResidencyWidget.h"
 
+#include "Preprocessor/IBLBaker.h"
 #include "Preprocessor/SceneImporter.h"
 #include "Preprocessor/MaterialImporter.h"
 #include "Preprocessor/TextureImporter.h"
@@ -20,11 +23,36 @@
 
 #include "Scene/Scene.h"
 
+#include "Texture/FloatPacking.h"
+#include "Texture/MipChain.h"
+
 #include "Renderer/RenderEngine.h"
 #include "Renderer/PerspectiveCamera.h"
+#include "Renderer/TextureResidencyManager.h"
 
 #include <iostream>
 
+// mean relative error per level between the rendered and the baked IBL
+constexpr float IBL_VERIFY_TOLERANCE = .02f;
+
+// writes the IBL cache of an HDRI without creating a graphics context,
+// decoded like the sky of the SceneImporter
+int bakeIBL(const std::string& hdriPath)
+{
+    TextureImporter importer(nullptr);
+    MipChainUPtr mips = importer.loadMipChain(hdriPath);
+    if (!mips || mips->format() != TextureFormat::RGBHalf)
+    {
+        Logger::Error("Could not decode HDRI '%s'", hdriPath.c_str());
+        return 1;
+    }
+
+    std::vector<float> pixels(static_cast<size_t>(mips->width()) * mips->height() * 3);
+    FloatPacking::fromHalf(reinterpret_cast<const uint16_t*>(mips->data()), pixels.data(), pixels.size());
+
+    return IBLBaker::bakeToCache(hdriPath, pixels.data(), mips->width(), mips->height()) ? 0 : 1;
+}
+
 int main(int argc, char* argv[])
 {
     // register console logger
@@ -38,7 +66,43 @@ int main(int argc, char* argv[])
         }
     );
 
-    const std::string inputScenePath = argc >= 2 ? std::string(argv[1]) : "scene_geo.yaml";
+    std::string inputScenePath = "scene_geo.yaml";
+
+    // image based lighting is precomputed on the CPU instead of rendered
+    bool cpuPrecomputation = false;
+
+    // HDRIs to bake without a window or to check against the GPU
+    std::string bakeIBLPath;
+    std::string verifyIBLPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--cpu-ibl")
+        {
+            cpuPrecomputation = true;
+        }
+        else if (arg == "--bake-ibl" && i + 1 < argc)
+        {
+            bakeIBLPath = argv[++i];
+        }
+        else if (arg == "--verify-ibl" && i + 1 < argc)
+        {
+            verifyIBLPath = argv[++i];
+        }
+        else
+        {
+            inputScenePath = arg;
+        }
+    }
+
+    // workers are started from the main thread, which executes the GL jobs
+    JobSystem& jobSystem = JobSystem::instance();
+
+    if (!bakeIBLPath.empty())
+    {
+        return bakeIBL(bakeIBLPath);
+    }
 
     GraphicsAPISPtr api = GraphicsAPI::create();
 
@@ -53,11 +117,29 @@ int main(int argc, char* argv[])
     }
 
     RenderEngineSPtr renderEngine = std::make_shared<RenderEngine>(api, matLib);
+    renderEngine->setCPUPrecomputation(cpuPrecomputation);
+
+    if (!verifyIBLPath.empty())
+    {
+        TextureImporter importer(api);
+        Texture2DSPtr hdri = importer.importFromFile(verifyIBLPath);
+        const bool matching = hdri && renderEngine->verifyCPUPrecomputation(hdri, IBL_VERIFY_TOLERANCE);
+
+        std::cout << "IBL check " << (matching ? "passed" : "failed") << std::endl;
+        return matching ? 0 : 1;
+    }
+
+    // streams the material textures during the first frames
+    TextureImporterSPtr textureImporter = std::make_shared<TextureImporter>(api);
+
+    // keeps only the visible mip levels of streamed textures in video memory
+    TextureResidencyManagerSPtr textureResidency = std::make_shared<TextureResidencyManager>(api, 512 * 1024 * 1024);
+    textureImporter->setResidencyManager(textureResidency);
 
     SceneSPtr scene;
     {
         ScopedTimerLog t("Scene import");
-        SceneImporter si(api, matLib, renderEngine);
+        SceneImporter si(api, matLib, renderEngine, textureImporter);
         scene = si.importFromFile(inputScenePath);
         //scene = si.importFromFile("scene_camera.yaml");
         //scene = si.importFromFile("scene_lantern.yaml");
@@ -73,8 +155,9 @@ int main(int argc, char* argv[])
 
     //renderEngine->setRenderingScale(1.0 / mainWindow->dpiScaling());
 
-    renderEngine->setScene(scene);
+    renderEngine->setScene(scene, inputScenePath);
     renderEngine->setMainCamera(camera);
+    renderEngine->setTextureResidency(textureResidency);
     
     renderEngine->setupGizmos("Debug.Line");
     renderEngine->setRenderTarget(mainWindow);
@@ -83,6 +166,7 @@ int main(int argc, char* argv[])
     mainWindow->addWidget(std::make_shared<StatisticsWidget>("Stats", mainWindow, renderEngine));
     mainWindow->addWidget(std::make_shared<RenderPassListWidget>("Render Passes", renderEngine));
     mainWindow->addWidget(std::make_shared<LightingWidget>("Lighting", scene));
+    mainWindow->addWidget(std::make_shared<TextureResidencyWidget>("Texture Residency", textureResidency));
 
     Timer frameTimer;
     while (mainWindow->isOpen())
@@ -94,6 +178,10 @@ int main(int argc, char* argv[])
                 
         // ------------------ update stuff -----------------------------
 
+        jobSystem.processMainThreadJobs();
+
+        textureImporter->update();
+
         mainWindow->update(deltaTime);
 
         renderEngine->update(deltaTime);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+// minimal assertions for the headless tests, a failed check ends the 
+// test executable with a non zero exit code
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::fprintf(stderr, "%s:%i: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			std::exit(EXIT_FAILURE); \
+		} \
+	} while (false)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do \
+	{ \
+		const double checkA = (a); \
+		const double checkB = (b); \
+		if (!(std::abs(checkA - checkB) <= (tolerance))) \
+		{ \
+			std::fprintf(stderr, "%s:%i: CHECK_NEAR(%s, %s) failed: %f != %f\n", \
+				__FILE__, __LINE__, #a, #b, checkA, checkB); \
+			std::exit(EXIT_FAILURE); \
+		} \
+	} while (false)
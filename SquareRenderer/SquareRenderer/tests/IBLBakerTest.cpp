@@ -0,0 +1,167 @@
+#include "Check.h"
+
+#include "Common/Hash.h"
+#include "Common/SphericalHarmonics.h"
+#include "Preprocessor/IBLBaker.h"
+#include "Preprocessor/IBLCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+constexpr float PI = 3.14159265358979f;
+
+// equirectangular image in upload order, the first row is the south pole
+std::vector<float> equirectangular(int width, int height, 
+	const std::function<glm::vec3(float)>& radianceAtHeight)
+{
+	std::vector<float> pixels(static_cast<size_t>(width) * height * 3);
+	for (int y = 0; y < height; ++y)
+	{
+		const float latitude = ((y + .5f) / height - .5f) * PI;
+		const glm::vec3 radiance = radianceAtHeight(std::sin(latitude));
+
+		for (int x = 0; x < width; ++x)
+		{
+			float* pixel = &pixels[(static_cast<size_t>(y) * width + x) * 3];
+			pixel[0] = radiance.x;
+			pixel[1] = radiance.y;
+			pixel[2] = radiance.z;
+		}
+	}
+	return pixels;
+}
+
+// small enough for a quick run, large enough for the roughness levels
+IBLBaker::Settings testSettings()
+{
+	IBLBaker::Settings settings;
+	settings.diffuseWidth = 8;
+	settings.diffuseSampleDelta = .025f;
+	settings.specularWidth = 16;
+	settings.specularMinSamples = 16;
+	settings.specularMaxSamples = 128;
+	settings.shWidth = 16;
+	return settings;
+}
+
+void checkLevels(const IBLCache::CubemapLevels& levels, int width, int levelCount,
+	const std::function<void(int, int, int, int, const float*)>& checkTexel)
+{
+	CHECK(levels.width == width);
+	CHECK(levels.levelCount == levelCount);
+
+	const std::vector<float> pixels = IBLBaker::toFloat(levels);
+	CHECK(!pixels.empty());
+
+	const float* texel = pixels.data();
+	for (int level = 0; level < levelCount; ++level)
+	{
+		const int levelWidth = std::max(1, width >> level);
+		for (int face = 0; face < 6; ++face)
+		{
+			for (int y = 0; y < levelWidth; ++y)
+			{
+				for (int x = 0; x < levelWidth; ++x, texel += 3)
+				{
+					checkTexel(level, face, x, y, texel);
+				}
+			}
+		}
+	}
+}
+
+// every convolution of a constant environment is the constant again
+void testConstantEnvironment()
+{
+	const glm::vec3 radiance(.5f, 1.f, 2.f);
+	const std::vector<float> pixels = equirectangular(128, 64, [&](float) { return radiance; });
+
+	const IBLBaker::Result result = IBLBaker::bake(pixels.data(), 128, 64, testSettings());
+
+	// the Riemann sum of the diffuse convolution starts at the pole
+	// and loses about a percent like Util/IBLDiffuse.frag
+	const auto isConstant = [&](float tolerance) {
+		return [&radiance, tolerance](int, int, int, int, const float* texel) {
+			for (int c = 0; c < 3; ++c)
+			{
+				CHECK_NEAR(texel[c], radiance[c], tolerance * radiance[c]);
+			}
+		};
+	};
+	checkLevels(result.diffuse, 8, 1, isConstant(.02f));
+	checkLevels(result.specular, 16, 5, isConstant(.005f));
+
+	const glm::vec3 sh = SphericalHarmonics::evaluate(result.irradianceSH, glm::vec3(0.f, 1.f, 0.f));
+	for (int c = 0; c < 3; ++c)
+	{
+		CHECK_NEAR(sh[c], radiance[c], .01f * radiance[c]);
+	}
+}
+
+// radiance a + b y is exact in L2, the diffuse cubemap has to match the SH
+void testGradientEnvironment()
+{
+	const glm::vec3 offset(1.f, 1.5f, 2.f);
+	const glm::vec3 gradient(.8f, -.5f, .3f);
+	const std::vector<float> pixels = equirectangular(128, 64, 
+		[&](float up) { return offset + gradient * up; });
+
+	const IBLBaker::Result result = IBLBaker::bake(pixels.data(), 128, 64, testSettings());
+
+	checkLevels(result.diffuse, 8, 1, [&](int, int face, int x, int y, const float* texel) {
+		const glm::vec3 normal = SphericalHarmonics::cubemapDirection(face, x, y, 8);
+		const glm::vec3 sh = SphericalHarmonics::evaluate(result.irradianceSH, normal);
+		const glm::vec3 analytic = offset + gradient * (2.f / 3.f * normal.y);
+
+		for (int c = 0; c < 3; ++c)
+		{
+			CHECK_NEAR(sh[c], analytic[c], .02f * analytic[c]);
+			CHECK_NEAR(texel[c], analytic[c], .03f * analytic[c]);
+		}
+	});
+}
+
+// the cache written without a context is found with the key of the engine
+void testCacheRoundTrip()
+{
+	const std::string sourcePath = "IBLBakerTest.hdr";
+	{
+		std::ofstream source(sourcePath, std::ios::binary | std::ios::trunc);
+		source << "stands in for the encoded image";
+	}
+
+	const IBLBaker::Settings settings = testSettings();
+	const std::vector<float> pixels = equirectangular(64, 32, [](float up) { return glm::vec3(1.f + up); });
+	CHECK(IBLBaker::bakeToCache(sourcePath, pixels.data(), 64, 32, settings));
+
+	std::ifstream source(sourcePath, std::ios::binary);
+	const std::string content((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+	const uint64_t key = IBLBaker::cacheKey(Hash::content(content.data(), content.size()), 16, settings);
+
+	IBLCache::CubemapLevels diffuse;
+	IBLCache::CubemapLevels specular;
+	SphericalHarmonics::Coefficients irradianceSH;
+	CHECK(IBLCache::read(IBLCache::cachePath(sourcePath), key, diffuse, specular, irradianceSH));
+	CHECK(!IBLCache::read(IBLCache::cachePath(sourcePath), key + 1, diffuse, specular, irradianceSH));
+
+	const IBLBaker::Result expected = IBLBaker::bake(pixels.data(), 64, 32, settings);
+	CHECK(diffuse.pixels == expected.diffuse.pixels);
+	CHECK(specular.pixels == expected.specular.pixels);
+
+	source.close();
+	std::remove(sourcePath.c_str());
+	std::remove(IBLCache::cachePath(sourcePath).c_str());
+}
+
+int main()
+{
+	testConstantEnvironment();
+	testGradientEnvironment();
+	testCacheRoundTrip();
+
+	return EXIT_SUCCESS;
+}
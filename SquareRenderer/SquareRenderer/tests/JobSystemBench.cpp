@@ -0,0 +1,72 @@
+#include "Common/JobSystem.h"
+#include "Common/Timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// fixed amount of floating point work per item, comparable to a texel
+// of the CPU IBL convolutions
+float work(size_t index)
+{
+	float value = static_cast<float>(index);
+	for (int i = 0; i < 2000; ++i)
+	{
+		value = std::sin(value) * 0.5f + std::sqrt(static_cast<float>(i + 1));
+	}
+	return value;
+}
+
+// without a job system the loop runs serially as the baseline
+double measureMs(JobSystem* jobs, std::vector<float>& results, size_t grainSize)
+{
+	Timer timer;
+	if (jobs)
+	{
+		jobs->parallelFor(results.size(), [&results](size_t i) { results[i] = work(i); }, grainSize);
+	}
+	else
+	{
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			results[i] = work(i);
+		}
+	}
+	return timer.elapsedMs();
+}
+
+double bestOfThree(JobSystem* jobs, std::vector<float>& results, size_t grainSize)
+{
+	double best = measureMs(jobs, results, grainSize);
+	best = std::min(best, measureMs(jobs, results, grainSize));
+	return std::min(best, measureMs(jobs, results, grainSize));
+}
+
+// parallelFor throughput from 1 to N cores against the serial loop
+int main(int argc, char** argv)
+{
+	const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	const size_t maxCores = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : hardwareThreads;
+
+	std::vector<float> results(1 << 14);
+	const double baseline = bestOfThree(nullptr, results, 1);
+
+	std::printf("cores\tgrain\tms\tspeedup\n");
+	std::printf("1\t-\t%.2f\t1.00x\n", baseline);
+
+	for (size_t cores = 2; cores <= maxCores; ++cores)
+	{
+		// the calling thread takes part in the loop
+		JobSystem jobs(cores - 1);
+
+		for (size_t grainSize : { 1, 16, 256 })
+		{
+			const double best = bestOfThree(&jobs, results, grainSize);
+			std::printf("%zu\t%zu\t%.2f\t%.2fx\n", cores, grainSize, best, baseline / best);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+#include "Check.h"
+
+#include "Common/JobSystem.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+void testRunAndWait(JobSystem& jobs)
+{
+	std::atomic<int> executed{ 0 };
+	JobCounterSPtr counter = std::make_shared<JobCounter>();
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		jobs.run([&executed]() { executed += 1; }, counter);
+	}
+	jobs.wait(counter);
+
+	CHECK(counter->done());
+	CHECK(executed == 1000);
+}
+
+void testRunAfter(JobSystem& jobs)
+{
+	std::atomic<int> stage{ 0 };
+	std::atomic<bool> ordered{ true };
+
+	JobCounterSPtr first = std::make_shared<JobCounter>();
+	JobCounterSPtr second = std::make_shared<JobCounter>();
+
+	for (int i = 0; i < 16; ++i)
+	{
+		jobs.run([&stage]() {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			stage += 1;
+		}, first);
+	}
+	jobs.runAfter(first, [&stage, &ordered]() { ordered = ordered && stage == 16; }, second);
+	jobs.wait(second);
+
+	CHECK(first->done());
+	CHECK(ordered);
+}
+
+void testParallelFor(JobSystem& jobs)
+{
+	for (size_t grain : { 1, 3, 64, 1000 })
+	{
+		std::vector<std::atomic<int>> visits(997);
+		jobs.parallelFor(visits.size(), [&visits](size_t i) { visits[i] += 1; }, grain);
+
+		for (const std::atomic<int>& count : visits)
+		{
+			CHECK(count == 1);
+		}
+	}
+}
+
+void testNestedParallelFor(JobSystem& jobs)
+{
+	std::atomic<int> executed{ 0 };
+	jobs.parallelFor(32, [&jobs, &executed](size_t) {
+		jobs.parallelFor(32, [&executed](size_t) { executed += 1; });
+	});
+
+	CHECK(executed == 32 * 32);
+}
+
+void testParallelForException(JobSystem& jobs)
+{
+	bool thrown = false;
+	try
+	{
+		jobs.parallelFor(100, [](size_t i) {
+			if (i == 42)
+			{
+				throw std::runtime_error("expected");
+			}
+		});
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+
+	CHECK(thrown);
+}
+
+void testMainThreadJobs(JobSystem& jobs)
+{
+	const std::thread::id mainThread = std::this_thread::get_id();
+	std::atomic<bool> onMain{ false };
+	std::atomic<bool> executed{ false };
+
+	JobCounterSPtr counter = std::make_shared<JobCounter>();
+	jobs.run([&]() {
+		onMain = std::this_thread::get_id() == mainThread;
+		executed = true;
+	}, counter, JobAffinity::Main);
+
+	// parallelFor must not run the queued main thread job in between
+	jobs.parallelFor(256, [](size_t) {});
+	CHECK(!executed);
+
+	CHECK(jobs.processMainThreadJobs() == 1);
+	CHECK(executed && onMain);
+	CHECK(counter->done());
+}
+
+void testConcurrentProducers(JobSystem& jobs)
+{
+	// producers outside of the pool race with the workers popping
+	std::atomic<int> executed{ 0 };
+	JobCounterSPtr counter = std::make_shared<JobCounter>();
+
+	std::vector<std::thread> producers;
+	for (int p = 0; p < 4; ++p)
+	{
+		producers.emplace_back([&jobs, &executed, counter]() {
+			for (int i = 0; i < 5000; ++i)
+			{
+				jobs.run([&executed]() { executed += 1; }, counter);
+			}
+		});
+	}
+
+	for (std::thread& producer : producers)
+	{
+		producer.join();
+	}
+	jobs.wait(counter);
+
+	CHECK(executed == 4 * 5000);
+}
+
+int main()
+{
+	for (size_t threadCount : { 1, 2, 4, 8 })
+	{
+		JobSystem jobs(threadCount);
+
+		testRunAndWait(jobs);
+		testRunAfter(jobs);
+		testParallelFor(jobs);
+		testNestedParallelFor(jobs);
+		testParallelForException(jobs);
+		testMainThreadJobs(jobs);
+		testConcurrentProducers(jobs);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+#include "Check.h"
+
+#include "Preprocessor/MeshConversion.h"
+#include "Scene/Mesh.h"
+
+#include <assimp/mesh.h>
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// heap allocations of this executable, counted by the replaced global operator new
+std::atomic<size_t> g_allocations{ 0 };
+std::atomic<size_t> g_allocatedBytes{ 0 };
+
+void* operator new(size_t size)
+{
+	g_allocations += 1;
+	g_allocatedBytes += size;
+
+	void* memory = std::malloc(size > 0 ? size : 1);
+	if (!memory)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+// allocations since construction
+struct AllocationScope
+{
+	const size_t allocations = g_allocations;
+	const size_t bytes = g_allocatedBytes;
+
+	size_t count() const { return g_allocations - allocations; }
+
+	size_t allocatedBytes() const { return g_allocatedBytes - bytes; }
+};
+
+constexpr unsigned int VERTEX_COUNT = 1000;
+constexpr unsigned int FACE_COUNT = 600;
+
+// complete triangle mesh like the importer leaves it, owned by aiMesh
+void fillMesh(aiMesh& mesh)
+{
+	mesh.mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+	mesh.mNumVertices = VERTEX_COUNT;
+	mesh.mVertices = new aiVector3D[VERTEX_COUNT];
+	mesh.mNormals = new aiVector3D[VERTEX_COUNT];
+	mesh.mTangents = new aiVector3D[VERTEX_COUNT];
+	mesh.mBitangents = new aiVector3D[VERTEX_COUNT];
+	mesh.mTextureCoords[0] = new aiVector3D[VERTEX_COUNT];
+	mesh.mNumUVComponents[0] = 2;
+
+	for (unsigned int i = 0; i < VERTEX_COUNT; ++i)
+	{
+		const float v = static_cast<float>(i);
+		mesh.mVertices[i].x = v;
+		mesh.mVertices[i].y = -v;
+		mesh.mVertices[i].z = 2 * v;
+		mesh.mTextureCoords[0][i].x = v / VERTEX_COUNT;
+		mesh.mTextureCoords[0][i].y = 1 - v / VERTEX_COUNT;
+		mesh.mNormals[i].z = 1;
+		mesh.mTangents[i].x = 1;
+		mesh.mBitangents[i].y = 1;
+	}
+
+	mesh.mNumFaces = FACE_COUNT;
+	mesh.mFaces = new aiFace[FACE_COUNT];
+	for (unsigned int i = 0; i < FACE_COUNT; ++i)
+	{
+		aiFace& face = mesh.mFaces[i];
+		face.mNumIndices = 3;
+		face.mIndices = new unsigned int[3];
+		for (unsigned int k = 0; k < 3; ++k)
+		{
+			face.mIndices[k] = (i + k) % VERTEX_COUNT;
+		}
+	}
+
+	mesh.mAABB.mMin.x = 0;
+	mesh.mAABB.mMin.y = -(VERTEX_COUNT - 1.f);
+	mesh.mAABB.mMax.x = VERTEX_COUNT - 1.f;
+	mesh.mAABB.mMax.z = 2 * (VERTEX_COUNT - 1.f);
+}
+
+// returns the size of the mesh and its shared control block
+size_t testMoveIntoMesh()
+{
+	std::vector<Vertex> vertices(VERTEX_COUNT);
+	std::vector<uint32_t> indices(3 * FACE_COUNT);
+	const Vertex* vertexData = vertices.data();
+	const uint32_t* indexData = indices.data();
+
+	BoundingBox bounds;
+	bounds.insert(glm::vec3(0));
+
+	const AllocationScope moved;
+	MeshSPtr mesh = std::make_shared<Mesh>(std::move(vertices), std::move(indices), bounds);
+	const size_t controlBlockSize = moved.allocatedBytes();
+
+	// the buffers change owner, only the control block is allocated
+	CHECK(moved.count() == 1);
+	CHECK(controlBlockSize < sizeof(Vertex) * VERTEX_COUNT);
+	CHECK(mesh->vertices().data() == vertexData);
+	CHECK(mesh->indices().data() == indexData);
+
+	std::printf("Mesh from rvalue buffers: %zu allocations, %zu bytes\n",
+		moved.count(), controlBlockSize);
+
+	// a copy shows up in the counts, as a lost std::move would
+	const AllocationScope copied;
+	MeshSPtr copy = std::make_shared<Mesh>(mesh->vertices(), mesh->indices());
+	CHECK(copied.count() == 3);
+	CHECK(copied.allocatedBytes() ==
+		controlBlockSize + sizeof(Vertex) * VERTEX_COUNT + sizeof(uint32_t) * 3 * FACE_COUNT);
+
+	return controlBlockSize;
+}
+
+void testFromAssimp(size_t controlBlockSize)
+{
+	aiMesh source;
+	fillMesh(source);
+
+	const AllocationScope converted;
+	MeshSPtr mesh = MeshConversion::fromAssimp(source);
+	const size_t allocations = converted.count();
+	const size_t allocatedBytes = converted.allocatedBytes();
+
+	CHECK(mesh);
+
+	// one reserve per buffer and the mesh, no growth and no copies of the buffers
+	CHECK(allocations == 3);
+	CHECK(allocatedBytes ==
+		controlBlockSize + sizeof(Vertex) * VERTEX_COUNT + sizeof(uint32_t) * 3 * FACE_COUNT);
+
+	std::printf("Mesh from aiMesh: %zu allocations, %zu bytes, %zu vertices\n",
+		allocations, allocatedBytes, static_cast<size_t>(VERTEX_COUNT));
+
+	// all chunks are converted in order
+	CHECK(mesh->vertexCount() == VERTEX_COUNT);
+	CHECK(mesh->indexCount() == 3 * FACE_COUNT);
+	for (unsigned int i = 0; i < VERTEX_COUNT; ++i)
+	{
+		const Vertex& vertex = mesh->vertices()[i];
+		CHECK(vertex.position.x == source.mVertices[i].x);
+		CHECK(vertex.position.y == source.mVertices[i].y);
+		CHECK(vertex.position.z == source.mVertices[i].z);
+		CHECK(vertex.uv.x == source.mTextureCoords[0][i].x);
+		CHECK(vertex.uv.y == source.mTextureCoords[0][i].y);
+		CHECK(vertex.normal.z == 1.f);
+		CHECK(vertex.tangent.x == 1.f);
+	}
+	CHECK(mesh->indices()[3 * 7 + 1] == 8);
+	CHECK(mesh->bounds().max().z == 2 * (VERTEX_COUNT - 1.f));
+}
+
+void testIncompleteMesh()
+{
+	aiMesh source;
+	fillMesh(source);
+
+	delete[] source.mTangents;
+	source.mTangents = nullptr;
+
+	CHECK(!MeshConversion::fromAssimp(source));
+}
+
+int main()
+{
+	const size_t controlBlockSize = testMoveIntoMesh();
+	testFromAssimp(controlBlockSize);
+	testIncompleteMesh();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#include "Check.h"
+
+#include "Common/SphericalHarmonics.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+typedef std::function<glm::vec3(const glm::vec3&)> Environment;
+
+constexpr int FACE_WIDTH = 32;
+
+constexpr float PI = 3.14159265358979f;
+
+// six tightly packed RGB float faces in the layout read back from the GPU
+std::vector<float> renderCubemap(const Environment& environment)
+{
+	std::vector<float> faces(6 * FACE_WIDTH * FACE_WIDTH * 3);
+	for (int face = 0; face < 6; ++face)
+	{
+		for (int y = 0; y < FACE_WIDTH; ++y)
+		{
+			for (int x = 0; x < FACE_WIDTH; ++x)
+			{
+				const glm::vec3 radiance = environment(
+					SphericalHarmonics::cubemapDirection(face, x, y, FACE_WIDTH));
+
+				float* texel = &faces[((face * FACE_WIDTH + y) * FACE_WIDTH + x) * 3];
+				texel[0] = radiance.x;
+				texel[1] = radiance.y;
+				texel[2] = radiance.z;
+			}
+		}
+	}
+	return faces;
+}
+
+// cosine weighted sum over all texels divided by pi, the reference
+// of Util/IBLDiffuse.frag without the hemisphere sampling pattern
+glm::vec3 bruteForceIrradiance(const std::vector<float>& faces, const glm::vec3& normal)
+{
+	const float texelSize = 2.f / FACE_WIDTH;
+
+	glm::vec3 sum(0.f);
+	float totalWeight = 0.f;
+	for (int face = 0; face < 6; ++face)
+	{
+		for (int y = 0; y < FACE_WIDTH; ++y)
+		{
+			for (int x = 0; x < FACE_WIDTH; ++x)
+			{
+				const float s = 2.f * (x + .5f) / FACE_WIDTH - 1.f;
+				const float t = 2.f * (y + .5f) / FACE_WIDTH - 1.f;
+				const float lengthSq = 1.f + s * s + t * t;
+				const float solidAngle = texelSize * texelSize / (lengthSq * std::sqrt(lengthSq));
+
+				const glm::vec3 direction = SphericalHarmonics::cubemapDirection(face, x, y, FACE_WIDTH);
+				const float cosine = std::max(glm::dot(normal, direction), 0.f);
+
+				const float* texel = &faces[((face * FACE_WIDTH + y) * FACE_WIDTH + x) * 3];
+				sum += glm::vec3(texel[0], texel[1], texel[2]) * (cosine * solidAngle);
+				totalWeight += solidAngle;
+			}
+		}
+	}
+
+	// same normalization of the texel solid angles as the projection
+	return sum * (4.f * PI / totalWeight) / PI;
+}
+
+std::vector<glm::vec3> testNormals()
+{
+	std::vector<glm::vec3> normals = {
+		glm::vec3(1.f, 0.f, 0.f), glm::vec3(-1.f, 0.f, 0.f),
+		glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, -1.f, 0.f),
+		glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f)
+	};
+
+	// directions between the face centers and across the edges
+	for (int i = 0; i < 16; ++i)
+	{
+		const float phi = i * 2.399963f;
+		const float z = 1.f - (i + .5f) / 8.f;
+		const float r = std::sqrt(1.f - z * z);
+		normals.push_back(glm::vec3(r * std::cos(phi), r * std::sin(phi), z));
+	}
+	return normals;
+}
+
+void checkAgainstBruteForce(const Environment& environment, 
+	const Environment& expected, float tolerance)
+{
+	const std::vector<float> faces = renderCubemap(environment);
+
+	const SphericalHarmonics::Coefficients irradiance = SphericalHarmonics::convolveIrradiance(
+		SphericalHarmonics::projectCubemap(faces.data(), FACE_WIDTH));
+
+	for (const glm::vec3& normal : testNormals())
+	{
+		const glm::vec3 sh = SphericalHarmonics::evaluate(irradiance, normal);
+		const glm::vec3 reference = bruteForceIrradiance(faces, normal);
+		const glm::vec3 analytic = expected(normal);
+
+		for (int c = 0; c < 3; ++c)
+		{
+			CHECK_NEAR(sh[c], reference[c], tolerance);
+			CHECK_NEAR(reference[c], analytic[c], tolerance);
+		}
+	}
+}
+
+int main()
+{
+	// constant radiance c gives the irradiance pi c, c after dividing by pi
+	checkAgainstBruteForce(
+		[](const glm::vec3&) { return glm::vec3(.5f, 1.f, 2.f); },
+		[](const glm::vec3&) { return glm::vec3(.5f, 1.f, 2.f); },
+		1e-3f);
+
+	// radiance a + b.w gives a + 2/3 b.n, both are exact in the L2 projection
+	const glm::vec3 offset(1.f, 2.f, 1.5f);
+	const glm::vec3 gradient(.3f, -.6f, .9f);
+	checkAgainstBruteForce(
+		[&](const glm::vec3& w) { return offset + glm::vec3(glm::dot(gradient, w)); },
+		[&](const glm::vec3& n) { return offset + glm::vec3(2.f / 3.f * glm::dot(gradient, n)); },
+		5e-3f);
+
+	return EXIT_SUCCESS;
+}